@@ -0,0 +1,95 @@
+/*
+ * Streams a chunked response over a loopback connection
+ * and measures the throughput of outgoing_message's chunk framing.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "libnodecc/http/server.h"
+
+
+static void run(size_t chunk_size, size_t chunks_per_write, size_t total_size) {
+	using namespace node::literals;
+
+	node::loop loop;
+
+	const auto server = node::make_shared<node::http::server>(loop);
+	server->listen4(0, node::literal_string("127.0.0.1", 9));
+
+	node::buffer chunk(chunk_size);
+	memset(chunk.data(), 'x', chunk.size());
+
+	const std::vector<node::buffer> chunks(chunks_per_write, chunk);
+	const size_t write_count = total_size / (chunk_size * chunks_per_write);
+
+	server->on(server->request_event, [&](const node::http::server::request& req, const node::http::server::response& res) {
+		res->set_header("transfer-encoding"_view, "chunked"_view);
+
+		const auto socket = res->socket();
+		const auto written = std::make_shared<size_t>(0);
+
+		const auto pump = [res, socket, written, &chunks, write_count]() {
+			while (*written < write_count) {
+				res->write(chunks.data(), chunks.size());
+				++*written;
+
+				if (socket->is_flooded()) {
+					return;
+				}
+			}
+
+			res->end();
+		};
+
+		// on() stores lvalue references as is and thus a copy is passed
+		socket->on(socket->drain_event, decltype(pump)(pump));
+		pump();
+	});
+
+	node::shared_ptr<node::tcp::socket> client;
+	size_t received = 0;
+	const auto start = std::chrono::steady_clock::now();
+
+	node::tcp::socket::connect(loop, node::literal_string("127.0.0.1", 9), server->port(), [&](const std::error_code* err, const node::shared_ptr<node::tcp::socket>& socket) {
+		if (err) {
+			printf("connect failed: %s\n", err->message().c_str());
+			server->destroy();
+			return;
+		}
+
+		client = socket;
+
+		socket->on(socket->data_event, [&](const node::buffer& buf) {
+			received += buf.size();
+		});
+
+		// the server ends the connection after the response
+		socket->on(socket->destroy_event, [&]() {
+			server->destroy();
+		});
+
+		static const char request[] = "GET / HTTP/1.1\r\nhost: localhost\r\n\r\n";
+		socket->write(node::buffer(request, sizeof(request) - 1));
+		socket->resume();
+	});
+
+	loop.run();
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	const double chunk_count = double(write_count * chunks_per_write);
+
+	printf("%6zu B chunks, %2zu per write %8.1f ns/chunk %8.1f MB/s\n", chunk_size, chunks_per_write, elapsed.count() * 1e9 / chunk_count, double(received) / elapsed.count() / 1e6);
+}
+
+
+void bench_http_chunked() {
+	const size_t total_size = 512 * 1024 * 1024;
+
+	run(1024, 1, total_size / 4);
+	run(1024, 16, total_size / 4);
+	run(16 * 1024, 1, total_size);
+	run(16 * 1024, 16, total_size);
+}
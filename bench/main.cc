@@ -0,0 +1,38 @@
+/*
+ * Runs all benchmarks or only the ones given as arguments,
+ * e.g.: run-benchmarks http_parser
+ */
+
+#include <cstdio>
+#include <cstring>
+
+
+void bench_http_chunked();
+void bench_http_parser();
+
+
+static const struct {
+	const char* name;
+	void (*fn)();
+} benchmarks[] = {
+	{ "http_chunked", bench_http_chunked },
+	{ "http_parser", bench_http_parser },
+};
+
+
+int main(int argc, char* argv[]) {
+	for (const auto& benchmark : benchmarks) {
+		bool enabled = argc < 2;
+
+		for (int i = 1; i < argc; i++) {
+			enabled |= strcmp(argv[i], benchmark.name) == 0;
+		}
+
+		if (enabled) {
+			printf("%s:\n", benchmark.name);
+			benchmark.fn();
+		}
+	}
+
+	return 0;
+}
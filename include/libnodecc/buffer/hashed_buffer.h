@@ -18,6 +18,7 @@ public:
 
 	hashed_buffer(const literal_string& other) noexcept : buffer(other, buffer_flags::weak), hashed_type(other.const_hash()) {}
 
+	hashed_buffer& operator=(const hashed_buffer& other);
 	hashed_buffer& operator=(const buffer_view& other);
 	hashed_buffer& operator=(const buffer& other);
 	hashed_buffer& operator=(const hashed_buffer_view& other);
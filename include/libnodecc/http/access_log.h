@@ -0,0 +1,88 @@
+#ifndef nodecc_http_access_log_h
+#define nodecc_http_access_log_h
+
+#include <vector>
+
+#include "../buffer.h"
+#include "../object.h"
+#include "../util/timer.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * An access log, which is written asynchronously in large batches.
+ *
+ * log() only copies a record into a preallocated buffer. Once it's full,
+ * or if the flush interval passed, the buffer is swapped with a second one
+ * and formatted and written to the file on the thread pool.
+ * If the writer falls behind and both buffers are full, records are
+ * dropped and counted instead of blocking the loop.
+ *
+ * Each line has the format:
+ *   2016-10-19T12:34:56.789Z GET /path 200 1234 0.532
+ * where the last two fields are the body size and the latency in milliseconds.
+ *
+ * This class is NOT thread safe - use one instance per loop.
+ */
+class access_log : public node::object {
+public:
+	struct record {
+		uint64_t time;    // milliseconds since the unix epoch
+		uint64_t latency; // microseconds
+		uint64_t bytes;
+		uint16_t status;
+		uint8_t method_size;
+		uint8_t path_size;
+		char method[16];
+		char path[212];   // longer paths are truncated
+	};
+
+
+	/**
+	 * Opens (or creates) the log file for appending.
+	 *
+	 * @param capacity       The number of records per buffer.
+	 * @param flush_interval The interval in milliseconds in which pending records are written.
+	 */
+	explicit access_log(node::loop& loop, const node::buffer_view& path, std::size_t capacity = 4096, uint64_t flush_interval = 1000);
+
+	void log(const node::buffer_view& method, const node::buffer_view& path, uint16_t status, uint64_t bytes, uint64_t latency);
+
+	/**
+	 * Writes all pending records, unless a write is already in progress.
+	 */
+	void flush();
+
+	/**
+	 * Returns the number of records dropped, since the writer fell behind.
+	 */
+	std::size_t dropped() const noexcept;
+
+protected:
+	~access_log() override;
+
+	void _destroy() override;
+
+private:
+	static void _write(uv_loop_t* loop, uv_file file, const std::vector<record>& records);
+
+	node::loop& _loop;
+	node::shared_ptr<node::util::timer> _timer;
+
+	// _records[_active] is filled by log(), while the other one might be written
+	std::vector<record> _records[2];
+	std::size_t _capacity;
+	std::size_t _dropped;
+	uint64_t _time_offset;
+	uv_file _file;
+	uint8_t _active;
+	bool _is_writing;
+	bool _is_flush_pending;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_access_log_h
@@ -0,0 +1,157 @@
+#ifndef nodecc_http_body_sink_h
+#define nodecc_http_body_sink_h
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../loop.h"
+#include "../stream.h"
+#include "incoming_message.h"
+
+
+namespace node {
+namespace http {
+
+class body_stream;
+
+
+/**
+ * Receives a message body, which is kept in memory up to memory_limit bytes.
+ *
+ * Larger bodies are spilled to an unlinked temporary file, which thus vanishes
+ * as soon as it's closed, using asynchronous writes of up to batch_size bytes.
+ * If the disk can't keep up, the connection is paused until the writes caught up.
+ * The memory used per body is therefore bounded by about memory_limit + 3 * batch_size.
+ *
+ * Example:
+ *   auto sink = node::make_shared<node::http::body_sink>(loop);
+ *   sink->consume(*req, [sink](const std::error_code* err) {
+ *       if (!err) {
+ *           if (sink->is_spilled()) { ... sink->stream() ... } else { ... sink->buffer() ... }
+ *       }
+ *   });
+ */
+class body_sink : public node::object {
+	friend class body_stream;
+
+public:
+	typedef std::function<void(const std::error_code* err)> consume_t;
+
+
+	explicit body_sink(node::loop& loop, std::size_t memory_limit = 1024 * 1024, uint64_t size_limit = UINT64_MAX);
+
+	/**
+	 * Sets the directory of temporary files, which defaults to $TMPDIR or "/tmp".
+	 */
+	void set_directory(const std::string& directory);
+
+	/**
+	 * Sets the maximum amount of data written at once, which defaults to 1 MiB.
+	 */
+	void set_batch_size(std::size_t size);
+
+	/**
+	 * Receives the body of the message and calls the callback once it has been
+	 * completely received and written. Bodies larger than size_limit result in
+	 * a std::errc::message_size error, after which the remaining body is discarded.
+	 *
+	 * This method must be called before any part of the body has been received,
+	 * e.g. synchronously from within the request_event handler, and only once per sink.
+	 * The callback isn't called if the connection is closed prematurely.
+	 */
+	void consume(incoming_message& msg, consume_t callback);
+
+	uint64_t size() const noexcept;
+	bool is_spilled() const noexcept;
+
+	/**
+	 * Returns the complete body if it hasn't been spilled to disk.
+	 */
+	const node::buffer& buffer() const noexcept;
+
+	/**
+	 * Returns the descriptor of the temporary file or -1 if it hasn't been spilled.
+	 */
+	uv_file file() const noexcept;
+
+	/**
+	 * Returns a stream, which reads the body either from memory or from the temporary file.
+	 */
+	node::shared_ptr<body_stream> stream(std::size_t chunk_size = 64 * 1024);
+
+protected:
+	~body_sink() override;
+
+private:
+	void _on_data(const node::buffer& chunk);
+	void _on_end();
+	void _on_socket_destroy();
+	void _fail(const std::error_code& err);
+	bool _open();
+	void _flush();
+	void _on_write(ssize_t result);
+	void _finish();
+
+	node::loop& _loop;
+	std::string _directory;
+	consume_t _callback;
+
+	node::shared_ptr<node::tcp::socket> _socket;
+	void* _socket_destroy_iter;
+
+	// chunks, which are either kept in memory or still need to be written
+	std::vector<node::buffer> _chunks;
+	std::size_t _chunks_size;
+	node::buffer _buffer;
+
+	// chunks of the write in progress
+	std::vector<node::buffer> _writing;
+	std::vector<uv_buf_t> _iovs;
+	uv_fs_t _write_req;
+
+	std::size_t _memory_limit;
+	std::size_t _batch_size;
+	uint64_t _size_limit;
+	uint64_t _size;
+	uint64_t _file_size;
+	uv_file _file;
+
+	bool _is_consuming;
+	bool _is_writing;
+	bool _is_paused;
+	bool _has_ended;
+	bool _has_failed;
+};
+
+
+/**
+ * Reads the body received by a body_sink, which must have completed successfully.
+ */
+class body_stream : public node::object, public node::stream::readable<body_stream, node::buffer> {
+public:
+	static const node::events::symbol<void(const std::error_code& err)> error_event;
+
+	explicit body_stream(body_sink& sink, std::size_t chunk_size);
+
+protected:
+	~body_stream() override;
+
+	void _resume() override;
+	void _pause() override;
+
+private:
+	void _read();
+
+	body_sink& _sink;
+	uv_fs_t _req;
+	node::buffer _chunk;
+	uint64_t _offset;
+	std::size_t _chunk_size;
+	bool _is_reading;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_body_sink_h
@@ -0,0 +1,88 @@
+#ifndef nodecc_http_cookies_h
+#define nodecc_http_cookies_h
+
+#include <utility>
+#include <vector>
+
+#include "../buffer.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * Attributes of a "set-cookie" header as per RFC 6265 §4.1.
+ */
+struct cookie_attributes {
+	enum same_site_type : uint8_t {
+		none = 0,
+		lax,
+		strict,
+	};
+
+	node::buffer domain;
+	node::buffer path;
+
+	// the lifetime in seconds, or a negative value for a session cookie
+	int64_t max_age = -1;
+
+	bool secure = false;
+	bool http_only = false;
+	same_site_type same_site = none;
+};
+
+
+/**
+ * A view on the cookies of a "cookie" request header.
+ *
+ * The header is only parsed on the first lookup and
+ * all names and values are slices of the header value.
+ */
+class cookies {
+public:
+	typedef std::pair<node::buffer, node::buffer> value_type;
+
+
+	explicit cookies();
+
+	/**
+	 * Serializes a "set-cookie" header value into a single buffer.
+	 *
+	 * @throws std::invalid_argument if the name is empty or any part contains
+	 *         control characters (e.g. CR or LF) or a ";", or the name a "=".
+	 */
+	static node::buffer serialize(const node::buffer_view& name, const node::buffer_view& value, const cookie_attributes& attributes = cookie_attributes());
+
+	void set_header(const node::buffer& header) noexcept;
+
+	/**
+	 * Returns the value of the first cookie with the given name or nullptr if it doesn't exist.
+	 */
+	const node::buffer* find(const node::buffer_view& name);
+
+	/**
+	 * Returns the value of the first cookie with the given name or an empty buffer.
+	 */
+	const node::buffer& get(const node::buffer_view& name);
+
+	bool has(const node::buffer_view& name);
+
+	const std::vector<value_type>& all();
+
+	/**
+	 * Resets the view, while retaining the allocated storage.
+	 */
+	void clear() noexcept;
+
+private:
+	void _parse();
+
+	std::vector<value_type> _cookies;
+	node::buffer _header;
+	bool _is_parsed;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_cookies_h
@@ -0,0 +1,31 @@
+#ifndef nodecc_http_etag_h
+#define nodecc_http_etag_h
+
+#include "../buffer.h"
+
+
+namespace node {
+namespace http {
+
+class etag {
+public:
+	/**
+	 * Generates a strong entity tag for a body consisting of the given buffers.
+	 *
+	 * The tag is formed from the CRC32C checksum and the total length of the body.
+	 * For static bodies it should be generated once and set as the "etag" header,
+	 * which allows server_response to skip hashing the body on every request.
+	 */
+	static node::buffer generate(const node::buffer bufs[], std::size_t bufcnt);
+
+	/**
+	 * Returns true if the value of an "if-none-match" request header
+	 * matches the entity tag using the weak comparison function of RFC 7232 §2.3.2.
+	 */
+	static bool matches(const node::buffer_view& if_none_match, const node::buffer_view& tag) noexcept;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_etag_h
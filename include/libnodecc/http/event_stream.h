@@ -0,0 +1,92 @@
+#ifndef nodecc_http_event_stream_h
+#define nodecc_http_event_stream_h
+
+#include <vector>
+
+#include "../util/timer.h"
+#include "server.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * Turns a server response into a "text/event-stream" as per the Server-Sent Events specification.
+ *
+ * Events are serialized into a reused arena buffer and all events
+ * sent during the same loop iteration are written as a single chunk.
+ *
+ * The stream destroys itself if the response is destroyed or the client ends the connection.
+ */
+class event_stream : public node::object {
+public:
+	/**
+	 * Serializes an event, which can then be sent to any number
+	 * of streams without being serialized again.
+	 *
+	 * Line breaks in data are converted into multiple "data" fields.
+	 * event and id must not contain line breaks.
+	 *
+	 * @param retry The reconnection time in milliseconds, or 0 to omit it.
+	 */
+	static node::buffer serialize(const node::buffer_view& data, const node::buffer_view& event = node::buffer_view(), const node::buffer_view& id = node::buffer_view(), uint32_t retry = 0);
+
+
+	/**
+	 * Sends the response headers and starts the stream.
+	 *
+	 * @param heartbeat_interval The interval in milliseconds after which
+	 *                           an idle stream sends a comment to keep
+	 *                           the connection alive, or 0 to disable it.
+	 */
+	explicit event_stream(const node::http::server::response& res, uint64_t heartbeat_interval = 15000);
+
+	void send(const node::buffer_view& data, const node::buffer_view& event = node::buffer_view(), const node::buffer_view& id = node::buffer_view());
+
+	/**
+	 * Sends an event, which has been created using serialize(), as it is.
+	 * Use send() for the data of an event instead.
+	 */
+	void send_serialized(const node::buffer& event);
+
+	void comment(const node::buffer_view& text);
+
+	/**
+	 * Flushes all pending events, ends the response and destroys the stream.
+	 */
+	void end();
+
+protected:
+	~event_stream() override = default;
+
+	void _destroy() override;
+
+private:
+	void _begin_chunk();
+	void _cut_arena();
+	void _flush();
+
+	node::http::server::response _res;
+	node::shared_ptr<node::util::timer> _heartbeat;
+	void* _res_destroy_iter;
+
+	// the stream is destroyed as soon as the client has ended the connection
+	node::shared_ptr<node::tcp::socket> _socket;
+	void* _socket_end_iter;
+	void* _socket_destroy_iter;
+
+	// events are serialized into _arena and cut into _chunk, interleaved with shared events
+	node::mutable_buffer _arena;
+	std::vector<node::buffer> _chunk;
+	std::size_t _arena_offset;
+	std::size_t _chunk_size;
+
+	// true if a chunk has been started and a flush is scheduled for the next tick
+	bool _is_chunk_open;
+	bool _is_idle;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_event_stream_h
@@ -0,0 +1,95 @@
+#ifndef nodecc_http_header_list_h
+#define nodecc_http_header_list_h
+
+#include <utility>
+#include <vector>
+
+#include "../buffer.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * An ordered list of outgoing headers.
+ *
+ * Headers are serialized in the order they were first set and may occur multiple
+ * times (e.g. "set-cookie"). Lookups of the well known headers below are
+ * answered using precomputed slots, while all other lookups are linear,
+ * which is faster than hashing for the usual amount of headers.
+ *
+ * Header names are compared case-sensitively and should be lowercase.
+ */
+class header_list {
+public:
+	typedef std::pair<node::hashed_buffer, node::buffer> value_type;
+	typedef const value_type* const_iterator;
+
+	enum well_known : uint8_t {
+		cache_control = 0,
+		connection,
+		content_length,
+		date,
+		etag,
+		set_cookie,
+		transfer_encoding,
+		well_known_count,
+	};
+
+
+	explicit header_list();
+
+	/**
+	 * Replaces all values of the header or appends it if it doesn't exist yet.
+	 */
+	void set(const node::hashed_buffer& name, const node::buffer& value);
+
+	/**
+	 * Appends a header, even if another one with the same name exists.
+	 */
+	void add(const node::hashed_buffer& name, const node::buffer& value);
+
+	/**
+	 * Removes all values of the header.
+	 *
+	 * @return true if at least one header has been removed.
+	 */
+	bool erase(const node::hashed_buffer& name);
+
+	/**
+	 * Returns the first value of the header or nullptr if it doesn't exist.
+	 * The returned pointer is valid until the next call to a non-const method.
+	 */
+	const node::buffer* find(const node::hashed_buffer& name) const;
+	const node::buffer* find(well_known name) const noexcept;
+
+	bool contains(well_known name) const noexcept;
+
+	/**
+	 * Appends all headers as "name: value\r\n" lines.
+	 */
+	void serialize(node::mutable_buffer& buf) const;
+
+	void clear() noexcept;
+
+	std::size_t size() const noexcept;
+	bool empty() const noexcept;
+
+	const_iterator begin() const noexcept;
+	const_iterator end() const noexcept;
+
+private:
+	static uint8_t _slot(const node::buffer_view& name) noexcept;
+
+	void _rebuild_slots() noexcept;
+
+	std::vector<value_type> _entries;
+
+	// index + 1 of the first entry with the given name or 0 if there is none
+	uint32_t _slots[well_known_count];
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_header_list_h
@@ -9,6 +9,8 @@
 #include "../buffer.h"
 #include "../tcp/socket.h"
 #include "../stream.h"
+#include "cookies.h"
+#include "request_parser.h"
 
 
 namespace node {
@@ -77,9 +79,13 @@ private:
 
 
 class incoming_message : public node::object, public node::stream::readable<incoming_message, node::buffer> {
+	friend class proxy;
 	friend class server;
 
 public:
+	typedef std::function<void(const std::error_code* err, const node::buffer& body)> read_body_t;
+
+
 	explicit incoming_message(const node::shared_ptr<node::tcp::socket>& socket, http_parser_type type);
 
 	const node::shared_ptr<node::tcp::socket>& socket();
@@ -97,8 +103,36 @@ public:
 
 	bool is_websocket_request();
 
+	/**
+	 * Returns a view on the "cookie" header, which is parsed on the first lookup.
+	 */
+	http::cookies& cookies();
+
+	/**
+	 * Collects the complete body and passes it to the callback as a single buffer.
+	 *
+	 * If the "content-length" is known, the body is allocated exactly once,
+	 * or not at all if it is received in a single read. Bodies larger than the limit
+	 * result in a std::errc::message_size error, which is reported as early as possible
+	 * (i.e. before receiving any data if the "content-length" exceeds it).
+	 * Afterwards the remaining body is silently discarded.
+	 *
+	 * This method must be called before any part of the body has been received,
+	 * e.g. synchronously from within the request_event handler.
+	 * The callback isn't called if the connection is closed prematurely.
+	 */
+	void read_body(std::size_t limit, read_body_t callback);
+
 	node::callback<void(bool upgrade, bool keep_alive)> headers_complete_callback;
 
+	/**
+	 * Called once a response switched protocols (e.g. "101 Switching Protocols")
+	 * or a request asked for an upgrade, with the data received after its head.
+	 * The message detaches from the socket beforehand, which is left open
+	 * for the new protocol instead of being ended.
+	 */
+	node::callback<void(const node::buffer& rest)> upgrade_callback;
+
 protected:
 	~incoming_message() override = default;
 
@@ -106,6 +140,14 @@ protected:
 	void _pause() override;
 	void _destroy() override;
 
+	/*
+	 * Used by http::server to reuse instances for multiple connections.
+	 * _detach() resets the instance to the state after construction,
+	 * while retaining the allocated header storage.
+	 */
+	void _attach(const node::shared_ptr<node::tcp::socket>& socket);
+	void _detach();
+
 private:
 	static int parser_on_url(http_parser* parser, const char* at, size_t length);
 	static int parser_on_header_field(http_parser* parser, const char* at, size_t length);
@@ -117,10 +159,15 @@ private:
 	void _add_header_partials();
 	node::buffer _buffer(const char* at, size_t length);
 
+	void _on_request_data(node::buffer data);
+	int _on_request_head(const node::buffer& head, int size);
+	void _message_complete();
+
 
 	node::shared_ptr<node::tcp::socket> _socket;
 
 	std::unordered_map<node::hashed_buffer, node::mutable_buffer> _headers;
+	http::cookies _cookies;
 
 	node::mutable_buffer _generic_value;
 	node::mutable_buffer _partial_header_field;
@@ -129,10 +176,30 @@ private:
 	const node::buffer* _parser_buffer;
 	http_parser _parser;
 
+	// requests are parsed using request_parser, responses using http_parser
+	enum body_state : uint8_t {
+		head = 0,
+		content_length,
+		chunked,
+		upgraded,
+	};
+
+	node::http::request_parser _request_parser;
+	node::http::chunked_decoder _chunked_decoder;
+	node::mutable_buffer _partial_head;
+	uint64_t _body_remaining;
+	uint8_t _body_state;
+
 	uint16_t _status_code;
 	uint8_t _http_version_major;
 	uint8_t _http_version_minor;
 	uint8_t _is_websocket;
+	bool _is_upgrade;
+	bool _has_cookies;
+
+	// listeners added to the socket, which are removed by _detach()
+	void* _socket_data_iter;
+	void* _socket_end_iter;
 };
 
 } // namespace http
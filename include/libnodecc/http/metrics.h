@@ -0,0 +1,93 @@
+#ifndef nodecc_http_metrics_h
+#define nodecc_http_metrics_h
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "../buffer.h"
+#include "../util/histogram.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * Request latency histograms and throughput counters of a http::server.
+ *
+ * Latencies are measured in microseconds from the moment the request headers
+ * are complete until the response has been completely passed to the socket.
+ * They are recorded per status class (1xx to 5xx) and, if the handler
+ * called server_response::set_route(), additionally per route.
+ *
+ * record() must only be called by the thread running the loop of the server.
+ * Any other thread may create a consistent-enough snapshot at any time using the
+ * copy constructor or merge(), e.g. to aggregate the metrics of multiple loops.
+ */
+class metrics {
+public:
+	struct series {
+		explicit series() noexcept;
+		series(const series& other) noexcept;
+
+		void merge(const series& other) noexcept;
+
+		node::util::histogram latency;
+
+		// index 0 counts 1xx responses, index 4 5xx ones
+		std::atomic<uint64_t> responses[5];
+		std::atomic<uint64_t> bytes;
+	};
+
+
+	explicit metrics();
+
+	metrics(const metrics& other);
+	metrics& operator=(const metrics& other) = delete;
+
+	/**
+	 * @param status  The HTTP status code of the response.
+	 * @param route   The route of the response or an empty buffer.
+	 * @param latency The latency in microseconds.
+	 * @param bytes   The amount of body bytes sent.
+	 */
+	void record(uint16_t status, const node::buffer& route, uint64_t latency, uint64_t bytes);
+
+	/**
+	 * Adds the values of another instance to this one.
+	 * This method is thread-safe in regards to record() calls on the other instance,
+	 * but this instance must not be recorded to concurrently (i.e. it should be a snapshot).
+	 */
+	void merge(const metrics& other);
+
+	/**
+	 * Returns the series of a status class.
+	 *
+	 * @param status_class A value between 1 and 5 (e.g. 2 for all 2xx responses).
+	 */
+	const series& status_class(unsigned int status_class) const;
+
+	/**
+	 * Returns the series of a route or nullptr if it wasn't recorded yet.
+	 */
+	const series* route(const node::buffer& route) const;
+
+	/**
+	 * Serializes all values using the Prometheus text format.
+	 */
+	node::buffer to_text() const;
+
+private:
+	typedef std::unordered_map<node::hashed_buffer, std::unique_ptr<series>> route_map;
+
+	series _status_classes[5];
+
+	// inserts (writes) and copies from other threads (reads) are synchronized with this mutex
+	mutable std::mutex _mutex;
+	route_map _routes;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_metrics_h
@@ -0,0 +1,137 @@
+#ifndef nodecc_http_multipart_parser_h
+#define nodecc_http_multipart_parser_h
+
+#include "../buffer.h"
+#include "../callback.h"
+#include "header_list.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * A streaming parser for multipart bodies (e.g. multipart/form-data, RFC 7578).
+ *
+ * The body is passed in slices as they arrive (e.g. from the data_event of an incoming_message),
+ * which makes it possible to process arbitrarily large uploads in constant memory.
+ * Part data is emitted as zero-copy slices of the pushed buffers. Only the few bytes
+ * at the end of a slice, which might be the beginning of a split delimiter,
+ * are held back until the next slice arrives.
+ *
+ * Calling pause() from within a callback stops the parser after the current callback
+ * and keeps the remaining input until resume() is called. The source of the data
+ * should be paused too, as long as push() or resume() return false.
+ *
+ * Example:
+ *   auto parser = std::make_shared<multipart_parser>(multipart_parser::boundary(req->header("content-type"_view)));
+ *   req->on(req->data_event, [req, parser](const node::buffer& chunk) {
+ *       if (!parser->push(chunk)) {
+ *           req->pause();
+ *       }
+ *   });
+ */
+class multipart_parser {
+public:
+	/**
+	 * Part headers larger than this are considered an error.
+	 */
+	static const std::size_t max_header_size = 16 * 1024;
+
+	/**
+	 * Returns the boundary parameter of a multipart content-type header value,
+	 * or an empty buffer if there is none. The result is a slice of content_type.
+	 */
+	static node::buffer boundary(const node::buffer& content_type);
+
+
+	explicit multipart_parser(const node::buffer_view& boundary);
+
+	/**
+	 * Parses the next slice of the body.
+	 *
+	 * @return false if the parser has been paused, in which case the
+	 *         remaining input will be parsed as soon as resume() is called.
+	 */
+	bool push(const node::buffer& data);
+
+	/**
+	 * Stops emitting callbacks after the current one returns.
+	 */
+	void pause() noexcept;
+
+	/**
+	 * Continues parsing the input which was left over when the parser was paused.
+	 *
+	 * @return false if the parser has been paused again.
+	 */
+	bool resume();
+
+	bool is_paused() const noexcept;
+	bool is_complete() const noexcept;
+	bool has_error() const noexcept;
+
+	/**
+	 * Called with the headers of each part, whose names have been lowercased.
+	 * The headers are only valid until the callback returns.
+	 */
+	node::callback<void(const http::header_list& headers)> part_callback;
+
+	/**
+	 * Called with a slice of the current part's content.
+	 */
+	node::callback<void(const node::buffer& data)> data_callback;
+
+	/**
+	 * Called when the content of the current part is complete.
+	 */
+	node::callback<void()> part_end_callback;
+
+	/**
+	 * Called once the closing delimiter has been parsed.
+	 */
+	node::callback<void()> end_callback;
+
+private:
+	enum state : uint8_t {
+		preamble = 0,
+		delimiter_suffix,
+		delimiter_dash,
+		delimiter_lf,
+		headers,
+		body,
+		epilogue,
+		error,
+	};
+
+	void _execute(node::buffer data);
+	std::size_t _consume_body(const node::buffer& data);
+	std::size_t _consume_tail(const node::buffer& data);
+	std::size_t _consume_headers(const node::buffer& data);
+	bool _parse_headers(std::size_t size);
+	void _emit_data(const node::buffer& data);
+	void _delimiter_found();
+	std::size_t _search(const uint8_t* data, std::size_t size) const noexcept;
+
+	// "\r\n--" followed by the boundary
+	node::buffer _delimiter;
+
+	// Horspool shift table for _delimiter
+	uint8_t _skip[256];
+
+	// a possible beginning of a delimiter at the end of the previous slice
+	node::buffer _tail;
+
+	// input which hasn't been parsed yet, due to the parser being paused
+	node::buffer _pending;
+
+	node::mutable_buffer _head;
+	http::header_list _headers;
+
+	state _state;
+	bool _is_paused;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_multipart_parser_h
@@ -2,17 +2,18 @@
 #define nodecc_http_outgoing_message_h
 
 #include <string>
-#include <unordered_map>
 
 #include "../buffer.h"
 #include "../tcp/socket.h"
 #include "../stream.h"
+#include "header_list.h"
 
 
 namespace node {
 namespace http {
 
 class outgoing_message : public node::object, public node::stream::writable<outgoing_message, node::buffer> {
+	friend class proxy;
 	friend class server;
 
 public:
@@ -20,16 +21,26 @@ public:
 
 	const node::shared_ptr<node::tcp::socket>& socket();
 
-	const node::buffer header(node::hashed_buffer& key);
+	/**
+	 * Returns the first value of a header or an empty buffer if it isn't set.
+	 */
+	const node::buffer header(const node::hashed_buffer& key) const;
 
 	/**
-	 * Sets a header.
+	 * Sets a header, replacing all previously set values.
 	 *
 	 * If the a "transfer-encoding" header is set, it *must*
 	 * either include "chunked" as the last comma-seperated entry,
 	 * or a content-length entry, as per HTTP specification.
 	 */
-	void set_header(node::hashed_buffer key, node::buffer value);
+	void set_header(const node::hashed_buffer& key, const node::buffer& value);
+
+	/**
+	 * Adds a header, even if it has already been set (e.g. for "set-cookie").
+	 */
+	void add_header(const node::hashed_buffer& key, const node::buffer& value);
+
+	void remove_header(const node::hashed_buffer& key);
 
 	bool headers_sent() const;
 
@@ -44,16 +55,23 @@ protected:
 
 	void _destroy() override;
 
+	// see incoming_message::_attach()
+	void _attach(const node::shared_ptr<node::tcp::socket>& socket);
+	virtual void _detach();
+
 	void _write(const node::buffer chunks[], size_t chunkcnt) override;
 	void _end(const node::buffer chunks[], size_t chunkcnt) override;
 
 	virtual void compile_headers(node::mutable_buffer& buf) = 0;
 
 	// needs to be directly accessed by certain subclasses
-	std::unordered_map<node::hashed_buffer, node::buffer> _headers;
+	http::header_list _headers;
 	node::shared_ptr<node::tcp::socket> _socket;
 	bool _headers_sent;
 	bool _is_chunked;
+
+	// if false, no message body or framing headers will be sent (e.g. for 304 responses)
+	bool _has_body;
 };
 
 } // namespace http
@@ -0,0 +1,77 @@
+#ifndef nodecc_http_proxy_h
+#define nodecc_http_proxy_h
+
+#include <memory>
+#include <vector>
+
+#include "request.h"
+#include "server.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * A reverse proxy, which forwards requests to a single upstream server.
+ *
+ * Request and response bodies are streamed in both directions as the same
+ * refcounted buffers they were received in, i.e. without copying them.
+ * If the receiving side can't keep up, the sending side is paused until it drained.
+ * Hop-by-hop headers (RFC 7230 §6.1) are removed in both directions.
+ *
+ * Upstream connections are kept alive and reused for subsequent requests.
+ * If the upstream server can't be reached, "502 Bad Gateway" is sent.
+ *
+ * Example:
+ *   auto proxy = node::make_shared<node::http::proxy>(loop, upstream_addr);
+ *   server->on(server->request_event, [proxy](const server::request& req, const server::response& res) {
+ *       proxy->forward(req, res);
+ *   });
+ */
+class proxy : public node::object {
+public:
+	explicit proxy(node::loop& loop, const sockaddr& upstream);
+
+	/**
+	 * Forwards the request and sends the upstream response.
+	 *
+	 * This method must be called before any part of the request body
+	 * has been received, e.g. synchronously from within the request_event handler.
+	 */
+	void forward(const server::request& req, const server::response& res);
+
+	std::size_t max_idle_connections() const noexcept;
+	void set_max_idle_connections(std::size_t n);
+
+	std::size_t idle_connections() const noexcept;
+
+protected:
+	~proxy() override = default;
+
+	void _destroy() override;
+
+private:
+	struct exchange;
+
+	node::shared_ptr<node::tcp::socket> _acquire();
+	void _release(const node::shared_ptr<node::tcp::socket>& socket);
+	void _remove_idle(node::tcp::socket* socket);
+
+	void _on_response_headers(const std::shared_ptr<exchange>& x, bool keep_alive);
+	void _finish(const std::shared_ptr<exchange>& x);
+	void _fail(const std::shared_ptr<exchange>& x, bool reply);
+	void _schedule_teardown(const std::shared_ptr<exchange>& x);
+	void _teardown(const std::shared_ptr<exchange>& x);
+	void _detach(exchange& x);
+
+	node::loop& _loop;
+	sockaddr_storage _upstream;
+	std::vector<std::shared_ptr<exchange>> _exchanges;
+	std::vector<node::shared_ptr<node::tcp::socket>> _idle;
+	std::size_t _max_idle;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_proxy_h
@@ -21,12 +21,33 @@ typedef node::shared_ptr<detail::response> response;
 typedef std::function<void(const std::error_code* err, const node::http::client::request& req, const node::http::client::response& res)> on_connect_t;
 
 
+/**
+ * Timeouts for a request in milliseconds, where 0 means no limit.
+ *
+ * An expired timeout destroys the socket and passes a std::errc::timed_out error to the callback.
+ * All pending timeouts of a loop share a single timer (see loop::set_timeout).
+ */
+struct timeouts {
+	// resolving the host of the url
+	uint64_t lookup = 0;
+
+	// establishing the connection
+	uint64_t connect = 0;
+
+	// from the end of the request until the first byte of the response has been received
+	uint64_t first_byte = 0;
+
+	// from the call to request() until the response has been received completely
+	uint64_t total = 0;
+};
+
+
 namespace detail {
 
 #define NODE_HTTP_REQUEST_GENERATOR_SIGNATURE \
-	void _generate(node::shared_ptr<node::tcp::socket> socket, const node::buffer& host, const node::buffer& method, const node::buffer& path, const client::on_connect_t& cb)
+	void _generate(node::shared_ptr<node::tcp::socket> socket, const node::buffer& host, const node::buffer& method, const node::buffer& path, const client::timeouts& timeouts, uint64_t deadline, const client::on_connect_t& cb)
 
-static NODE_HTTP_REQUEST_GENERATOR_SIGNATURE;
+NODE_HTTP_REQUEST_GENERATOR_SIGNATURE;
 
 class request : public node::http::outgoing_message {
 	friend NODE_HTTP_REQUEST_GENERATOR_SIGNATURE;
@@ -41,8 +62,14 @@ private:
 	node::buffer _method;
 	node::buffer _path;
 
+	// called once the request has been ended, to start the first_byte timeout
+	std::function<void()> _end_callback;
+
 protected:
 	~request() override = default;
+
+	void _destroy() override;
+	void _end(const node::buffer chunks[], size_t chunkcnt) override;
 };
 
 class response : public node::http::incoming_message {
@@ -60,7 +87,9 @@ protected:
 
 
 void request(node::loop& loop, const node::buffer& method, const node::buffer& url, const client::on_connect_t& cb);
+void request(node::loop& loop, const node::buffer& method, const node::buffer& url, const client::timeouts& timeouts, const client::on_connect_t& cb);
 void request(node::loop& loop, const sockaddr& addr, const node::buffer& host, const node::buffer& method, const node::buffer& path, const client::on_connect_t& cb);
+void request(node::loop& loop, const sockaddr& addr, const node::buffer& host, const node::buffer& method, const node::buffer& path, const client::timeouts& timeouts, const client::on_connect_t& cb);
 
 } // namespace http
 } // namespace node
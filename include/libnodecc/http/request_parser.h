@@ -0,0 +1,112 @@
+#ifndef nodecc_http_request_parser_h
+#define nodecc_http_request_parser_h
+
+#include "../buffer.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * A zero-copy parser for the request line and headers of a HTTP/1.x request.
+ *
+ * All parsed tokens are returned as views into the parsed buffer.
+ * If SSE4.2 is enabled at compile time (e.g. using -msse4.2),
+ * the path and header values are scanned 16 bytes at a time.
+ *
+ * Incomplete requests are parsed incrementally by passing the grown buffer and the
+ * size it had during the previous call, which allows skipping incomplete heads quickly.
+ */
+class request_parser {
+public:
+	struct header {
+		node::buffer_view name;
+		node::buffer_view value;
+	};
+
+	enum result : int {
+		error = -1,
+		incomplete = -2,
+	};
+
+	static const std::size_t max_headers = 64;
+
+
+	explicit request_parser() noexcept;
+
+	/**
+	 * Parses the head of a request.
+	 *
+	 * @param buf       The buffer containing the (possibly partial) request.
+	 * @param last_size The size of buf during the previous call which returned incomplete, or 0.
+	 * @return The size of the head including the terminating empty line, or a value of result.
+	 */
+	int parse(const node::buffer_view& buf, std::size_t last_size = 0) noexcept;
+
+	const node::buffer_view& method() const noexcept;
+	const node::buffer_view& path() const noexcept;
+	uint8_t http_version_minor() const noexcept;
+
+	const header* headers() const noexcept;
+	std::size_t header_count() const noexcept;
+
+private:
+	header _headers[max_headers];
+	node::buffer_view _method;
+	node::buffer_view _path;
+	std::size_t _header_count;
+	uint8_t _http_version_minor;
+};
+
+
+/**
+ * An incremental decoder for the chunked transfer coding.
+ *
+ * It does not copy or modify the input, but instead returns
+ * the position of the chunk data within the consumed input.
+ */
+class chunked_decoder {
+public:
+	explicit chunked_decoder() noexcept;
+
+	/**
+	 * Consumes input until either a slice of chunk data has been found,
+	 * the terminating chunk and trailers have been read or the input is exhausted.
+	 *
+	 * @param data        The input.
+	 * @param size        The size of the input.
+	 * @param data_offset Receives the offset of the chunk data within the input.
+	 * @param data_size   Receives the size of the chunk data, or 0 if none was found.
+	 * @return The number of consumed bytes.
+	 */
+	std::size_t decode(const uint8_t* data, std::size_t size, std::size_t& data_offset, std::size_t& data_size) noexcept;
+
+	bool is_complete() const noexcept;
+	bool has_error() const noexcept;
+
+	void reset() noexcept;
+
+private:
+	enum state : uint8_t {
+		size = 0,
+		extension,
+		size_lf,
+		data,
+		data_cr,
+		data_lf,
+		trailer_start,
+		trailer,
+		trailer_lf,
+		complete,
+		error,
+	};
+
+	uint64_t _remaining;
+	uint8_t _state;
+	uint8_t _size_digits;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_request_parser_h
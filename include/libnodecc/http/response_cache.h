@@ -0,0 +1,132 @@
+#ifndef nodecc_http_response_cache_h
+#define nodecc_http_response_cache_h
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "../buffer.h"
+
+
+namespace node {
+namespace http {
+
+class incoming_message;
+
+
+/**
+ * A byte-bounded LRU cache for serialized HTTP responses.
+ *
+ * Entries hold the exact buffers which have been written to the socket
+ * (the compiled head followed by the body), which allows a cache hit
+ * to be written out without invoking a handler or compiling headers again.
+ *
+ * This class is NOT thread safe - use one instance per loop.
+ */
+class response_cache {
+public:
+	struct entry {
+		node::hashed_buffer key;
+
+		/*
+		 * The status line, the remaining head without the "date" header and the body.
+		 * Cache hits insert a current "date" and an "age" header after the status line.
+		 */
+		std::vector<node::buffer> bufs;
+
+		// used to answer conditional requests with "304 Not Modified"
+		node::buffer etag;
+		node::buffer cache_control;
+
+		std::size_t size;
+		uint64_t expires;
+
+		// the loop time at which the response was generated
+		uint64_t date;
+	};
+
+
+	explicit response_cache(std::size_t max_size = 16 * 1024 * 1024);
+
+	response_cache(const response_cache&) = delete;
+	response_cache& operator=(const response_cache&) = delete;
+
+	/**
+	 * Returns the amount of bytes currently held by all entries.
+	 */
+	std::size_t size() const noexcept;
+
+	std::size_t max_size() const noexcept;
+	void set_max_size(std::size_t max_size);
+
+	std::size_t hits() const noexcept;
+	std::size_t misses() const noexcept;
+
+	/**
+	 * Sets the request headers, whose values are part of the cache key.
+	 * This works similiar to the "vary" response header.
+	 *
+	 * @param headers A list of lowercase header names.
+	 */
+	void set_vary_headers(std::vector<node::hashed_buffer> headers);
+
+	/**
+	 * Returns the cache key for a request, whose headers are complete.
+	 */
+	node::hashed_buffer key(incoming_message& req) const;
+
+	/**
+	 * Returns true if all headers named by the value of a "vary" response header
+	 * are part of the cache key (see set_vary_headers()). A response varying
+	 * on any other header (or "*") must not be cached as per RFC 7234 §4.1.
+	 */
+	bool is_vary_covered(const node::buffer_view& vary) const noexcept;
+
+	/**
+	 * Returns the entry for the key or nullptr if it doesn't exist or is expired.
+	 * The returned pointer is valid until the next call to a non-const method.
+	 *
+	 * @param now The current loop time in milliseconds.
+	 */
+	const entry* find(const node::hashed_buffer& key, uint64_t now);
+
+	/**
+	 * Inserts an entry, while evicting the least recently used ones
+	 * until the entry fits. Entries larger than max_size() are discarded.
+	 *
+	 * @param date The loop time in milliseconds at which the response was generated.
+	 */
+	void insert(const node::hashed_buffer& key, std::vector<node::buffer>&& bufs, uint64_t expires, const node::buffer& etag = node::buffer(), const node::buffer& cache_control = node::buffer(), uint64_t date = 0);
+
+	void erase(const node::hashed_buffer& key);
+	void clear();
+
+	/**
+	 * Returns the freshness lifetime in seconds for the value of a
+	 * "cache-control" response header, or 0 if it must not be cached.
+	 *
+	 * "s-maxage" takes precedence over "max-age", since this is a shared cache.
+	 */
+	static uint64_t max_age(const node::buffer_view& cache_control) noexcept;
+
+private:
+	typedef std::list<entry> list_type;
+
+	void _erase(list_type::iterator it);
+	void _evict(std::size_t required);
+
+	// the front holds the most recently used entry
+	list_type _entries;
+	std::unordered_map<node::hashed_buffer, list_type::iterator> _index;
+	std::vector<node::hashed_buffer> _vary_headers;
+
+	std::size_t _size;
+	std::size_t _max_size;
+	std::size_t _hits;
+	std::size_t _misses;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_response_cache_h
@@ -1,16 +1,47 @@
 #ifndef nodecc_http_server_h
 #define nodecc_http_server_h
 
-#include <list>
+#include <memory>
+#include <vector>
 
 #include "../tcp/server.h"
+#include "../util/lag_monitor.h"
+#include "access_log.h"
+#include "cookies.h"
+#include "etag.h"
 #include "incoming_message.h"
+#include "metrics.h"
 #include "outgoing_message.h"
+#include "response_cache.h"
+#include "static_response.h"
 
 
 namespace node {
 namespace http {
 
+/**
+ * Thresholds for server::set_load_shedding().
+ *
+ * All lags are in milliseconds and a threshold of 0 disables the respective measure.
+ */
+struct load_shedding_options {
+	// requests are answered with "503 Service Unavailable" above this lag
+	uint32_t reject_above = 0;
+
+	// new connections aren't accepted anymore above this lag
+	uint32_t pause_above = 0;
+
+	// both measures are lifted below this lag, or below half of their threshold if 0
+	uint32_t recover_below = 0;
+
+	// the value of the "retry-after" header in seconds
+	uint32_t retry_after = 1;
+
+	// the sampling interval of the lag
+	uint32_t interval = 10;
+};
+
+
 class server : public node::tcp::server {
 public:
 	class server_request : public node::http::incoming_message {
@@ -29,14 +60,78 @@ public:
 		uint16_t status_code() const;
 		void set_status_code(uint16_t code);
 
+		/**
+		 * If enabled, a strong "etag" header is generated for "200 OK" responses,
+		 * whose body is completely passed to end().
+		 *
+		 * Independent of this setting, if an "etag" header is present
+		 * and matches the "if-none-match" header of a GET or HEAD request,
+		 * the body is dropped and "304 Not Modified" is sent instead.
+		 * Handlers of other methods need to check the header themselves
+		 * and respond with "412 Precondition Failed" (RFC 7232 §3.2).
+		 */
+		void set_auto_etag(bool enabled);
+
+		/**
+		 * Sets the route (e.g. "/users/:id") under which the
+		 * response is recorded in the metrics of the server.
+		 */
+		void set_route(const node::buffer& route);
+
+		/**
+		 * Adds a "set-cookie" header, which is serialized into a single buffer.
+		 */
+		void set_cookie(const node::buffer_view& name, const node::buffer_view& value, const cookie_attributes& attributes = cookie_attributes());
+
+		/**
+		 * Ends the response by sending the pre-serialized one with a single write.
+		 * Headers set on this response are ignored and the body is omitted for HEAD requests.
+		 *
+		 * @throws std::logic_error if the headers have already been sent.
+		 */
+		void send(const static_response& response);
+
 	protected:
+		void _write(const node::buffer chunks[], size_t chunkcnt) override;
 		void _end(const node::buffer chunks[], size_t chunkcnt) override;
 
 		void compile_headers(node::mutable_buffer& buf) override;
 
+		void _detach() override;
+
 	private:
+		/*
+		 * Writes a complete, already serialized response
+		 * (e.g. a cache hit) directly to the socket.
+		 */
+		void _send_raw(const node::buffer bufs[], size_t bufcnt, size_t headcnt = 1);
+		void _finish();
+		void _capture(const node::buffer chunks[], size_t chunkcnt);
+
+		std::shared_ptr<http::response_cache> _cache;
+		node::hashed_buffer _cache_key;
+		std::vector<node::buffer> _cache_bufs;
+		node::buffer _cache_etag;
+		node::buffer _cache_control;
+		uint64_t _cache_expires;
+		uint64_t _cache_date;
+
+		node::buffer _if_none_match;
+
+		node::shared_ptr<http::access_log> _access_log;
+		node::buffer _log_method;
+		node::buffer _log_path;
+		std::shared_ptr<http::metrics> _metrics;
+		node::buffer _route;
+
+		// both are only tracked if either logging or metrics are enabled
+		uint64_t _start_time;
+		uint64_t _bytes_sent;
+
 		uint16_t _status_code;
 		bool _shutdown_on_end;
+		bool _auto_etag;
+		bool _is_head;
 	};
 
 
@@ -45,17 +140,125 @@ public:
 
 	static const node::events::symbol<void(const node::http::server::request& req, const node::http::server::response& res)> request_event;
 
+	/**
+	 * Emitted for requests asking to switch protocols (e.g. "upgrade: websocket") or CONNECT,
+	 * with the socket, which isn't used for HTTP anymore, and the data following the head.
+	 * The listener is responsible for writing the response (e.g. "101 Switching Protocols").
+	 * Without a listener such requests are answered with "501 Not Implemented".
+	 */
+	static const node::events::symbol<void(const node::http::server::request& req, const node::shared_ptr<node::tcp::socket>& socket, const node::buffer& head)> upgrade_event;
+
 
 	explicit server(node::loop& loop);
 
+	/**
+	 * Enables caching of responses to GET requests using the given cache.
+	 *
+	 * Only complete "200 OK" responses, which specify a positive
+	 * "max-age" or "s-maxage" in their "cache-control" header
+	 * and were not sent using the chunked encoding, are cached.
+	 * Cache hits are written directly to the socket, without emitting request_event.
+	 *
+	 * Body buffers of cached responses are retained as they are
+	 * and thus must not be modified after they have been written.
+	 *
+	 * @param cache The cache to use or nullptr to disable caching.
+	 */
+	void set_cache(const std::shared_ptr<http::response_cache>& cache);
+	const std::shared_ptr<http::response_cache>& cache() const;
+
+	/**
+	 * Sets the default for server_response::set_auto_etag().
+	 */
+	void set_auto_etag(bool enabled);
+
+	/**
+	 * Logs every response to the given log, once it has been completely written.
+	 *
+	 * @param log The log to use or nullptr to disable logging.
+	 */
+	void set_access_log(const node::shared_ptr<http::access_log>& log);
+	const node::shared_ptr<http::access_log>& access_log() const;
+
+	/**
+	 * Records the latency of every response into the given metrics.
+	 *
+	 * @param metrics The metrics to use or nullptr to disable them.
+	 * @param path    If not empty, GET requests for this path are answered
+	 *                with metrics::to_text() instead of emitting request_event.
+	 */
+	void set_metrics(const std::shared_ptr<http::metrics>& metrics, const node::buffer& path = node::buffer());
+	const std::shared_ptr<http::metrics>& metrics() const;
+
+	/**
+	 * Sets the maximum amount of idle request/response pairs,
+	 * which are kept around to be reused for new connections.
+	 *
+	 * A pair is only reused if no references to it are left
+	 * after its connection has been closed.
+	 */
+	void set_connection_pool_size(std::size_t size);
+	std::size_t connection_pool_size() const;
+
+	/**
+	 * Sheds load while the event loop lags behind, so that the latency
+	 * of admitted requests stays bounded instead of every request timing out.
+	 *
+	 * Shed requests are answered with a precomputed "503 Service Unavailable"
+	 * response without emitting request_event. Pausing the acceptance of
+	 * connections leaves them in the backlog of the listening socket instead.
+	 */
+	void set_load_shedding(const load_shedding_options& options);
+	const load_shedding_options& load_shedding() const;
+
+	/**
+	 * Returns the smoothed event loop lag in microseconds,
+	 * or 0 if load shedding isn't enabled.
+	 */
+	uint64_t loop_lag() const;
+
+	bool is_shedding() const;
+	uint64_t shed_requests() const;
+
 protected:
 	~server() override = default;
 
 	void _destroy() override;
 
 private:
+	struct connection {
+		node::shared_ptr<tcp::socket> socket;
+		request req;
+		response res;
+
+		// intrusive list of active connections
+		connection* prev;
+		connection* next;
+	};
+
+	connection* _acquire_connection(const node::shared_ptr<tcp::socket>& socket);
+	void _release_connection(connection* conn);
+	void _delete_connection(connection* conn);
+	void _on_headers_complete(connection* conn, bool upgrade, bool keep_alive);
+	void _update_shedding(uint64_t lag);
+
 	std::shared_ptr<bool> _is_destroyed;
-	std::list<node::shared_ptr<tcp::socket>> _clients;
+	std::shared_ptr<http::response_cache> _cache;
+	connection* _clients;
+	std::vector<connection*> _connection_pool;
+	std::size_t _connection_pool_size;
+	node::shared_ptr<http::access_log> _access_log;
+	std::shared_ptr<http::metrics> _metrics;
+	node::buffer _metrics_path;
+	node::shared_ptr<util::lag_monitor> _lag_monitor;
+	load_shedding_options _shedding;
+	node::buffer _shed_head;
+	uint64_t _shed_requests;
+	bool _is_shedding;
+
+	// true if accepting has been suspended by the load shedding, independent of pause_accepting()
+	bool _is_accept_paused;
+	bool _auto_etag;
 };
 
 } // namespace http
@@ -0,0 +1,50 @@
+#ifndef nodecc_http_static_response_h
+#define nodecc_http_static_response_h
+
+#include "../buffer.h"
+#include "header_list.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * A complete response, which is serialized into a single buffer once
+ * and can then be sent with a single write, e.g. for health checks.
+ *
+ * The "date" header is patched into the buffer in place whenever it changes.
+ * If the buffer is still referenced at that point (e.g. by a pending write)
+ * it is copied first, since the pending write would observe the change otherwise.
+ * Thus an instance may only be used by a single loop.
+ *
+ * Example:
+ *   node::http::header_list headers;
+ *   headers.set("content-type"_view, "text/plain"_view);
+ *   static const node::http::static_response ok(200, headers, node::buffer("OK"_view));
+ *   res->send(ok);
+ */
+class static_response {
+public:
+	explicit static_response(uint16_t status_code, const header_list& headers, const node::buffer& body);
+
+	/**
+	 * Returns the serialized response with the given "date" header line,
+	 * which must be of the same format as the one of the server.
+	 */
+	node::buffer get(const node::buffer& date) const;
+
+	uint16_t status_code() const noexcept;
+	std::size_t body_size() const noexcept;
+
+private:
+	mutable node::buffer _buffer;
+	mutable node::buffer _date;
+	std::size_t _date_offset;
+	std::size_t _body_size;
+	uint16_t _status_code;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_static_response_h
@@ -0,0 +1,84 @@
+#ifndef nodecc_http_urlencoded_parser_h
+#define nodecc_http_urlencoded_parser_h
+
+#include <utility>
+#include <vector>
+
+#include "../buffer.h"
+#include "../callback.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * An incremental parser for application/x-www-form-urlencoded bodies.
+ *
+ * The body is passed in slices as they arrive and every complete key/value pair
+ * is emitted as soon as its terminating "&" has been parsed. Keys and values
+ * without any "%XX" or "+" escapes are slices of the pushed buffers.
+ * Only the others are decoded, into a shared arena which grows in blocks.
+ *
+ * All pairs are retained in their original order, which makes the parser
+ * usable as an ordered multi-map after finish() has been called.
+ */
+class urlencoded_parser {
+public:
+	typedef std::pair<node::buffer, node::buffer> value_type;
+	typedef std::vector<value_type>::const_iterator const_iterator;
+
+	static const std::size_t arena_block_size = 4096;
+
+
+	explicit urlencoded_parser();
+
+	/**
+	 * Parses the next slice of the body.
+	 */
+	void push(const node::buffer& data);
+
+	/**
+	 * Parses the last pair, which isn't terminated by a "&".
+	 */
+	void finish();
+
+	/**
+	 * Returns the value of the first pair with the given key or nullptr if it doesn't exist.
+	 */
+	const node::buffer* find(const node::buffer_view& key) const noexcept;
+
+	/**
+	 * Returns the number of pairs with the given key.
+	 */
+	std::size_t count(const node::buffer_view& key) const noexcept;
+
+	std::size_t size() const noexcept;
+	bool empty() const noexcept;
+
+	const_iterator begin() const noexcept;
+	const_iterator end() const noexcept;
+
+	void clear() noexcept;
+
+	/**
+	 * Called with the decoded key and value of every pair.
+	 */
+	node::callback<void(const node::buffer& key, const node::buffer& value)> pair_callback;
+
+private:
+	void _add(const node::buffer& pair);
+	node::buffer _decode(const node::buffer& buf);
+
+	std::vector<value_type> _pairs;
+
+	// the unterminated pair at the end of the previous slice
+	node::mutable_buffer _partial;
+
+	node::buffer _arena;
+	std::size_t _arena_used;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_urlencoded_parser_h
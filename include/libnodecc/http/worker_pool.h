@@ -0,0 +1,101 @@
+#ifndef nodecc_http_worker_pool_h
+#define nodecc_http_worker_pool_h
+
+#include <deque>
+#include <exception>
+#include <functional>
+
+#include "../util/histogram.h"
+#include "server.h"
+
+
+namespace node {
+namespace http {
+
+/**
+ * Runs CPU-bound parts of request handlers (e.g. templating) on the libuv thread pool,
+ * while their results are delivered back on the thread running the loop.
+ *
+ * At most max_concurrency jobs run at once, so that the thread pool stays available
+ * for file system and DNS requests. Further jobs are queued up to max_queued,
+ * after which submit() rejects new ones.
+ *
+ * Jobs are passed their input by capturing it, e.g. the request body as node::buffer.
+ * Captured values are only destroyed on the loop thread, but must not be modified
+ * by it while the job is running.
+ *
+ * Example:
+ *   req->read_body(1 << 20, [pool, res](const std::error_code* err, const node::buffer& body) {
+ *       if (!err) {
+ *           pool->submit(res, [body]() { return render(body); });
+ *       }
+ *   });
+ */
+class worker_pool : public node::object {
+public:
+	typedef std::function<node::buffer()> work_t;
+	typedef std::function<void(const std::exception_ptr& err, const node::buffer& result)> done_t;
+
+
+	explicit worker_pool(node::loop& loop, std::size_t max_concurrency = 2, std::size_t max_queued = 1024);
+
+	/**
+	 * Runs work on the thread pool and calls done with its result on the loop.
+	 * If work throws, the exception is passed to done instead.
+	 *
+	 * @return false if the queue is full, in which case neither is called.
+	 */
+	bool submit(work_t work, done_t done);
+
+	/**
+	 * Runs work on the thread pool and ends the response with its result.
+	 *
+	 * If work throws, "500 Internal Server Error" is sent and if the queue is full
+	 * "503 Service Unavailable" (in which case false is returned).
+	 */
+	bool submit(const server::response& res, work_t work);
+
+	std::size_t running() const noexcept;
+	std::size_t queued() const noexcept;
+	uint64_t completed() const noexcept;
+	uint64_t rejected() const noexcept;
+
+	/**
+	 * Returns the time jobs spent in the queue in microseconds.
+	 */
+	const node::util::histogram& wait_time() const noexcept;
+
+	/**
+	 * Returns the time jobs spent running on the thread pool in microseconds.
+	 */
+	const node::util::histogram& run_time() const noexcept;
+
+protected:
+	~worker_pool() override = default;
+
+	void _destroy() override;
+
+private:
+	struct job {
+		work_t work;
+		done_t done;
+		uint64_t submit_time;
+	};
+
+	void _start(job&& j);
+
+	node::loop& _loop;
+	std::deque<job> _queue;
+	node::util::histogram _wait_time;
+	node::util::histogram _run_time;
+	uint64_t _completed;
+	uint64_t _rejected;
+	std::size_t _max_concurrency;
+	std::size_t _max_queued;
+	std::size_t _running;
+};
+
+} // namespace http
+} // namespace node
+
+#endif // nodecc_http_worker_pool_h
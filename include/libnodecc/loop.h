@@ -2,6 +2,7 @@
 #define nodecc_loop_h
 
 #include <functional>
+#include <unordered_map>
 #include <vector>
 #include <uv.h>
 
@@ -35,17 +36,54 @@ public:
 		uv_async_send(&this->_tick_async);
 	}
 
+	/**
+	 * Calls the function once after the timeout in milliseconds.
+	 *
+	 * All timeouts of a loop share a single uv_timer_t, which makes them cheap to
+	 * set and clear, e.g. for deadlines which are usually cleared before they expire.
+	 *
+	 * @return An id for clear_timeout(), which is never 0.
+	 */
+	uint64_t set_timeout(uint64_t timeout, on_tick_t cb);
+
+	/**
+	 * @return false if the timeout has already expired or been cleared.
+	 */
+	bool clear_timeout(uint64_t id);
+
 
 	operator uv_loop_t*();
 	operator const uv_loop_t*() const;
 
 public:
+	struct timeout_entry {
+		uint64_t due;
+		uint64_t id;
+
+		// std::push_heap() etc. create a max-heap, but the earliest timeout should be on top
+		bool operator<(const timeout_entry& other) const noexcept {
+			return this->due > other.due || (this->due == other.due && this->id > other.id);
+		}
+	};
+
 	static void _on_async(uv_async_t* handle) noexcept;
+	static void _on_timer(uv_timer_t* handle) noexcept;
+
+	void _arm_timer();
 
 	uv_loop_t _loop;
 
 	uv_async_t _tick_async;
 	std::vector<on_tick_t> _tick_callbacks;
+
+	/*
+	 * Cleared timeouts are only removed from _timeout_callbacks and
+	 * skipped once they reach the top of the _timeouts heap.
+	 */
+	uv_timer_t _timer;
+	std::vector<timeout_entry> _timeouts;
+	std::unordered_map<uint64_t, on_tick_t> _timeout_callbacks;
+	uint64_t _next_timeout_id;
 };
 
 } // namespace node
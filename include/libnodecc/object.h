@@ -150,18 +150,24 @@ public:
 	}
 
 	shared_ptr<element_type>& operator=(const shared_ptr<element_type>& other) {
-		this->_ptr = other._ptr;
-
-		if (this->_ptr) {
-			this->_ptr->retain();
+		// retain first, since this might be a self-assignment
+		if (other._ptr) {
+			other._ptr->retain();
 		}
 
+		this->reset();
+		this->_ptr = other._ptr;
+
 		return *this;
 	}
 
 	shared_ptr<element_type>& operator=(shared_ptr<element_type>&& other) {
-		this->_ptr = other._ptr;
-		other._ptr = nullptr;
+		if (this != &other) {
+			this->reset();
+			this->_ptr = other._ptr;
+			other._ptr = nullptr;
+		}
+
 		return *this;
 	}
 
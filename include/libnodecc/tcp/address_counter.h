@@ -0,0 +1,62 @@
+#ifndef nodecc_tcp_address_counter_h
+#define nodecc_tcp_address_counter_h
+
+#include <cstdint>
+#include <vector>
+
+#include "../uv/handle.h"
+
+
+namespace node {
+namespace tcp {
+
+/**
+ * Counts occurrences per IP address, e.g. the connections per remote host.
+ *
+ * IPv4 addresses are stored as IPv4-mapped IPv6 addresses and ports are ignored.
+ * The entries are kept in a single open addressing table with linear probing,
+ * whose slots consist of just the address and its count.
+ * Addresses are removed as soon as their count drops to zero.
+ */
+class address_counter {
+public:
+	explicit address_counter();
+
+	/**
+	 * Increments the count of the address (a sockaddr_in or sockaddr_in6) and returns the new count.
+	 */
+	uint32_t increment(const sockaddr& addr);
+
+	/**
+	 * Decrements the count of the address and returns the new count.
+	 */
+	uint32_t decrement(const sockaddr& addr);
+
+	uint32_t count(const sockaddr& addr) const;
+
+	/**
+	 * Returns the number of distinct addresses.
+	 */
+	std::size_t size() const noexcept;
+
+	void clear() noexcept;
+
+private:
+	struct slot {
+		uint8_t address[16];
+		uint32_t count;
+	};
+
+	static void _key(const sockaddr& addr, uint8_t key[16]);
+	std::size_t _home(const uint8_t key[16]) const;
+	std::size_t _find(const uint8_t key[16]) const;
+	void _grow();
+
+	std::vector<slot> _slots;
+	std::size_t _size;
+};
+
+} // namespace tcp
+} // namespace node
+
+#endif // nodecc_tcp_address_counter_h
@@ -0,0 +1,79 @@
+#ifndef nodecc_tcp_forwarder_h
+#define nodecc_tcp_forwarder_h
+
+#include <memory>
+
+#include "socket.h"
+
+
+namespace node {
+namespace tcp {
+
+/**
+ * Relays all data between two connected sockets until both directions have ended.
+ *
+ * On Linux the data is moved with splice() through a pipe per direction
+ * and thus never copied to user space. Elsewhere, or if the sockets still have
+ * queued writes, they are connected via their data and drain events instead.
+ *
+ * An EOF on one socket is forwarded as a shutdown of the other one,
+ * while the opposite direction continues until it has ended as well.
+ *
+ * Example:
+ *   auto fwd = node::make_shared<node::tcp::forwarder>(client, upstream);
+ *   fwd->close_callback.connect([](const std::error_code* err) { ... });
+ *   fwd->start();
+ */
+class forwarder : public node::object {
+public:
+	explicit forwarder(const node::shared_ptr<node::tcp::socket>& a, const node::shared_ptr<node::tcp::socket>& b);
+
+	/**
+	 * Starts forwarding and destroys both sockets once it has finished.
+	 *
+	 * Both sockets must be connected and may not be read from
+	 * or written to by anyone else as long as they are forwarded.
+	 */
+	void start();
+
+	uint64_t bytes_a_to_b() const noexcept;
+	uint64_t bytes_b_to_a() const noexcept;
+
+	/**
+	 * Returns true if the data is being forwarded with splice().
+	 */
+	bool is_spliced() const noexcept;
+
+	/**
+	 * Called once both sockets have been destroyed.
+	 * err is nullptr if both directions have ended gracefully.
+	 */
+	node::callback<void(const std::error_code* err)> close_callback;
+
+protected:
+	~forwarder() override;
+
+private:
+	struct splice_state;
+
+	bool _start_splice();
+	void _start_buffered();
+	void _pump();
+	void _finish(const std::error_code* err);
+
+	node::shared_ptr<node::tcp::socket> _sockets[2];
+	std::unique_ptr<splice_state> _splice;
+	std::error_code _error;
+	uint64_t _bytes[2];
+
+	// true for each socket, which has been destroyed and thus mustn't be written to anymore
+	bool _is_destroyed[2];
+	unsigned int _destroyed_sockets;
+	bool _is_spliced;
+	bool _is_finished;
+};
+
+} // namespace tcp
+} // namespace node
+
+#endif // nodecc_tcp_forwarder_h
@@ -1,6 +1,7 @@
 #ifndef nodecc_tcp_server_h
 #define nodecc_tcp_server_h
 
+#include "address_counter.h"
 #include "socket.h"
 
 
@@ -32,13 +33,74 @@ public:
 	void listen4(uint16_t port = 0, const node::string& ip = node::literal_string("0.0.0.0", 7), int backlog = 511, node::tcp::flags flags = flags::none);
 	void listen6(uint16_t port = 0, const node::string& ip = node::literal_string("::0", 2), int backlog = 511, node::tcp::flags flags = flags::none);
 
-	void accept(node::tcp::socket& client);
+	/**
+	 * Accepts a pending connection into the given socket.
+	 *
+	 * The server is retained until the socket is destroyed,
+	 * which is needed to keep track of the open connections.
+	 *
+	 * @return false if the connection was rejected due to the per-address
+	 *         limit, in which case the socket has already been destroyed.
+	 */
+	bool accept(node::tcp::socket& client);
+
+	/**
+	 * Stops emitting connection_event. New connections queue up
+	 * in the backlog of the listening socket in the meantime.
+	 */
+	void pause_accepting();
+
+	/**
+	 * Emits connection_event for the connection, which arrived while paused (if any).
+	 */
+	void resume_accepting();
+
+	/**
+	 * Returns false if accepting has been paused or suspended, or the connection limit has been reached.
+	 */
+	bool is_accepting() const noexcept;
+
+	/**
+	 * Sets the maximum number of open connections, or 0 for no limit.
+	 * Once it has been reached, accepting is paused until a connection is closed.
+	 */
+	void set_max_connections(std::size_t max);
+	std::size_t max_connections() const noexcept;
+
+	/**
+	 * Sets the maximum number of open connections per remote IP address, or 0 for no limit.
+	 * Connections exceeding it are closed immediately after accepting them.
+	 */
+	void set_max_connections_per_address(uint32_t max);
+	uint32_t max_connections_per_address() const noexcept;
+
+	std::size_t connections() const noexcept;
+	uint64_t rejected_connections() const noexcept;
 
 	void address(sockaddr& addr, int& len);
 	uint16_t port();
 
 protected:
 	~server() override = default;
+
+	/**
+	 * Pauses accepting independent of pause_accepting() (e.g. for load shedding),
+	 * so that resuming one doesn't undo a pause of the other.
+	 */
+	void _set_suspended(bool suspended);
+
+private:
+	void _emit_pending_connection();
+	void _on_connection_closed(const sockaddr_storage* addr);
+
+	node::tcp::address_counter _addresses;
+	std::size_t _max_connections;
+	std::size_t _connections;
+	uint64_t _rejected_connections;
+	uint32_t _max_connections_per_address;
+	bool _is_accepting;
+	bool _is_suspended;
+	bool _has_pending_connection;
 };
 
 } // namespace tcp
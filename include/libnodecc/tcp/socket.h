@@ -7,6 +7,22 @@
 namespace node {
 namespace tcp {
 
+/**
+ * Timeouts for socket::connect() in milliseconds, where 0 means no limit.
+ * An expired timeout results in a std::errc::timed_out error.
+ */
+struct connect_timeouts {
+	// resolving the address
+	uint64_t lookup = 0;
+
+	// establishing the connection, including attempts to further addresses
+	uint64_t connect = 0;
+
+	// both of the above
+	uint64_t total = 0;
+};
+
+
 class socket : public node::uv::stream<uv_tcp_t> {
 	friend struct connect_pack;
 
@@ -15,10 +31,17 @@ public:
 
 	static const node::events::symbol<void()> connect_event;
 
-	static void connect(node::loop& loop, const node::string& address, uint16_t port, dns_connect_t cb);
+	static void connect(node::loop& loop, const node::string& address, uint16_t port, dns_connect_t cb, const connect_timeouts& timeouts = connect_timeouts());
 
 	explicit socket(node::loop& loop);
-	void connect(const sockaddr& addr);
+
+	/**
+	 * Connects to the address and emits either the connect_event or the error_event.
+	 *
+	 * @param timeout The time in milliseconds after which the attempt is aborted
+	 *                with a std::errc::timed_out error, or 0 for no limit.
+	 */
+	void connect(const sockaddr& addr, uint64_t timeout = 0);
 	bool keepalive(unsigned int delay);
 	bool nodelay(bool enable);
 
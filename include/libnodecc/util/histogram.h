@@ -0,0 +1,77 @@
+#ifndef nodecc_util_histogram_h
+#define nodecc_util_histogram_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace node {
+namespace util {
+
+/**
+ * A log-linear histogram similiar to HdrHistogram.
+ *
+ * Values below 32 are counted exactly. Every larger power of two
+ * is split into 16 linear buckets, which limits the relative error
+ * to about 3% over the full uint64_t range in about 8KiB of memory.
+ *
+ * record() must only be called by a single thread (e.g. the thread running the loop).
+ * The histogram can be copied or merged from any thread concurrently to it,
+ * without any locking, resulting in a slightly inconsistent snapshot at worst.
+ */
+class histogram {
+public:
+	static const std::size_t sub_bucket_bits = 5;
+	static const std::size_t sub_bucket_count = std::size_t(1) << sub_bucket_bits;
+	static const std::size_t sub_bucket_half_count = sub_bucket_count / 2;
+	static const std::size_t bucket_count = sub_bucket_count + (64 - sub_bucket_bits) * sub_bucket_half_count;
+
+
+	explicit histogram() noexcept;
+
+	histogram(const histogram& other) noexcept;
+	histogram& operator=(const histogram& other) noexcept;
+
+	void record(uint64_t value) noexcept;
+
+	/**
+	 * Adds the values of another histogram to this one.
+	 */
+	void merge(const histogram& other) noexcept;
+
+	void reset() noexcept;
+
+	uint64_t count() const noexcept;
+	uint64_t sum() const noexcept;
+	uint64_t min() const noexcept;
+	uint64_t max() const noexcept;
+	double mean() const noexcept;
+
+	/**
+	 * Returns the largest value, which is equivalent to the value at the given quantile.
+	 *
+	 * @param quantile A value between 0.0 and 1.0 (e.g. 0.99 for the 99th percentile).
+	 */
+	uint64_t value_at_quantile(double quantile) const noexcept;
+
+	/**
+	 * Returns the index of the bucket counting the value.
+	 */
+	static std::size_t bucket_index(uint64_t value) noexcept;
+
+	static uint64_t bucket_lowest_value(std::size_t index) noexcept;
+	static uint64_t bucket_highest_value(std::size_t index) noexcept;
+
+private:
+	std::atomic<uint64_t> _counts[bucket_count];
+	std::atomic<uint64_t> _count;
+	std::atomic<uint64_t> _sum;
+	std::atomic<uint64_t> _min;
+	std::atomic<uint64_t> _max;
+};
+
+} // namespace util
+} // namespace node
+
+#endif // nodecc_util_histogram_h
@@ -0,0 +1,53 @@
+#ifndef nodecc_util_lag_monitor_h
+#define nodecc_util_lag_monitor_h
+
+#include "../uv/handle.h"
+
+
+namespace node {
+namespace util {
+
+/**
+ * Measures how far the event loop lags behind, i.e. how late
+ * a repeating timer fires compared to when it was scheduled.
+ *
+ * Since the timer can't fire before all callbacks of the current
+ * loop iteration have run, lag() additionally takes the time into account,
+ * which has been spent in the current iteration so far.
+ *
+ * The timer doesn't keep the loop alive.
+ */
+class lag_monitor : public node::uv::handle<uv_timer_t> {
+public:
+	/**
+	 * Emitted after every sample with the smoothed lag in microseconds.
+	 */
+	static const node::events::symbol<void(uint64_t lag)> lag_event;
+
+	explicit lag_monitor(node::loop& loop);
+
+	/**
+	 * Starts taking a sample every interval milliseconds.
+	 */
+	void start(uint64_t interval = 10);
+	void stop();
+
+	/**
+	 * Returns the exponentially weighted moving average of the lag in microseconds,
+	 * or the time spent in the current loop iteration if that's larger.
+	 */
+	uint64_t lag() const noexcept;
+
+protected:
+	~lag_monitor() override = default;
+
+private:
+	uint64_t _interval;
+	uint64_t _last_sample;
+	uint64_t _lag;
+};
+
+} // namespace util
+} // namespace node
+
+#endif // nodecc_util_lag_monitor_h
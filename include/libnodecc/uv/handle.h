@@ -54,17 +54,6 @@ public:
 	operator const T*() const { return &this->_handle; }
 
 
-	template<class T1, class T2>
-	friend bool operator==(const uv::handle<T1>& lhs, const uv::handle<T2>& rhs) noexcept {
-		return &lhs._handle == &rhs._handle;
-	}
-
-	template<class T1, class T2>
-	friend bool operator!=(const uv::handle<T1>& lhs, const uv::handle<T2>& rhs) noexcept {
-		return &lhs._handle != &rhs._handle;
-	}
-
-
 	bool is_closing() const {
 		return uv_is_closing(*this) != 0;
 	}
@@ -103,6 +92,20 @@ protected:
 template<typename T>
 const node::events::symbol<void(const std::error_code& err)> handle<T>::error_event;
 
+/*
+ * These are defined outside of handle<T>, since friend templates would be
+ * redefined for every instantiation of handle<T> within a translation unit.
+ */
+template<class T1, class T2>
+bool operator==(const uv::handle<T1>& lhs, const uv::handle<T2>& rhs) noexcept {
+	return static_cast<const uv_handle_t*>(lhs) == static_cast<const uv_handle_t*>(rhs);
+}
+
+template<class T1, class T2>
+bool operator!=(const uv::handle<T1>& lhs, const uv::handle<T2>& rhs) noexcept {
+	return static_cast<const uv_handle_t*>(lhs) != static_cast<const uv_handle_t*>(rhs);
+}
+
 } // namespace uv
 } // namespace node
 
@@ -3,6 +3,8 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
+#include <stdexcept>
 #include <vector>
 
 #include "../buffer.h"
@@ -20,12 +22,103 @@ public:
 		return reinterpret_cast<uv_stream_t*>(&this->_handle);
 	}
 
+	/**
+	 * Enables write coalescing.
+	 *
+	 * While corked, written buffers are collected until the end of the current
+	 * loop iteration and then written out using a single (vectored) write call.
+	 * They are written out earlier if either of the limits is reached.
+	 * Weak buffers are copied, since they would not outlive the delay.
+	 *
+	 * @param max_size   The amount of bytes which may be collected.
+	 * @param max_bufcnt The amount of buffers which may be collected.
+	 */
+	void cork(size_t max_size = 64 * 1024, size_t max_bufcnt = 64) {
+		this->_cork_max_size = max_size;
+		this->_cork_max_bufcnt = max_bufcnt;
+
+		if (!this->_cork_check && this->_handle.loop && !this->is_closing()) {
+			this->_cork_check = new uv_check_t;
+			uv_check_init(this->_handle.loop, this->_cork_check);
+			uv_unref(reinterpret_cast<uv_handle_t*>(this->_cork_check));
+			this->_cork_check->data = this;
+		}
+	}
+
+	/**
+	 * Writes out all collected buffers and disables write coalescing.
+	 */
+	void uncork() {
+		this->_flush_corked();
+		this->_close_cork_check();
+	}
+
+	bool is_corked() const {
+		return this->_cork_check != nullptr;
+	}
+
+	/**
+	 * Keeps the writable side open after the other side shut down its side,
+	 * instead of ending it as well. The stream is destroyed once both have ended.
+	 */
+	void set_allow_half_open(bool enable) noexcept {
+		this->_allow_half_open = enable;
+	}
+
+	/**
+	 * Writes the given iovecs without requiring a node::buffer for each of them.
+	 *
+	 * owners[i] must be the buffer keeping the memory of iov[i] alive or nullptr
+	 * if the memory is static. The owners are only retained (once per consecutive run)
+	 * if the data can't be written synchronously.
+	 *
+	 * @return false if the stream is flooded (see writable::write()).
+	 */
+	bool writev(const uv_buf_t iov[], const node::buffer* const owners[], size_t iovcnt) {
+		if (!this->is_writable()) {
+			throw std::logic_error("write after end");
+		}
+
+		if (this->_cork_check) {
+			for (size_t i = 0; i < iovcnt; i++) {
+				const uint8_t* base = reinterpret_cast<const uint8_t*>(iov[i].base);
+				const size_t len = iov[i].len;
+
+				if (owners[i]) {
+					const size_t start = size_t(base - owners[i]->data());
+					const node::buffer buf = owners[i]->slice(start, start + len);
+					this->_write_corked(&buf, 1);
+				} else {
+					const node::buffer buf(base, len, node::buffer_flags::weak);
+					this->_write_corked(&buf, 1);
+				}
+			}
+		} else if (iovcnt) {
+			// _writev_now() modifies the iovecs
+			uv_buf_t* uv_bufs = static_cast<uv_buf_t*>(alloca(iovcnt * sizeof(uv_buf_t)));
+			memcpy(uv_bufs, iov, iovcnt * sizeof(uv_buf_t));
+			this->_writev_now(uv_bufs, owners, iovcnt);
+		}
+
+		this->_is_regular_level = this->_wm < this->_hwm;
+		return this->_is_regular_level;
+	}
+
 protected:
 	typedef node::uv::handle<T> handle_type;
 	typedef node::stream::duplex<stream<T>, node::buffer> stream_type;
 
 	~stream() override = default;
 
+	void _destroy() override {
+		// collected buffers are dropped just like queued write requests are cancelled
+		this->_cork_bufs.clear();
+		this->_cork_size = 0;
+		this->_close_cork_check();
+
+		handle_type::_destroy();
+	}
+
 	void _resume() override {
 		node::uv::check(uv_read_start(*this, [](uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf) {
 			auto self = reinterpret_cast<node::uv::stream<T>*>(handle->data);
@@ -51,7 +144,7 @@ protected:
 
 					if (self->writable_has_ended()) {
 						self->destroy();
-					} else {
+					} else if (!self->_allow_half_open) {
 						self->end();
 					}
 				} else {
@@ -70,22 +163,39 @@ protected:
 	}
 
 	void _write(const node::buffer bufs[], size_t bufcnt) override {
+		if (this->_cork_check) {
+			this->_write_corked(bufs, bufcnt);
+		} else {
+			this->_write_now(bufs, bufcnt);
+		}
+	}
+
+	void _write_now(const node::buffer bufs[], size_t bufcnt) {
 		if (bufcnt == 0) {
 			return;
 		}
 
 		uv_buf_t* uv_bufs = static_cast<uv_buf_t*>(alloca(bufcnt * sizeof(uv_buf_t)));
+		const node::buffer** owners = static_cast<const node::buffer**>(alloca(bufcnt * sizeof(node::buffer*)));
+
+		for (size_t i = 0; i < bufcnt; i++) {
+			uv_bufs[i].base = (char*)bufs[i].data();
+			uv_bufs[i].len  = bufs[i].size();
+			owners[i] = bufs + i;
+		}
+
+		this->_writev_now(uv_bufs, owners, bufcnt);
+	}
+
+	/*
+	 * uv_bufs is modified in place if the data is only partially written.
+	 */
+	void _writev_now(uv_buf_t* uv_bufs, const node::buffer* const* owners, size_t bufcnt) {
 		size_t total = 0;
 		size_t i;
 
 		for (i = 0; i < bufcnt; i++) {
-			uv_buf_t* a = uv_bufs + i;
-			const node::buffer* b = bufs + i;
-
-			a->base = (char*)b->data();
-			a->len  = b->size();
-
-			total += b->size();
+			total += uv_bufs[i].len;
 		}
 
 		const int wi = uv_try_write(*this, uv_bufs, static_cast<unsigned int>(bufcnt));
@@ -116,7 +226,7 @@ protected:
 			}
 
 			// ...remove them from the lists...
-			bufs    += i;
+			owners  += i;
 			uv_bufs += i;
 			bufcnt  -= i;
 
@@ -126,7 +236,16 @@ protected:
 		}
 
 		struct packed_req {
-			explicit packed_req(uv::stream<T>& stream, const node::buffer bufs[], size_t bufcnt, size_t total) : ref_list(bufs, bufs + bufcnt), total(total) {
+			explicit packed_req(uv::stream<T>& stream, const node::buffer* const* owners, size_t bufcnt, size_t total) : total(total) {
+				this->ref_list.reserve(bufcnt);
+
+				// consecutive iovecs often share the same owner (e.g. chunk framing)
+				for (size_t i = 0; i < bufcnt; i++) {
+					if (owners[i] && (i == 0 || owners[i] != owners[i - 1])) {
+						this->ref_list.emplace_back(*owners[i]);
+					}
+				}
+
 				stream._increase_watermark(this->total);
 				this->req.data = &stream;
 			}
@@ -141,7 +260,7 @@ protected:
 			size_t total;
 		};
 
-		auto pack = std::unique_ptr<packed_req>(new packed_req(*this, bufs, bufcnt, total));
+		auto pack = std::unique_ptr<packed_req>(new packed_req(*this, owners, bufcnt, total));
 
 		node::uv::check(uv_write(&pack->req, *this, uv_bufs, static_cast<unsigned int>(bufcnt), [](uv_write_t* req, int status) {
 			uv::stream<T>* self = reinterpret_cast<uv::stream<T>*>(req->data);
@@ -165,6 +284,8 @@ protected:
 				this->_write(bufs, bufcnt);
 			}
 
+			this->_flush_corked();
+
 			auto req = std::unique_ptr<uv_shutdown_t>(new uv_shutdown_t);
 			req->data = this;
 
@@ -188,7 +309,66 @@ protected:
 	}
 
 private:
+	void _write_corked(const node::buffer bufs[], size_t bufcnt) {
+		for (size_t i = 0; i < bufcnt; i++) {
+			const node::buffer& buf = bufs[i];
+
+			if (buf.size()) {
+				this->_cork_bufs.emplace_back(buf.is_weak() ? buf.copy() : buf);
+				this->_cork_size += buf.size();
+			}
+		}
+
+		if (this->_cork_size >= this->_cork_max_size || this->_cork_bufs.size() >= this->_cork_max_bufcnt) {
+			this->_flush_corked();
+		} else if (!this->_cork_bufs.empty() && !uv_is_active(reinterpret_cast<uv_handle_t*>(this->_cork_check))) {
+			uv_check_start(this->_cork_check, [](uv_check_t* handle) {
+				auto self = reinterpret_cast<node::uv::stream<T>*>(handle->data);
+				self->_flush_corked();
+			});
+		}
+	}
+
+	void _flush_corked() {
+		if (this->_cork_check) {
+			uv_check_stop(this->_cork_check);
+		}
+
+		if (!this->_cork_bufs.empty()) {
+			// _write_now() might call destroy() and thus clear _cork_bufs
+			std::vector<node::buffer> bufs;
+			bufs.swap(this->_cork_bufs);
+			this->_cork_size = 0;
+
+			this->_write_now(bufs.data(), bufs.size());
+
+			// reuse the capacity for the next iteration
+			bufs.clear();
+
+			if (this->_cork_bufs.empty()) {
+				bufs.swap(this->_cork_bufs);
+			}
+		}
+	}
+
+	void _close_cork_check() {
+		if (this->_cork_check) {
+			uv_close(reinterpret_cast<uv_handle_t*>(this->_cork_check), [](uv_handle_t* handle) {
+				delete reinterpret_cast<uv_check_t*>(handle);
+			});
+
+			this->_cork_check = nullptr;
+		}
+	}
+
 	node::buffer _alloc_buffer;
+
+	uv_check_t* _cork_check = nullptr;
+	std::vector<node::buffer> _cork_bufs;
+	size_t _cork_size = 0;
+	size_t _cork_max_size = 0;
+	size_t _cork_max_bufcnt = 0;
+	bool _allow_half_open = false;
 };
 
 } // namespace uv
@@ -0,0 +1,121 @@
+#ifndef nodecc_websocket_broadcaster_h
+#define nodecc_websocket_broadcaster_h
+
+#include <unordered_map>
+#include <vector>
+
+#include "../tcp/socket.h"
+#include "../util/histogram.h"
+#include "frame.h"
+
+
+namespace node {
+namespace websocket {
+
+/**
+ * Sends the same messages to a large number of WebSocket connections.
+ *
+ * Every message is serialized into a single frame only once and the same
+ * refcounted buffer is then written to every subscribed socket.
+ * Frames are never split, so that a connection either receives a message
+ * completely or not at all, which keeps the stream of frames valid.
+ *
+ * Slow connections, whose socket is flooded, are handled according to the policy:
+ * - drop:       The frame is skipped for this connection.
+ * - queue:      Up to max_queued frames are held back until the socket drained,
+ *               after which the connection is destroyed instead.
+ * - disconnect: The connection is destroyed.
+ *
+ * Sockets are unsubscribed automatically once they're destroyed.
+ *
+ * Example:
+ *   auto hub = node::make_shared<node::websocket::broadcaster>(node::websocket::broadcaster::flood_policy::queue);
+ *   hub->subscribe(socket);
+ *   hub->broadcast(node::websocket::opcode::text, "{\"price\":42}"_view);
+ */
+class broadcaster : public node::object {
+public:
+	enum class flood_policy : uint8_t {
+		drop,
+		queue,
+		disconnect,
+	};
+
+
+	explicit broadcaster(flood_policy policy = flood_policy::drop, std::size_t max_queued = 16);
+
+	/**
+	 * @return false if the socket is already subscribed.
+	 */
+	bool subscribe(const node::shared_ptr<node::tcp::socket>& socket);
+
+	/**
+	 * @return false if the socket isn't subscribed.
+	 */
+	bool unsubscribe(const node::shared_ptr<node::tcp::socket>& socket);
+
+	bool is_subscribed(const node::shared_ptr<node::tcp::socket>& socket) const;
+
+	std::size_t size() const noexcept;
+
+	/**
+	 * Serializes the payload into a single unmasked frame and sends it to all subscribers.
+	 *
+	 * @return The number of subscribers the frame was written or queued to.
+	 */
+	std::size_t broadcast(opcode op, const node::buffer_view& payload);
+
+	/**
+	 * Sends an already serialized frame (see websocket::encode()) to all subscribers.
+	 */
+	std::size_t broadcast(const node::buffer& frame);
+
+	uint64_t broadcasts() const noexcept;
+	uint64_t delivered() const noexcept;
+	uint64_t dropped() const noexcept;
+	uint64_t disconnected() const noexcept;
+
+	/**
+	 * Returns the time broadcast() took per call in microseconds.
+	 */
+	const node::util::histogram& duration() const noexcept;
+
+protected:
+	~broadcaster() override = default;
+
+	void _destroy() override;
+
+private:
+	struct subscriber {
+		node::shared_ptr<node::tcp::socket> socket;
+		void* destroy_iter;
+		void* drain_iter;
+
+		// frames held back by flood_policy::queue
+		std::vector<node::buffer> queue;
+	};
+
+	bool _send(subscriber& sub, const node::buffer& frame);
+	void _on_drain(node::tcp::socket* socket);
+	void _remove(node::tcp::socket* socket, bool is_destroyed);
+	void _compact();
+
+	std::vector<subscriber> _subscribers;
+	std::unordered_map<node::tcp::socket*, std::size_t> _index;
+	node::util::histogram _duration;
+
+	uint64_t _broadcasts;
+	uint64_t _delivered;
+	uint64_t _dropped;
+	uint64_t _disconnected;
+
+	std::size_t _max_queued;
+	flood_policy _policy;
+	bool _is_broadcasting;
+	bool _has_removed;
+};
+
+} // namespace websocket
+} // namespace node
+
+#endif // nodecc_websocket_broadcaster_h
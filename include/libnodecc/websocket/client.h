@@ -0,0 +1,153 @@
+#ifndef nodecc_websocket_client_h
+#define nodecc_websocket_client_h
+
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "../http/request.h"
+#include "../stream.h"
+#include "frame.h"
+
+
+namespace node {
+namespace websocket {
+
+/**
+ * A WebSocket client (RFC 6455), which upgrades a connection of the HTTP client.
+ *
+ * Every received message is emitted as a single data_event, whose type can be
+ * checked using is_text() while it's being emitted. Pausing the client stops
+ * reading from the socket, which thus exerts backpressure on the server.
+ * Messages sent by the client are masked as required by the protocol.
+ *
+ * The close_event is emitted once the connection is gone, with the status code of the
+ * server's close frame or 1006 if the connection was closed without one.
+ *
+ * Example:
+ *   auto ws = node::make_shared<node::websocket::client>(loop);
+ *   ws->on(node::websocket::client::open_event, [ws]() {
+ *       ws->send(node::websocket::opcode::text, "{\"subscribe\":\"ticker\"}"_view);
+ *   });
+ *   ws->on(node::websocket::client::data_event, [](const node::buffer& message) { ... });
+ *   ws->connect("ws://example.com/feed"_view);
+ */
+class client : public node::object, public node::stream::readable<client, node::buffer> {
+public:
+	static const node::events::symbol<void()> open_event;
+	static const node::events::symbol<void()> drain_event;
+	static const node::events::symbol<void(const std::error_code& err)> error_event;
+	static const node::events::symbol<void(uint16_t code, const node::buffer& reason)> close_event;
+
+
+	explicit client(node::loop& loop);
+
+	/**
+	 * Adds a header to the handshake request (e.g. "origin" or "sec-websocket-protocol").
+	 */
+	void set_header(const node::buffer& key, const node::buffer& value);
+
+	/**
+	 * Sets the maximum size of received messages, which defaults to 16 MiB.
+	 * Larger messages close the connection with status code 1009.
+	 */
+	void set_max_message_size(std::size_t size) noexcept;
+
+	/**
+	 * Connects to a "ws://" url. TLS (i.e. "wss://") isn't supported.
+	 *
+	 * @throws std::invalid_argument if the url is invalid.
+	 */
+	void connect(const node::buffer& url);
+	void connect(const sockaddr& addr, const node::buffer& host, const node::buffer& path);
+
+	bool is_open() const noexcept;
+
+	/**
+	 * Returns true if the message currently being emitted is a text message.
+	 */
+	bool is_text() const noexcept;
+
+	bool is_flooded() const noexcept;
+
+	/**
+	 * Sends a message in a single masked frame.
+	 *
+	 * @throws std::logic_error if the connection isn't open.
+	 * @return false if the socket is flooded, after which drain_event will be emitted.
+	 */
+	bool send(opcode op, const node::buffer_view& payload);
+
+	/**
+	 * Starts the closing handshake. The reason must not exceed 123 bytes.
+	 */
+	void close(uint16_t code = 1000, const node::buffer_view& reason = node::buffer_view());
+
+protected:
+	~client() override = default;
+
+	void _resume() override;
+	void _pause() override;
+	void _destroy() override;
+
+private:
+	enum class state : uint8_t {
+		initial,
+		connecting,
+		open,
+		closing,
+		closed,
+	};
+
+	void _on_connect(const std::error_code* err, const node::http::client::request& req, const node::http::client::response& res);
+	bool _verify(const node::http::incoming_message& res) const;
+	void _on_upgrade(const node::buffer& rest);
+	void _on_data(node::buffer data);
+	bool _process_frame_header(node::buffer& data);
+	void _process_control();
+	void _emit_message(const node::buffer& message);
+	void _fail(uint16_t code);
+	void _on_close();
+
+	bool _send_frame(opcode op, const node::buffer_view& payload);
+	void _random(uint8_t* data, std::size_t size);
+
+	node::loop& _loop;
+	node::shared_ptr<node::tcp::socket> _socket;
+	std::vector<std::pair<node::buffer, node::buffer>> _headers;
+	node::buffer _key;
+
+	// the frame currently being received and a partially received header of it
+	frame_header _frame;
+	uint64_t _frame_remaining;
+	uint8_t _header[max_header_size];
+	std::size_t _header_size;
+
+	node::mutable_buffer _message;
+	node::mutable_buffer _control;
+	std::size_t _max_message_size;
+
+	// data received while paused
+	node::buffer _pending;
+
+	node::buffer _close_reason;
+	uint16_t _close_code;
+
+	// random bytes for the masking keys, which are generated in batches
+	uint8_t _random_pool[256];
+	std::size_t _random_offset;
+
+	state _state;
+	opcode _message_op;
+	bool _is_text;
+	bool _in_frame;
+	bool _is_paused;
+	bool _close_sent;
+	bool _close_received;
+	bool _has_failed;
+};
+
+} // namespace websocket
+} // namespace node
+
+#endif // nodecc_websocket_client_h
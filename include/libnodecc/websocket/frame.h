@@ -0,0 +1,90 @@
+#ifndef nodecc_websocket_frame_h
+#define nodecc_websocket_frame_h
+
+#include <cstdint>
+
+#include "../buffer.h"
+
+
+namespace node {
+namespace websocket {
+
+enum class opcode : uint8_t {
+	continuation = 0x0,
+	text         = 0x1,
+	binary       = 0x2,
+	close        = 0x8,
+	ping         = 0x9,
+	pong         = 0xa,
+};
+
+
+/**
+ * The maximum size of a frame header (RFC 6455 §5.2):
+ * 2 bytes, a 64 bit extended payload length and a 32 bit masking key.
+ */
+const std::size_t max_header_size = 14;
+
+
+/**
+ * The header of a received frame.
+ */
+struct frame_header {
+	enum result : int {
+		error = -1,
+		incomplete = -2,
+	};
+
+	/**
+	 * Parses a frame header from the beginning of the data.
+	 *
+	 * @return The size of the header or a value of result.
+	 */
+	int parse(const uint8_t* data, std::size_t size) noexcept;
+
+	bool is_control() const noexcept;
+
+	uint64_t payload_size = 0;
+	uint8_t mask[4] = {};
+	opcode op = opcode::continuation;
+	bool fin = false;
+	bool rsv1 = false;
+	bool rsv2 = false;
+	bool rsv3 = false;
+	bool masked = false;
+};
+
+
+/**
+ * Returns the size of the header of a frame with the given payload size.
+ */
+std::size_t header_size(uint64_t payload_size, bool masked = false) noexcept;
+
+/**
+ * Writes a frame header into out, which must have room for at least max_header_size bytes.
+ *
+ * @param mask The masking key, which is required for frames sent by clients, or nullptr.
+ * @param rsv1 Set for compressed messages (RFC 7692 §6).
+ * @return The size of the header.
+ */
+std::size_t write_header(uint8_t* out, opcode op, uint64_t payload_size, bool fin = true, bool rsv1 = false, const uint8_t* mask = nullptr) noexcept;
+
+/**
+ * Serializes a complete, unmasked frame (as sent by servers) into a single buffer.
+ */
+node::buffer encode(opcode op, const node::buffer_view& payload, bool rsv1 = false);
+
+/**
+ * XORs the data with the masking key (RFC 6455 §5.3), which masks as well as unmasks it.
+ *
+ * The data is processed 32 or 16 bytes at a time, if AVX2 or SSE2 is enabled at
+ * compile time respectively (e.g. using -mavx2), and 8 bytes at a time otherwise.
+ *
+ * @param offset The position of data within the payload, if the payload is masked piecewise.
+ */
+void apply_mask(uint8_t* data, std::size_t size, const uint8_t mask[4], uint64_t offset = 0) noexcept;
+
+} // namespace websocket
+} // namespace node
+
+#endif // nodecc_websocket_frame_h
@@ -0,0 +1,163 @@
+#ifndef nodecc_websocket_permessage_deflate_h
+#define nodecc_websocket_permessage_deflate_h
+
+#include <memory>
+#include <vector>
+
+#include "../buffer.h"
+#include "frame.h"
+
+
+struct z_stream_s;
+
+
+namespace node {
+namespace websocket {
+
+struct deflate_options {
+	/*
+	 * Disabling context takeover resets the compressor after every message,
+	 * which costs some compression ratio, but allows the compressor state to be
+	 * shared between connections (see deflate_pool) instead of being kept per connection.
+	 * With window bits w each retained compressor uses about 2^(w+2) + 2^(mem_level+9) bytes
+	 * (about 256KiB for the defaults) and each decompressor about 2^w bytes.
+	 */
+	bool server_no_context_takeover = false;
+	bool client_no_context_takeover = false;
+
+	// between 9 and 15 - zlib doesn't support a compression window of 8 bits
+	uint8_t server_max_window_bits = 15;
+
+	// between 8 and 15 - only applied if the client supports it
+	uint8_t client_max_window_bits = 15;
+
+	// the zlib compression level and memory level
+	int8_t level = 6;
+	uint8_t mem_level = 8;
+
+	// messages smaller than this are sent uncompressed
+	std::size_t threshold = 128;
+
+	// decompressed messages larger than this are rejected
+	std::size_t max_message_size = 16 * 1024 * 1024;
+};
+
+
+/**
+ * Recycles zlib streams for connections without context takeover,
+ * which thus only need a compressor or decompressor while processing a message.
+ *
+ * A pool may be shared by any number of connections of the same loop,
+ * but must not be used by multiple threads.
+ */
+class deflate_pool {
+public:
+	explicit deflate_pool(std::size_t max_idle = 64);
+	~deflate_pool();
+
+	deflate_pool(const deflate_pool&) = delete;
+	deflate_pool& operator=(const deflate_pool&) = delete;
+
+	/**
+	 * Returns a compressor (or decompressor if inflate is true) with the given parameters.
+	 *
+	 * @return nullptr if zlib failed to allocate one.
+	 */
+	z_stream_s* acquire(bool inflate, int level, int window_bits, int mem_level);
+
+	/**
+	 * Resets the stream and keeps it for reuse, or frees it if enough are idle already.
+	 */
+	void release(z_stream_s* stream);
+
+	std::size_t idle() const noexcept;
+
+private:
+	struct entry {
+		z_stream_s* stream;
+		int key;
+	};
+
+	std::vector<entry> _idle;
+	std::size_t _max_idle;
+};
+
+
+/**
+ * The permessage-deflate extension (RFC 7692) of a single connection on the server side.
+ *
+ * Example:
+ *   node::websocket::permessage_deflate deflate(options, pool);
+ *
+ *   if (deflate.negotiate(req->header("sec-websocket-extensions"_view))) {
+ *       res->set_header("sec-websocket-extensions"_view, deflate.response());
+ *   }
+ *
+ *   socket->write(deflate.encode(node::websocket::opcode::text, json));
+ */
+class permessage_deflate {
+public:
+	explicit permessage_deflate(const deflate_options& options = deflate_options(), const std::shared_ptr<deflate_pool>& pool = nullptr);
+	~permessage_deflate();
+
+	permessage_deflate(const permessage_deflate&) = delete;
+	permessage_deflate& operator=(const permessage_deflate&) = delete;
+
+	/**
+	 * Selects the first acceptable offer of the "sec-websocket-extensions" request header.
+	 *
+	 * @return false if the client didn't offer permessage-deflate or none of the offers is acceptable.
+	 */
+	bool negotiate(const node::buffer_view& offers);
+
+	/**
+	 * Returns the value for the "sec-websocket-extensions" response header.
+	 */
+	const node::buffer& response() const noexcept;
+
+	bool is_enabled() const noexcept;
+
+	/**
+	 * Returns the parameters in effect after negotiate().
+	 */
+	const deflate_options& options() const noexcept;
+
+	/**
+	 * Serializes a message into a single frame, which is compressed (and marked with RSV1)
+	 * if the extension is enabled, the message isn't a control message and not below the threshold.
+	 */
+	node::buffer encode(opcode op, const node::buffer_view& payload);
+
+	/**
+	 * Compresses the payload of a message, excluding the trailing 0x00 0x00 0xff 0xff.
+	 *
+	 * @return An empty buffer if zlib failed.
+	 */
+	node::buffer compress(const node::buffer_view& payload);
+
+	/**
+	 * Decompresses the payload of a message, whose first frame had RSV1 set.
+	 *
+	 * @return false if the data is corrupt or larger than max_message_size.
+	 */
+	bool decompress(const node::buffer_view& payload, node::mutable_buffer& out);
+
+private:
+	z_stream_s* _acquire(bool inflate);
+	void _release(z_stream_s*& stream, bool reuse);
+
+	deflate_options _options;
+	std::shared_ptr<deflate_pool> _pool;
+	node::buffer _response;
+
+	// streams kept between messages due to context takeover
+	z_stream_s* _deflate;
+	z_stream_s* _inflate;
+
+	bool _is_enabled;
+};
+
+} // namespace websocket
+} // namespace node
+
+#endif // nodecc_websocket_permessage_deflate_h
@@ -21,6 +21,11 @@
 					'deps',
 				],
 			},
+			'link_settings': {
+				'libraries': [
+					'-lz',
+				],
+			},
 			'sources': [
 				'deps/http-parser/http_parser.h',
 				'deps/http-parser/http_parser.c',
@@ -45,15 +50,31 @@
 				'include/libnodecc/fs/read_stream.h',
 				'include/libnodecc/fs/watcher.h',
 				'include/libnodecc/http/_http_date_buffer.h',
+				'include/libnodecc/http/access_log.h',
+				'include/libnodecc/http/body_sink.h',
+				'include/libnodecc/http/cookies.h',
+				'include/libnodecc/http/etag.h',
+				'include/libnodecc/http/event_stream.h',
+				'include/libnodecc/http/header_list.h',
 				'include/libnodecc/http/incoming_message.h',
+				'include/libnodecc/http/metrics.h',
+				'include/libnodecc/http/multipart_parser.h',
 				'include/libnodecc/http/outgoing_message.h',
+				'include/libnodecc/http/proxy.h',
 				'include/libnodecc/http/request.h',
+				'include/libnodecc/http/request_parser.h',
+				'include/libnodecc/http/response_cache.h',
 				'include/libnodecc/http/server.h',
+				'include/libnodecc/http/static_response.h',
+				'include/libnodecc/http/urlencoded_parser.h',
+				'include/libnodecc/http/worker_pool.h',
 				'include/libnodecc/loop.h',
 				'include/libnodecc/object.h',
 				'include/libnodecc/os/if_flags.h',
 				'include/libnodecc/os/interface_addresses.h',
 				'include/libnodecc/stream.h',
+				'include/libnodecc/tcp/address_counter.h',
+				'include/libnodecc/tcp/forwarder.h',
 				'include/libnodecc/tcp/server.h',
 				'include/libnodecc/tcp/socket.h',
 				'include/libnodecc/udp/socket.h',
@@ -64,6 +85,8 @@
 				'include/libnodecc/util/endian.h',
 				'include/libnodecc/util/fnv.h',
 				'include/libnodecc/util/function_traits.h',
+				'include/libnodecc/util/histogram.h',
+				'include/libnodecc/util/lag_monitor.h',
 				'include/libnodecc/util/math.h',
 				'include/libnodecc/util/raw_vector.h',
 				'include/libnodecc/util/sha1.h',
@@ -73,6 +96,10 @@
 				'include/libnodecc/uv/handle.h',
 				'include/libnodecc/uv/queue_work.h',
 				'include/libnodecc/uv/stream.h',
+				'include/libnodecc/websocket/broadcaster.h',
+				'include/libnodecc/websocket/client.h',
+				'include/libnodecc/websocket/frame.h',
+				'include/libnodecc/websocket/permessage_deflate.h',
 
 				'src/buffer/buffer.cc',
 				'src/buffer/buffer_view.cc',
@@ -86,25 +113,47 @@
 				'src/events/emitter.cc',
 				'src/fs/watcher.cc',
 				'src/http/_http_date_buffer.cc',
+				'src/http/access_log.cc',
+				'src/http/body_sink.cc',
+				'src/http/cookies.cc',
+				'src/http/etag.cc',
+				'src/http/event_stream.cc',
+				'src/http/header_list.cc',
 				'src/http/incoming_message.cc',
+				'src/http/metrics.cc',
+				'src/http/multipart_parser.cc',
 				'src/http/outgoing_message.cc',
+				'src/http/proxy.cc',
 				'src/http/request.cc',
+				'src/http/request_parser.cc',
+				'src/http/response_cache.cc',
 				'src/http/server.cc',
+				'src/http/static_response.cc',
+				'src/http/urlencoded_parser.cc',
+				'src/http/worker_pool.cc',
 				'src/loop.cc',
 				'src/object.cc',
 				'src/os/interface_addresses.cc',
 				'src/stream.cc',
+				'src/tcp/address_counter.cc',
+				'src/tcp/forwarder.cc',
 				'src/tcp/server.cc',
 				'src/tcp/socket.cc',
 				'src/udp/socket.cc',
 				'src/util/base64.cc',
 				'src/util/crc32c.cc',
+				'src/util/histogram.cc',
+				'src/util/lag_monitor.cc',
 				'src/util/math.cc',
 				'src/util/sha1.cc',
 				'src/util/timer.cc',
 				'src/util/uri.cc',
 				'src/uv/async.cc',
 				'src/uv/queue_work.cc',
+				'src/websocket/broadcaster.cc',
+				'src/websocket/client.cc',
+				'src/websocket/frame.cc',
+				'src/websocket/permessage_deflate.cc',
 			],
 			'xcode_settings': {
 				'CLANG_CXX_LANGUAGE_STANDARD': 'c++11',
@@ -118,6 +167,23 @@
 		},
 
 
+		{
+			'target_name': 'run-benchmarks',
+			'type': 'executable',
+			'dependencies': [ 'libnodecc' ],
+			'sources': [
+				'bench/http_chunked.cc',
+				'bench/http_parser.cc',
+				'bench/main.cc',
+			],
+			'msvs-settings': {
+				'VCLinkerTool': {
+					'SubSystem': 1, # /subsystem:console
+				},
+			},
+		},
+
+
 		{
 			'target_name': 'run-tests',
 			'type': 'executable',
@@ -128,7 +194,21 @@
 			'sources': [
 				'test/buffer.cc',
 				'test/events.cc',
+				'test/http_cookies.cc',
+				'test/http_header_list.cc',
+				'test/http_multipart_parser.cc',
+				'test/http_request_parser.cc',
+				'test/http_response_cache.cc',
+				'test/http_static_response.cc',
+				'test/http_urlencoded_parser.cc',
+				'test/loop.cc',
 				'test/main.cc',
+				'test/tcp_address_counter.cc',
+				'test/util_base64.cc',
+				'test/util_histogram.cc',
+				'test/util_sha1.cc',
+				'test/websocket_frame.cc',
+				'test/websocket_permessage_deflate.cc',
 			],
 			'msvs-settings': {
 				'VCLinkerTool': {
@@ -3,6 +3,12 @@
 
 namespace node {
 
+hashed_buffer& hashed_buffer::operator=(const hashed_buffer& other) {
+	buffer::operator=(other);
+	this->_hash = other.const_hash();
+	return *this;
+}
+
 hashed_buffer& hashed_buffer::operator=(const buffer_view& other) {
 	buffer::operator=(other);
 	this->_hash = 0;
@@ -22,8 +22,9 @@ event_handler_root::~event_handler_root() {
 		if (tmp->ref_count == 0) {
 			delete tmp;
 		} else {
-			// prevent emit() from advancing
+			// prevent emit() from advancing and let it delete the handler once it returned
 			tmp->next = nullptr;
+			tmp->ref_count |= event_handler_base::delete_flag;
 		}
 	}
 }
@@ -59,8 +60,9 @@ void event_handler_root::erase(iterator it) noexcept {
 	if (it->ref_count == 0) {
 		delete it._curr;
 	} else {
-		// prevent emit() from advancing
+		// prevent emit() from advancing and let it delete the handler once it returned
 		it->next = nullptr;
+		it->ref_count |= event_handler_base::delete_flag;
 	}
 }
 
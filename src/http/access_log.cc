@@ -0,0 +1,223 @@
+#include "libnodecc/http/access_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+
+#ifndef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 199506L
+#endif
+#include <ctime>
+#ifdef __STDC_WANT_SECURE_LIB__
+# define gmtime_r(timep, result) gmtime_s(result, timep)
+#endif
+
+#include "libnodecc/uv/queue_work.h"
+
+
+namespace {
+
+// formatted records are written in batches of about this size
+const std::size_t batch_size = 64 * 1024;
+
+// a formatted line is at most about 350 bytes long
+const std::size_t max_line_size = 512;
+
+
+bool write_all(uv_loop_t* loop, uv_file file, char* data, std::size_t size) {
+	while (size > 0) {
+		uv_fs_t req;
+		uv_buf_t buf = uv_buf_init(data, static_cast<unsigned int>(size));
+
+		const int r = uv_fs_write(loop, &req, file, &buf, 1, -1, nullptr);
+		uv_fs_req_cleanup(&req);
+
+		if (r <= 0) {
+			return false;
+		}
+
+		data += r;
+		size -= std::size_t(r);
+	}
+
+	return true;
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+access_log::access_log(node::loop& loop, const node::buffer_view& path, std::size_t capacity, uint64_t flush_interval) : _loop(loop), _capacity(capacity ? capacity : 1), _dropped(0), _time_offset(0), _file(-1), _active(0), _is_writing(false), _is_flush_pending(false) {
+	node::mutable_buffer buf;
+	buf.set_capacity(path.size() + 1);
+	buf.append(path.data(), path.size());
+	buf.push_back('\0');
+
+	uv_fs_t req;
+	const int r = uv_fs_open(loop, &req, buf.data<char>(), O_WRONLY | O_CREAT | O_APPEND, 0644, nullptr);
+	uv_fs_req_cleanup(&req);
+
+	node::uv::check(r);
+	this->_file = r;
+
+	this->_records[0].reserve(this->_capacity);
+	this->_records[1].reserve(this->_capacity);
+
+	// uv_now() is a lot cheaper than reading the wall clock for every record
+	const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+	this->_time_offset = uint64_t(now.count()) - uv_now(loop);
+
+	if (flush_interval) {
+		this->_timer = node::make_shared<node::util::timer>(loop);
+
+		this->_timer->on(node::util::timer::timeout_event, [this]() {
+			this->flush();
+		});
+
+		this->_timer->start(flush_interval, flush_interval);
+
+		// the log alone shouldn't keep the loop alive
+		this->_timer->unref();
+	}
+}
+
+access_log::~access_log() {
+	if (this->_file >= 0) {
+		uv_fs_t req;
+		uv_fs_close(this->_loop, &req, this->_file, nullptr);
+		uv_fs_req_cleanup(&req);
+	}
+}
+
+void access_log::log(const node::buffer_view& method, const node::buffer_view& path, uint16_t status, uint64_t bytes, uint64_t latency) {
+	if (this->_records[this->_active].size() == this->_capacity) {
+		this->flush();
+
+		// flush() didn't swap the buffers, since the previous write is still in progress
+		if (this->_records[this->_active].size() == this->_capacity) {
+			this->_dropped++;
+			return;
+		}
+	}
+
+	auto& records = this->_records[this->_active];
+	records.emplace_back();
+
+	record& r = records.back();
+	r.time = this->_time_offset + uv_now(this->_loop);
+	r.latency = latency;
+	r.bytes = bytes;
+	r.status = status;
+	r.method_size = uint8_t(std::min(method.size(), sizeof(r.method)));
+	r.path_size = uint8_t(std::min(path.size(), sizeof(r.path)));
+
+	memcpy(r.method, method.data(), r.method_size);
+	memcpy(r.path, path.data(), r.path_size);
+}
+
+void access_log::flush() {
+	if (this->_is_writing) {
+		this->_is_flush_pending = true;
+		return;
+	}
+
+	auto& records = this->_records[this->_active];
+
+	if (records.empty() || this->_file < 0) {
+		return;
+	}
+
+	this->_active ^= 1;
+	this->_is_writing = true;
+	this->_is_flush_pending = false;
+
+	// the inactive buffer isn't touched by the loop thread until after_cb
+	uv_loop_t* loop = this->_loop;
+	const uv_file file = this->_file;
+
+	this->retain();
+
+	node::uv::queue_work(this->_loop, [loop, file, &records]() {
+		access_log::_write(loop, file, records);
+	}, [this, &records]() {
+		records.clear();
+		this->_is_writing = false;
+
+		if (this->_is_flush_pending) {
+			this->flush();
+		}
+
+		this->release();
+	});
+}
+
+std::size_t access_log::dropped() const noexcept {
+	return this->_dropped;
+}
+
+void access_log::_destroy() {
+	if (this->_timer) {
+		this->_timer->destroy();
+		this->_timer.reset();
+	}
+
+	// write the remaining records - the destructor will wait for it
+	this->flush();
+
+	object::_destroy();
+}
+
+void access_log::_write(uv_loop_t* loop, uv_file file, const std::vector<record>& records) {
+	std::vector<char> buf(batch_size + max_line_size);
+	std::size_t size = 0;
+
+	uint64_t last_second = UINT64_MAX;
+	char date[32] = {};
+
+	for (const auto& r : records) {
+		const uint64_t second = r.time / 1000;
+
+		// records are sorted by time and thus mostly share the same second
+		if (second != last_second) {
+			const time_t ts = time_t(second);
+			tm t;
+			gmtime_r(&ts, &t);
+			strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &t);
+			last_second = second;
+		}
+
+		const int n = snprintf(buf.data() + size, max_line_size, "%s.%03uZ %.*s %.*s %u %llu %llu.%03u\n",
+			date,
+			unsigned(r.time % 1000),
+			int(r.method_size), r.method,
+			int(r.path_size), r.path,
+			unsigned(r.status),
+			static_cast<unsigned long long>(r.bytes),
+			static_cast<unsigned long long>(r.latency / 1000),
+			unsigned(r.latency % 1000)
+		);
+
+		if (n > 0) {
+			size += std::min(std::size_t(n), max_line_size - 1);
+		}
+
+		if (size >= batch_size) {
+			if (!write_all(loop, file, buf.data(), size)) {
+				return;
+			}
+
+			size = 0;
+		}
+	}
+
+	if (size > 0) {
+		write_all(loop, file, buf.data(), size);
+	}
+}
+
+} // namespace http
+} // namespace node
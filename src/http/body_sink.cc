@@ -0,0 +1,444 @@
+#include "libnodecc/http/body_sink.h"
+
+#include <algorithm>
+#include <fcntl.h>
+
+#include "libnodecc/error.h"
+
+
+namespace {
+
+// uv_fs_write() falls back to multiple syscalls above IOV_MAX (usually 1024)
+const std::size_t max_iovs = 1024;
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+body_sink::body_sink(node::loop& loop, std::size_t memory_limit, uint64_t size_limit) : _loop(loop), _socket_destroy_iter(nullptr), _chunks_size(0), _memory_limit(memory_limit), _batch_size(1024 * 1024), _size_limit(size_limit), _size(0), _file_size(0), _file(-1), _is_consuming(false), _is_writing(false), _is_paused(false), _has_ended(false), _has_failed(false) {
+}
+
+body_sink::~body_sink() {
+	if (this->_file >= 0) {
+		uv_fs_t req;
+		uv_fs_close(this->_loop, &req, this->_file, nullptr);
+		uv_fs_req_cleanup(&req);
+	}
+}
+
+void body_sink::set_directory(const std::string& directory) {
+	this->_directory = directory;
+}
+
+void body_sink::set_batch_size(std::size_t size) {
+	this->_batch_size = size ? size : 1;
+}
+
+void body_sink::consume(incoming_message& msg, consume_t callback) {
+	// released by _finish()
+	this->retain();
+
+	this->_callback = std::move(callback);
+	this->_socket = msg.socket();
+	this->_is_consuming = true;
+
+	/*
+	 * The listeners are removed together with all others once the message is detached.
+	 * Neither event is emitted anymore after the end or the destruction of the socket.
+	 */
+	msg.on(msg.data_event, [this](const node::buffer& chunk) {
+		this->_on_data(chunk);
+	});
+
+	msg.on(msg.end_event, [this]() {
+		this->_on_end();
+	});
+
+	if (this->_socket) {
+		this->_socket_destroy_iter = this->_socket->on(node::tcp::socket::destroy_event, [this]() {
+			this->_on_socket_destroy();
+		});
+	}
+}
+
+uint64_t body_sink::size() const noexcept {
+	return this->_size;
+}
+
+bool body_sink::is_spilled() const noexcept {
+	return this->_file >= 0;
+}
+
+const node::buffer& body_sink::buffer() const noexcept {
+	return this->_buffer;
+}
+
+uv_file body_sink::file() const noexcept {
+	return this->_file;
+}
+
+node::shared_ptr<body_stream> body_sink::stream(std::size_t chunk_size) {
+	return node::make_shared<body_stream>(*this, chunk_size);
+}
+
+void body_sink::_on_data(const node::buffer& chunk) {
+	if (this->_has_failed || chunk.size() == 0) {
+		return;
+	}
+
+	this->_size += chunk.size();
+
+	if (this->_size > this->_size_limit) {
+		this->_fail(std::make_error_code(std::errc::message_size));
+		return;
+	}
+
+	this->_chunks.emplace_back(chunk);
+	this->_chunks_size += chunk.size();
+
+	if (this->_file < 0 && (this->_chunks_size <= this->_memory_limit || !this->_open())) {
+		return;
+	}
+
+	if (this->_chunks_size >= this->_batch_size) {
+		this->_flush();
+	}
+
+	// the write in progress can't keep up - wait until it has finished
+	if (this->_is_writing && this->_chunks_size >= 2 * this->_batch_size && !this->_is_paused && this->_socket) {
+		this->_is_paused = true;
+		this->_socket->pause();
+	}
+}
+
+void body_sink::_on_end() {
+	this->_has_ended = true;
+
+	if (!this->_has_failed) {
+		if (this->_file >= 0) {
+			this->_flush();
+		} else if (this->_chunks.size() == 1) {
+			this->_buffer = this->_chunks.front();
+			this->_chunks.clear();
+		} else if (!this->_chunks.empty()) {
+			node::mutable_buffer body(this->_chunks_size);
+
+			for (const auto& chunk : this->_chunks) {
+				body.append(chunk.data(), chunk.size());
+			}
+
+			this->_buffer = body;
+			this->_chunks.clear();
+		}
+	}
+
+	this->_finish();
+}
+
+void body_sink::_on_socket_destroy() {
+	// the listener is currently being emitted and is removed by the destruction anyways
+	this->_socket_destroy_iter = nullptr;
+
+	// the callback isn't called if the connection is closed prematurely
+	this->_has_ended = true;
+	this->_has_failed = true;
+	this->_chunks.clear();
+
+	this->_finish();
+}
+
+void body_sink::_fail(const std::error_code& err) {
+	this->_has_failed = true;
+	this->_chunks.clear();
+	this->_chunks_size = 0;
+
+	// the remaining body is discarded
+	if (this->_is_paused) {
+		this->_is_paused = false;
+		this->_socket->resume();
+	}
+
+	// see uv::handle<>
+	consume_t callback;
+	callback.swap(this->_callback);
+
+	if (callback) {
+		callback(&err);
+	}
+}
+
+/*
+ * Opens an anonymous temporary file, which is released by the
+ * file system as soon as its last descriptor has been closed.
+ * The file is opened synchronously, since this is only done once per spilled body.
+ */
+bool body_sink::_open() {
+	std::string directory = this->_directory;
+
+	if (directory.empty()) {
+		char buf[4096];
+		std::size_t size = sizeof(buf);
+
+		directory = uv_os_tmpdir(buf, &size) == 0 ? std::string(buf, size) : "/tmp";
+	}
+
+	uv_fs_t req;
+	int r = UV_ENOSYS;
+
+#ifdef O_TMPFILE
+	r = uv_fs_open(this->_loop, &req, directory.c_str(), O_TMPFILE | O_RDWR, 0600, nullptr);
+	uv_fs_req_cleanup(&req);
+#endif
+
+	// O_TMPFILE isn't supported by all file systems
+	if (r < 0) {
+		const std::string tpl = directory + "/nodecc-body-XXXXXX";
+
+		r = uv_fs_mkstemp(this->_loop, &req, tpl.c_str(), nullptr);
+
+		if (r >= 0) {
+			uv_fs_t unlink_req;
+			uv_fs_unlink(this->_loop, &unlink_req, req.path, nullptr);
+			uv_fs_req_cleanup(&unlink_req);
+		}
+
+		uv_fs_req_cleanup(&req);
+	}
+
+	if (r < 0) {
+		this->_fail(node::uv::to_error(r));
+		return false;
+	}
+
+	this->_file = r;
+	return true;
+}
+
+void body_sink::_flush() {
+	if (this->_is_writing || this->_chunks.empty()) {
+		return;
+	}
+
+	std::size_t count = 0;
+	std::size_t size = 0;
+
+	do {
+		size += this->_chunks[count].size();
+		count++;
+	} while (count < this->_chunks.size() && count < max_iovs && size < this->_batch_size);
+
+	this->_writing.assign(std::make_move_iterator(this->_chunks.begin()), std::make_move_iterator(this->_chunks.begin() + count));
+	this->_chunks.erase(this->_chunks.begin(), this->_chunks.begin() + count);
+	this->_chunks_size -= size;
+
+	this->_iovs.clear();
+
+	for (const auto& chunk : this->_writing) {
+		this->_iovs.emplace_back(uv_buf_init(const_cast<char*>(chunk.data<char>()), static_cast<unsigned int>(chunk.size())));
+	}
+
+	this->_write_req.data = this;
+
+	const int r = uv_fs_write(this->_loop, &this->_write_req, this->_file, this->_iovs.data(), static_cast<unsigned int>(this->_iovs.size()), int64_t(this->_file_size), [](uv_fs_t* req) {
+		const auto self = static_cast<body_sink*>(req->data);
+		const ssize_t result = req->result;
+
+		uv_fs_req_cleanup(req);
+		self->_on_write(result);
+	});
+
+	if (r < 0) {
+		this->_writing.clear();
+		this->_fail(node::uv::to_error(r));
+		return;
+	}
+
+	this->_is_writing = true;
+}
+
+void body_sink::_on_write(ssize_t result) {
+	this->_is_writing = false;
+
+	if (this->_has_failed) {
+		this->_writing.clear();
+		this->_finish();
+		return;
+	}
+
+	if (result < 0) {
+		this->_writing.clear();
+		this->_fail(node::uv::to_error(int(result)));
+		this->_finish();
+		return;
+	}
+
+	this->_file_size += uint64_t(result);
+
+	/*
+	 * A short write leaves the remainder of the batch, which is requeued
+	 * in front of the pending chunks and written again at the new offset.
+	 * A write without any progress is treated as an error, since it would be retried forever.
+	 */
+	std::size_t written = std::size_t(result);
+	auto it = this->_writing.begin();
+
+	for (; it != this->_writing.end() && written >= it->size(); ++it) {
+		written -= it->size();
+	}
+
+	if (it != this->_writing.end()) {
+		if (result == 0) {
+			this->_writing.clear();
+			this->_fail(std::make_error_code(std::errc::io_error));
+			this->_finish();
+			return;
+		}
+
+		*it = it->slice(written);
+
+		for (auto rest = it; rest != this->_writing.end(); ++rest) {
+			this->_chunks_size += rest->size();
+		}
+
+		this->_chunks.insert(this->_chunks.begin(), std::make_move_iterator(it), std::make_move_iterator(this->_writing.end()));
+	}
+
+	this->_writing.clear();
+
+	if (this->_has_ended) {
+		this->_flush();
+		this->_finish();
+		return;
+	}
+
+	if (this->_chunks_size >= this->_batch_size) {
+		this->_flush();
+	}
+
+	if (this->_is_paused && this->_chunks_size < 2 * this->_batch_size) {
+		this->_is_paused = false;
+		this->_socket->resume();
+	}
+}
+
+/*
+ * Completes consume() once the message has ended and all writes have finished.
+ */
+void body_sink::_finish() {
+	if (!this->_is_consuming || !this->_has_ended || this->_is_writing) {
+		return;
+	}
+
+	this->_is_consuming = false;
+
+	if (this->_socket) {
+		this->_socket->off(node::tcp::socket::destroy_event, this->_socket_destroy_iter);
+
+		if (this->_is_paused) {
+			this->_is_paused = false;
+			this->_socket->resume();
+		}
+	}
+
+	this->_socket.reset();
+
+	// see uv::handle<>
+	consume_t callback;
+	callback.swap(this->_callback);
+
+	if (callback && !this->_has_failed) {
+		callback(nullptr);
+	}
+
+	this->release();
+}
+
+
+decltype(body_stream::error_event) body_stream::error_event;
+
+
+body_stream::body_stream(body_sink& sink, std::size_t chunk_size) : _sink(sink), _offset(0), _chunk_size(chunk_size ? chunk_size : 1), _is_reading(false) {
+	// body_sink::_file is closed by its destructor
+	this->_sink.retain();
+}
+
+body_stream::~body_stream() {
+	this->_sink.release();
+}
+
+void body_stream::_resume() {
+	if (this->_sink._file < 0) {
+		if (this->has_ended()) {
+			return;
+		}
+
+		if (this->_sink._buffer) {
+			this->emit(data_event, this->_sink._buffer);
+		}
+
+		this->_set_reading_ended();
+	} else if (!this->_is_reading) {
+		this->_read();
+	}
+}
+
+void body_stream::_pause() {
+	// a read in progress is still emitted, after which no further one is started
+}
+
+void body_stream::_read() {
+	const uint64_t remaining = this->_sink._file_size - this->_offset;
+
+	if (remaining == 0) {
+		this->_set_reading_ended();
+		return;
+	}
+
+	// a new buffer is used for every read, since the previous one might still be referenced
+	this->_chunk = node::buffer(std::size_t(std::min<uint64_t>(remaining, this->_chunk_size)));
+
+	uv_buf_t buf = uv_buf_init(this->_chunk.data<char>(), static_cast<unsigned int>(this->_chunk.size()));
+	this->_req.data = this;
+
+	const int r = uv_fs_read(this->_sink._loop, &this->_req, this->_sink._file, &buf, 1, int64_t(this->_offset), [](uv_fs_t* req) {
+		const auto self = static_cast<body_stream*>(req->data);
+		const ssize_t result = req->result;
+
+		uv_fs_req_cleanup(req);
+		self->_is_reading = false;
+
+		if (result < 0) {
+			self->emit(error_event, node::uv::to_error(int(result)));
+		} else if (result == 0) {
+			// the file has been truncated by someone else
+			self->_set_reading_ended();
+		} else {
+			const node::buffer chunk = self->_chunk.slice(0, std::size_t(result));
+			self->_chunk.reset();
+			self->_offset += uint64_t(result);
+			self->emit(data_event, chunk);
+
+			if (self->is_consuming() && !self->_is_reading) {
+				self->_read();
+			}
+		}
+
+		// retained by _read()
+		self->release();
+	});
+
+	if (r < 0) {
+		this->_chunk.reset();
+		this->emit(error_event, node::uv::to_error(r));
+		return;
+	}
+
+	// the request refers to this instance until it has finished
+	this->retain();
+	this->_is_reading = true;
+}
+
+} // namespace http
+} // namespace node
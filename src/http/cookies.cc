@@ -0,0 +1,199 @@
+#include "libnodecc/http/cookies.h"
+
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+
+bool is_whitespace(uint8_t ch) {
+	return ch == ' ' || ch == '\t';
+}
+
+/*
+ * Returns false if the string contains control characters (including CR and LF) or a ";",
+ * which would allow injecting attributes or further header fields.
+ * Names additionally must not contain "=", "," or whitespace.
+ */
+bool is_valid(const node::buffer_view& str, bool is_name) {
+	for (const uint8_t ch : str) {
+		if (ch < 0x20 || ch == 0x7f || ch == ';' || (is_name && (ch == '=' || ch == ',' || ch == ' '))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+cookies::cookies() : _is_parsed(false) {
+}
+
+node::buffer cookies::serialize(const node::buffer_view& name, const node::buffer_view& value, const cookie_attributes& attributes) {
+	static const node::buffer_view same_site_values[] = {
+		node::buffer_view(),
+		node::buffer_view("; SameSite=Lax", 14),
+		node::buffer_view("; SameSite=Strict", 17),
+	};
+
+	if (!name || !is_valid(name, true) || !is_valid(value, false) || !is_valid(attributes.domain, false) || !is_valid(attributes.path, false)) {
+		throw std::invalid_argument("invalid cookie");
+	}
+
+	const node::buffer_view& same_site = same_site_values[attributes.same_site];
+
+	// "; Max-Age=" plus up to 20 digits, "; Secure" and "; HttpOnly"
+	std::size_t capacity = name.size() + 1 + value.size() + 30 + 8 + 10 + same_site.size();
+
+	if (attributes.domain) {
+		capacity += 9 + attributes.domain.size();
+	}
+
+	if (attributes.path) {
+		capacity += 7 + attributes.path.size();
+	}
+
+	node::mutable_buffer buf(capacity);
+	buf.append(name.data(), name.size());
+	buf.push_back('=');
+	buf.append(value.data(), value.size());
+
+	if (attributes.domain) {
+		buf.append("; Domain=", 9);
+		buf.append(attributes.domain.data(), attributes.domain.size());
+	}
+
+	if (attributes.path) {
+		buf.append("; Path=", 7);
+		buf.append(attributes.path.data(), attributes.path.size());
+	}
+
+	if (attributes.max_age >= 0) {
+		buf.append("; Max-Age=", 10);
+		buf.append_number(std::size_t(attributes.max_age));
+	}
+
+	if (attributes.secure) {
+		buf.append("; Secure", 8);
+	}
+
+	if (attributes.http_only) {
+		buf.append("; HttpOnly", 10);
+	}
+
+	if (same_site.size()) {
+		buf.append(same_site.data(), same_site.size());
+	}
+
+	return buf;
+}
+
+void cookies::set_header(const node::buffer& header) noexcept {
+	this->_cookies.clear();
+	this->_header = header;
+	this->_is_parsed = false;
+}
+
+const node::buffer* cookies::find(const node::buffer_view& name) {
+	this->_parse();
+
+	for (const auto& cookie : this->_cookies) {
+		if (cookie.first.equals(name)) {
+			return &cookie.second;
+		}
+	}
+
+	return nullptr;
+}
+
+const node::buffer& cookies::get(const node::buffer_view& name) {
+	static const node::buffer empty;
+	const node::buffer* value = this->find(name);
+	return value ? *value : empty;
+}
+
+bool cookies::has(const node::buffer_view& name) {
+	return this->find(name) != nullptr;
+}
+
+const std::vector<cookies::value_type>& cookies::all() {
+	this->_parse();
+	return this->_cookies;
+}
+
+void cookies::clear() noexcept {
+	this->_cookies.clear();
+	this->_header.reset();
+	this->_is_parsed = false;
+}
+
+/*
+ * Parses a "cookie-string" as per RFC 6265 §5.4, i.e.
+ * "name=value" pairs, delimited by ";" and optional whitespace.
+ * Pairs without a "=" are ignored and double quotes around values are removed.
+ */
+void cookies::_parse() {
+	if (this->_is_parsed) {
+		return;
+	}
+
+	this->_is_parsed = true;
+
+	const uint8_t* base = this->_header.data();
+	const uint8_t* p = base;
+	const uint8_t* end = this->_header.end();
+
+	while (p != end) {
+		while (p != end && (*p == ';' || is_whitespace(*p))) {
+			p++;
+		}
+
+		const uint8_t* pair_end = static_cast<const uint8_t*>(memchr(p, ';', std::size_t(end - p)));
+
+		if (!pair_end) {
+			pair_end = end;
+		}
+
+		const uint8_t* eq = static_cast<const uint8_t*>(memchr(p, '=', std::size_t(pair_end - p)));
+
+		if (eq) {
+			const uint8_t* name_end = eq;
+			const uint8_t* value_beg = eq + 1;
+			const uint8_t* value_end = pair_end;
+
+			while (name_end != p && is_whitespace(name_end[-1])) {
+				name_end--;
+			}
+
+			while (value_beg != value_end && is_whitespace(*value_beg)) {
+				value_beg++;
+			}
+
+			while (value_end != value_beg && is_whitespace(value_end[-1])) {
+				value_end--;
+			}
+
+			if (value_end - value_beg >= 2 && *value_beg == '"' && value_end[-1] == '"') {
+				value_beg++;
+				value_end--;
+			}
+
+			if (name_end != p) {
+				this->_cookies.emplace_back(
+					this->_header.slice(std::size_t(p - base), std::size_t(name_end - base)),
+					this->_header.slice(std::size_t(value_beg - base), std::size_t(value_end - base))
+				);
+			}
+		}
+
+		p = pair_end;
+	}
+}
+
+} // namespace http
+} // namespace node
@@ -0,0 +1,99 @@
+#include "libnodecc/http/etag.h"
+
+#include "libnodecc/util/crc32c.h"
+
+
+namespace {
+
+/*
+ * Strips the weak indicator "W/" from an entity tag.
+ */
+node::buffer_view opaque_tag(const node::buffer_view& tag) {
+	if (tag.size() >= 2 && tag[0] == 'W' && tag[1] == '/') {
+		return tag.slice(2);
+	}
+
+	return tag;
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+node::buffer etag::generate(const node::buffer bufs[], std::size_t bufcnt) {
+	node::util::crc32c crc;
+	std::size_t size = 0;
+
+	for (std::size_t i = 0; i < bufcnt; i++) {
+		node::buffer_view view(bufs[i]);
+		crc.push(view);
+		size += view.size();
+	}
+
+	node::mutable_buffer buf;
+	buf.set_capacity(2 + 16 + 1 + 8);
+	buf.push_back('"');
+	buf.append_number(size, 16);
+	buf.push_back('-');
+	buf.append_number(crc.checksum(), 16);
+	buf.push_back('"');
+
+	return buf;
+}
+
+bool etag::matches(const node::buffer_view& if_none_match, const node::buffer_view& tag) noexcept {
+	const node::buffer_view opaque = opaque_tag(tag);
+
+	if (!opaque) {
+		return false;
+	}
+
+	const uint8_t* p = if_none_match.data<const uint8_t>();
+	const uint8_t* end = p + if_none_match.size();
+
+	while (p != end) {
+		while (p != end && (*p == ',' || *p == ' ' || *p == '\t')) {
+			p++;
+		}
+
+		const uint8_t* beg = p;
+
+		if (end - p >= 2 && p[0] == 'W' && p[1] == '/') {
+			p += 2;
+		}
+
+		if (p != end && *p == '"') {
+			const uint8_t* tag_beg = p;
+
+			// the opaque-tag may contain commas, so skip to its closing quote
+			do {
+				p++;
+			} while (p != end && *p != '"');
+
+			if (p == end) {
+				return false;
+			}
+
+			p++;
+
+			if (opaque.equals(node::buffer_view(tag_beg, std::size_t(p - tag_beg)))) {
+				return true;
+			}
+		} else {
+			while (p != end && *p != ',' && *p != ' ' && *p != '\t') {
+				p++;
+			}
+
+			if (p - beg == 1 && *beg == '*') {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+} // namespace http
+} // namespace node
@@ -0,0 +1,295 @@
+#include "libnodecc/http/event_stream.h"
+
+
+namespace {
+
+/*
+ * Every chunk starts with a fixed size head, whose hex digits are
+ * patched in (with leading zeros) once the chunk is flushed.
+ */
+const char chunk_head[] = "00000000\r\n";
+const std::size_t chunk_head_size = sizeof(chunk_head) - 1;
+const std::size_t chunk_size_digits = 8;
+
+const std::size_t arena_size = 4096;
+
+// shared events smaller than this are copied into the arena instead of being written as a separate buffer
+const std::size_t copy_threshold = 256;
+
+
+void append_field(node::mutable_buffer& buf, const char* name, const node::buffer_view& value) {
+	buf.append(name);
+	buf.append(value.data(), value.size());
+	buf.push_back('\n');
+}
+
+void serialize_into(node::mutable_buffer& buf, const node::buffer_view& data, const node::buffer_view& event, const node::buffer_view& id, uint32_t retry) {
+	if (event) {
+		append_field(buf, "event: ", event);
+	}
+
+	if (id) {
+		append_field(buf, "id: ", id);
+	}
+
+	if (retry) {
+		buf.append("retry: ");
+		buf.append_number(retry);
+		buf.push_back('\n');
+	}
+
+	// CRLF, LF and CR are all valid line endings for event streams
+	const uint8_t* p = data.begin();
+	const uint8_t* const end = data.end();
+
+	for (;;) {
+		const uint8_t* line = p;
+
+		while (p != end && *p != '\r' && *p != '\n') {
+			p++;
+		}
+
+		append_field(buf, "data: ", node::buffer_view(line, std::size_t(p - line)));
+
+		if (p == end) {
+			break;
+		}
+
+		if (*p == '\r' && p + 1 != end && p[1] == '\n') {
+			p++;
+		}
+
+		p++;
+	}
+
+	buf.push_back('\n');
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+node::buffer event_stream::serialize(const node::buffer_view& data, const node::buffer_view& event, const node::buffer_view& id, uint32_t retry) {
+	node::mutable_buffer buf;
+	buf.set_capacity(data.size() + event.size() + id.size() + 32);
+	serialize_into(buf, data, event, id, retry);
+	return buf;
+}
+
+event_stream::event_stream(const node::http::server::response& res, uint64_t heartbeat_interval) : _res(res), _res_destroy_iter(nullptr), _socket_end_iter(nullptr), _socket_destroy_iter(nullptr), _arena_offset(0), _chunk_size(0), _is_chunk_open(false), _is_idle(true) {
+	using namespace node::literals;
+
+	res->set_header("content-type"_view, "text/event-stream"_view);
+	res->set_header("cache-control"_view, "no-cache"_view);
+	res->set_header("transfer-encoding"_view, "chunked"_view);
+	res->send_headers();
+
+	this->_res_destroy_iter = res->on(destroy_event, [this]() {
+		this->_res_destroy_iter = nullptr;
+		this->destroy();
+	});
+
+	/*
+	 * A client closing the stream (e.g. an EventSource) ends the socket immediately,
+	 * but it's only destroyed once the shutdown has completed. Any write
+	 * in between would throw inside the flush or heartbeat callbacks.
+	 */
+	this->_socket = res->socket();
+
+	if (this->_socket) {
+		this->_socket_end_iter = this->_socket->on(node::tcp::socket::end_event, [this]() {
+			this->destroy();
+		});
+
+		this->_socket_destroy_iter = this->_socket->on(node::tcp::socket::destroy_event, [this]() {
+			// the listener is currently being emitted and is removed by the destruction anyways
+			this->_socket_destroy_iter = nullptr;
+			this->destroy();
+		});
+	}
+
+	if (heartbeat_interval && res->socket()) {
+		this->_heartbeat = node::make_shared<node::util::timer>(res->socket()->loop());
+
+		this->_heartbeat->on(node::util::timer::timeout_event, [this]() {
+			if (this->_is_idle) {
+				this->comment(node::buffer_view());
+			}
+
+			this->_is_idle = true;
+		});
+
+		this->_heartbeat->start(heartbeat_interval, heartbeat_interval);
+
+		// heartbeats alone shouldn't keep the loop alive
+		this->_heartbeat->unref();
+	}
+}
+
+void event_stream::send(const node::buffer_view& data, const node::buffer_view& event, const node::buffer_view& id) {
+	if (!this->_res) {
+		return;
+	}
+
+	this->_begin_chunk();
+
+	const std::size_t size = this->_arena.size();
+	serialize_into(this->_arena, data, event, id, 0);
+	this->_chunk_size += this->_arena.size() - size;
+	this->_is_idle = false;
+}
+
+void event_stream::send_serialized(const node::buffer& event) {
+	if (!this->_res || !event) {
+		return;
+	}
+
+	this->_begin_chunk();
+
+	if (event.size() < copy_threshold) {
+		this->_arena.append(event.data(), event.size());
+	} else {
+		this->_cut_arena();
+		this->_chunk.emplace_back(event);
+	}
+
+	this->_chunk_size += event.size();
+	this->_is_idle = false;
+}
+
+void event_stream::comment(const node::buffer_view& text) {
+	if (!this->_res) {
+		return;
+	}
+
+	this->_begin_chunk();
+
+	const std::size_t size = this->_arena.size();
+	this->_arena.push_back(':');
+	this->_arena.append(text.data(), text.size());
+	this->_arena.append("\n\n");
+	this->_chunk_size += this->_arena.size() - size;
+}
+
+void event_stream::end() {
+	this->_flush();
+
+	if (this->_res) {
+		this->_res->end();
+	}
+
+	this->destroy();
+}
+
+void event_stream::_begin_chunk() {
+	if (this->_is_chunk_open) {
+		return;
+	}
+
+	const auto& socket = this->_res->socket();
+
+	if (!socket) {
+		return;
+	}
+
+	this->_is_chunk_open = true;
+
+	// the arena can only be reused if no write is pending anymore, which still references it
+	if (!this->_arena || this->_arena.use_count() > 1) {
+		this->_arena = node::mutable_buffer(arena_size);
+	} else {
+		this->_arena.clear();
+	}
+
+	this->_arena.append(chunk_head, chunk_head_size);
+	this->_arena_offset = 0;
+	this->_chunk_size = 0;
+
+	// coalesce all events of this loop iteration into a single chunk
+	this->retain();
+
+	socket->loop().next_tick([this]() {
+		this->_flush();
+		this->release();
+	});
+}
+
+void event_stream::_cut_arena() {
+	const std::size_t size = this->_arena.size();
+
+	if (size > this->_arena_offset) {
+		this->_chunk.emplace_back(this->_arena.slice(this->_arena_offset, size));
+		this->_arena_offset = size;
+	}
+}
+
+void event_stream::_flush() {
+	if (!this->_is_chunk_open) {
+		return;
+	}
+
+	this->_is_chunk_open = false;
+
+	node::shared_ptr<node::tcp::socket> socket;
+
+	if (this->_res) {
+		socket = this->_res->socket();
+	}
+
+	if (socket) {
+		this->_arena.append("\r\n");
+		this->_cut_arena();
+
+		/*
+		 * The first buffer is always the beginning of the arena and thus starts with the head.
+		 * A chunk larger than 4GiB would need more digits, but is impossible in practice.
+		 */
+		static const char hex[] = "0123456789abcdef";
+		uint8_t* head = this->_chunk.front().data();
+		std::size_t size = this->_chunk_size;
+
+		for (std::size_t i = chunk_size_digits; i-- > 0; size >>= 4) {
+			head[i] = uint8_t(hex[size & 0xf]);
+		}
+
+		socket->write(this->_chunk.data(), this->_chunk.size());
+	}
+
+	this->_chunk.clear();
+}
+
+void event_stream::_destroy() {
+	if (this->_heartbeat) {
+		this->_heartbeat->destroy();
+		this->_heartbeat.reset();
+	}
+
+	if (this->_res) {
+		if (this->_res_destroy_iter) {
+			this->_res->off(destroy_event, this->_res_destroy_iter);
+		}
+
+		this->_res.reset();
+	}
+
+	if (this->_socket) {
+		this->_socket->off(node::tcp::socket::end_event, this->_socket_end_iter);
+
+		if (this->_socket_destroy_iter) {
+			this->_socket->off(node::tcp::socket::destroy_event, this->_socket_destroy_iter);
+		}
+
+		this->_socket.reset();
+	}
+
+	this->_is_chunk_open = false;
+	this->_chunk.clear();
+	this->_arena.reset();
+
+	object::_destroy();
+}
+
+} // namespace http
+} // namespace node
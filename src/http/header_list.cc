@@ -0,0 +1,186 @@
+#include "libnodecc/http/header_list.h"
+
+#include <cstring>
+
+
+namespace node {
+namespace http {
+
+header_list::header_list() {
+	// most responses carry less than 16 headers and clear() retains the capacity
+	this->_entries.reserve(16);
+	memset(this->_slots, 0, sizeof(this->_slots));
+}
+
+void header_list::set(const node::hashed_buffer& name, const node::buffer& value) {
+	const uint8_t slot = _slot(name);
+
+	// fast path for the most common case of setting a well known header once
+	if (slot != well_known_count && this->_slots[slot] == 0) {
+		this->add(name, value);
+		return;
+	}
+
+	bool found = false;
+	bool erased = false;
+
+	for (auto it = this->_entries.begin(); it != this->_entries.end();) {
+		if (it->first.equals(name)) {
+			if (found) {
+				it = this->_entries.erase(it);
+				erased = true;
+				continue;
+			}
+
+			it->second = value;
+			found = true;
+		}
+
+		++it;
+	}
+
+	if (!found) {
+		this->add(name, value);
+	} else if (erased) {
+		this->_rebuild_slots();
+	}
+}
+
+void header_list::add(const node::hashed_buffer& name, const node::buffer& value) {
+	this->_entries.emplace_back(name, value);
+
+	const uint8_t slot = _slot(name);
+
+	if (slot != well_known_count && this->_slots[slot] == 0) {
+		this->_slots[slot] = uint32_t(this->_entries.size());
+	}
+}
+
+bool header_list::erase(const node::hashed_buffer& name) {
+	const std::size_t size = this->_entries.size();
+
+	for (auto it = this->_entries.begin(); it != this->_entries.end();) {
+		if (it->first.equals(name)) {
+			it = this->_entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	if (this->_entries.size() != size) {
+		this->_rebuild_slots();
+		return true;
+	}
+
+	return false;
+}
+
+const node::buffer* header_list::find(const node::hashed_buffer& name) const {
+	const uint8_t slot = _slot(name);
+
+	if (slot != well_known_count) {
+		return this->find(well_known(slot));
+	}
+
+	for (const auto& entry : this->_entries) {
+		if (entry.first.equals(name)) {
+			return &entry.second;
+		}
+	}
+
+	return nullptr;
+}
+
+const node::buffer* header_list::find(well_known name) const noexcept {
+	const uint32_t idx = this->_slots[name];
+	return idx ? &this->_entries[idx - 1].second : nullptr;
+}
+
+bool header_list::contains(well_known name) const noexcept {
+	return this->_slots[name] != 0;
+}
+
+void header_list::serialize(node::mutable_buffer& buf) const {
+	for (const auto& entry : this->_entries) {
+		buf.append(entry.first);
+		buf.append(": ");
+		buf.append(entry.second);
+		buf.append("\r\n");
+	}
+}
+
+void header_list::clear() noexcept {
+	this->_entries.clear();
+	memset(this->_slots, 0, sizeof(this->_slots));
+}
+
+std::size_t header_list::size() const noexcept {
+	return this->_entries.size();
+}
+
+bool header_list::empty() const noexcept {
+	return this->_entries.empty();
+}
+
+header_list::const_iterator header_list::begin() const noexcept {
+	return this->_entries.data();
+}
+
+header_list::const_iterator header_list::end() const noexcept {
+	return this->_entries.data() + this->_entries.size();
+}
+
+uint8_t header_list::_slot(const node::buffer_view& name) noexcept {
+	const char* p = name.data<const char>();
+
+	switch (name.size()) {
+	case 4:
+		if (memcmp(p, "date", 4) == 0) {
+			return date;
+		}
+		if (memcmp(p, "etag", 4) == 0) {
+			return etag;
+		}
+		break;
+	case 10:
+		if (memcmp(p, "connection", 10) == 0) {
+			return connection;
+		}
+		if (memcmp(p, "set-cookie", 10) == 0) {
+			return set_cookie;
+		}
+		break;
+	case 13:
+		if (memcmp(p, "cache-control", 13) == 0) {
+			return cache_control;
+		}
+		break;
+	case 14:
+		if (memcmp(p, "content-length", 14) == 0) {
+			return content_length;
+		}
+		break;
+	case 17:
+		if (memcmp(p, "transfer-encoding", 17) == 0) {
+			return transfer_encoding;
+		}
+		break;
+	}
+
+	return well_known_count;
+}
+
+void header_list::_rebuild_slots() noexcept {
+	memset(this->_slots, 0, sizeof(this->_slots));
+
+	for (std::size_t i = 0; i < this->_entries.size(); i++) {
+		const uint8_t slot = _slot(this->_entries[i].first);
+
+		if (slot != well_known_count && this->_slots[slot] == 0) {
+			this->_slots[slot] = uint32_t(i + 1);
+		}
+	}
+}
+
+} // namespace http
+} // namespace node
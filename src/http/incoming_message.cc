@@ -11,6 +11,98 @@ static const node::buffer_view method_map[] = {
 #undef XX
 };
 
+// requests with a larger head are rejected
+static const std::size_t max_head_size = 80 * 1024;
+
+
+/*
+ * Appends the value of a repeated header field to the previous ones.
+ * "cookie" pairs are delimited by "; " (RFC 6265 §5.4), as a ","
+ * would otherwise become part of the last cookie of the previous field.
+ */
+static void join_header(node::mutable_buffer& existing, const node::buffer& field, const node::buffer& value) {
+	if (field.equals(node::buffer_view("cookie", 6))) {
+		existing.append("; ");
+	} else {
+		existing.append(", ");
+	}
+
+	existing.append(value);
+}
+
+
+static bool iequals(const uint8_t* beg, const uint8_t* end, const char* str, std::size_t len) {
+	if (std::size_t(end - beg) != len) {
+		return false;
+	}
+
+	for (; beg != end; beg++, str++) {
+		uint8_t ch = *beg;
+
+		if (ch >= 'A' && ch <= 'Z') {
+			ch += 0x20;
+		}
+
+		if (ch != uint8_t(*str)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Searches a comma-separated header value for a token (case-insensitive).
+ * If last_only is true, only the last entry of the list is compared.
+ */
+static bool has_token(const node::buffer_view& list, const char* token, std::size_t len, bool last_only = false) {
+	const uint8_t* p = list.begin();
+	const uint8_t* end = list.end();
+
+	while (p != end) {
+		while (p != end && (*p == ',' || *p == ' ' || *p == '\t')) {
+			p++;
+		}
+
+		const uint8_t* beg = p;
+
+		while (p != end && *p != ',') {
+			p++;
+		}
+
+		const uint8_t* item_end = p;
+
+		while (item_end != beg && (item_end[-1] == ' ' || item_end[-1] == '\t')) {
+			item_end--;
+		}
+
+		if (beg != item_end && (!last_only || p == end) && iequals(beg, item_end, token, len)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool parse_content_length(const node::buffer_view& value, uint64_t& length) {
+	if (!value) {
+		return false;
+	}
+
+	uint64_t n = 0;
+
+	for (const uint8_t ch : value) {
+		if (ch < '0' || ch > '9' || n > (UINT64_MAX - 9) / 10) {
+			return false;
+		}
+
+		n = n * 10 + (ch - '0');
+	}
+
+	length = n;
+	return true;
+}
+
 
 namespace node {
 namespace http {
@@ -161,7 +253,7 @@ node::buffer url::_get(uint_fast8_t type) noexcept {
 }
 
 
-incoming_message::incoming_message(const node::shared_ptr<node::tcp::socket>& socket, http_parser_type type) : _socket(socket), _is_websocket(UINT8_MAX) {
+incoming_message::incoming_message(const node::shared_ptr<node::tcp::socket>& socket, http_parser_type type) : _socket(socket), _body_remaining(0), _body_state(body_state::head), _is_websocket(UINT8_MAX), _is_upgrade(false), _has_cookies(false), _socket_data_iter(nullptr), _socket_end_iter(nullptr) {
 	static const http_parser_settings http_req_parser_settings = {
 		nullptr,
 		incoming_message::parser_on_url,
@@ -181,19 +273,37 @@ incoming_message::incoming_message(const node::shared_ptr<node::tcp::socket>& so
 
 	this->_headers.max_load_factor(0.75);
 
-	this->_socket->on(this->_socket->data_event, [this](const node::buffer& buf) {
+	if (type == HTTP_REQUEST) {
+		this->_attach(socket);
+		return;
+	}
+
+	this->_socket_data_iter = this->_socket->on(this->_socket->data_event, [this](const node::buffer& buf) {
 		this->_parser_buffer = &buf;
 
 		const size_t nparsed = http_parser_execute(&this->_parser, &http_req_parser_settings, buf.data<char>(), buf.size());
 
-		// TODO: handle upgrade
+		if (this->_parser.upgrade == 1 && this->upgrade_callback) {
+			const node::buffer rest = buf.slice(nparsed);
+
+			this->_socket->off(this->_socket->data_event, this->_socket_data_iter);
+			this->_socket->off(this->_socket->end_event, this->_socket_end_iter);
+			this->_socket_data_iter = nullptr;
+			this->_socket_end_iter = nullptr;
+
+			node::callback<void(const node::buffer& rest)> cb;
+			cb.swap(this->upgrade_callback);
+			cb.emit(rest);
+			return;
+		}
+
 		if (this->_parser.upgrade == 1 || nparsed != buf.size()) {
 			// prevent final http_parser_execute() in .end_callback.connect()?
 			this->_socket->end();
 		}
 	});
 
-	this->_socket->on(this->_socket->end_event, [this]() {
+	this->_socket_end_iter = this->_socket->on(this->_socket->end_event, [this]() {
 		http_parser_execute(&this->_parser, &http_req_parser_settings, nullptr, 0);
 	});
 }
@@ -237,7 +347,7 @@ uint8_t incoming_message::http_version_minor() const {
 
 bool incoming_message::is_websocket_request() {
 	if (this->_is_websocket == UINT8_MAX) {
-		if (this->_parser.upgrade != 0) {
+		if (this->_is_upgrade) {
 			using namespace node::literals;
 
 			const auto upgradeField = this->header("upgrade"_view);
@@ -259,6 +369,90 @@ bool incoming_message::is_websocket_request() {
 	return this->_is_websocket == 1;
 }
 
+http::cookies& incoming_message::cookies() {
+	if (!this->_has_cookies) {
+		using namespace node::literals;
+
+		this->_cookies.set_header(this->header("cookie"_view));
+		this->_has_cookies = true;
+	}
+
+	return this->_cookies;
+}
+
+void incoming_message::read_body(std::size_t limit, read_body_t callback) {
+	struct state {
+		explicit state(read_body_t&& callback, std::size_t limit, uint64_t expected) : callback(std::move(callback)), limit(limit), expected(expected), size(0), has_failed(false) {}
+
+		read_body_t callback;
+
+		// a body received in a single read is kept as a zero-copy slice
+		node::buffer single;
+		node::mutable_buffer body;
+
+		std::size_t limit;
+		uint64_t expected;
+		std::size_t size;
+		bool has_failed;
+	};
+
+	using namespace node::literals;
+
+	uint64_t expected = UINT64_MAX;
+
+	if (this->_body_state == body_state::content_length) {
+		expected = this->_body_remaining;
+	} else if (this->_body_state != body_state::chunked && !parse_content_length(this->header("content-length"_view), expected)) {
+		expected = UINT64_MAX;
+	}
+
+	if (expected != UINT64_MAX && expected > limit) {
+		const auto err = std::make_error_code(std::errc::message_size);
+		callback(&err, node::buffer());
+		return;
+	}
+
+	const auto s = std::make_shared<state>(std::move(callback), limit, expected);
+
+	this->on(data_event, [s](const node::buffer& chunk) {
+		if (s->has_failed || chunk.size() == 0) {
+			return;
+		}
+
+		s->size += chunk.size();
+
+		if (s->size > s->limit) {
+			s->has_failed = true;
+			s->single.reset();
+			s->body.reset();
+
+			const auto err = std::make_error_code(std::errc::message_size);
+			s->callback(&err, node::buffer());
+			return;
+		}
+
+		if (!s->single && !s->body) {
+			s->single = chunk;
+			return;
+		}
+
+		if (s->single) {
+			// preallocate the complete body if its length is known
+			s->body.set_capacity(s->expected != UINT64_MAX ? std::size_t(s->expected) : 2 * s->size);
+			s->body.append(s->single.data(), s->single.size());
+			s->single.reset();
+		}
+
+		s->body.append(chunk.data(), chunk.size());
+	});
+
+	this->on(end_event, [s]() {
+		if (!s->has_failed) {
+			s->callback(nullptr, s->single ? s->single : node::buffer(s->body));
+		}
+	});
+}
+
 void incoming_message::_resume() {
 	if (this->_socket) {
 		this->_socket->resume();
@@ -301,6 +495,7 @@ int incoming_message::parser_on_headers_complete(http_parser* parser) {
 	auto self = static_cast<incoming_message*>(parser->data);
 
 	self->_add_header_partials();
+	self->_is_upgrade = parser->upgrade != 0;
 
 	if (parser->type == HTTP_REQUEST) {
 		self->_http_version_major = static_cast<uint8_t>(parser->http_major);
@@ -330,14 +525,7 @@ int incoming_message::parser_on_body(http_parser* parser, const char* at, size_t
 
 int incoming_message::parser_on_message_complete(http_parser* parser) {
 	auto self = static_cast<incoming_message*>(parser->data);
-
-	if (self->_is_websocket != 1) {
-		self->emit(end_event);
-		self->_generic_value.reset();
-		self->_headers.clear();
-		self->url.clear();
-	}
-
+	self->_message_complete();
 	return 0;
 }
 
@@ -355,9 +543,7 @@ void incoming_message::_add_header_partials() {
 		const auto iter = this->_headers.emplace(this->_partial_header_field, this->_partial_header_value);
 
 		if (!iter.second) {
-			auto& existingValue = iter.first->second;
-			existingValue.append(", ");
-			existingValue.append(this->_partial_header_value);
+			join_header(iter.first->second, this->_partial_header_field, this->_partial_header_value);
 		}
 
 		this->_partial_header_field.reset();
@@ -370,6 +556,262 @@ node::buffer incoming_message::_buffer(const char* at, size_t length) {
 	return this->_parser_buffer->slice(start, start + length);
 }
 
+void incoming_message::_on_request_data(node::buffer data) {
+	while (data && this->_socket) {
+		switch (this->_body_state) {
+		case body_state::head: {
+			node::buffer head;
+			int r;
+
+			/*
+			 * Heads split across multiple reads are accumulated in _partial_head.
+			 * Passing the previous size allows the parser to skip incomplete heads quickly.
+			 */
+			if (this->_partial_head) {
+				const std::size_t last_size = this->_partial_head.size();
+				this->_partial_head.append(data);
+				head = this->_partial_head;
+				r = this->_request_parser.parse(head, last_size);
+			} else {
+				head = data;
+				r = this->_request_parser.parse(head);
+			}
+
+			if (r == request_parser::incomplete) {
+				if (!this->_partial_head) {
+					this->_partial_head.append(data);
+				}
+
+				if (this->_partial_head.size() <= max_head_size) {
+					return;
+				}
+
+				r = request_parser::error;
+			}
+
+			this->_partial_head.reset();
+
+			if (r >= 0) {
+				r = this->_on_request_head(head, r);
+			}
+
+			// the socket might have been destroyed by headers_complete_callback
+			if (r < 0) {
+				if (this->_socket) {
+					this->_socket->end();
+				}
+
+				return;
+			}
+
+			if (this->_body_state == body_state::upgraded) {
+				if (this->upgrade_callback && this->_socket) {
+					// the socket is handed off to the new protocol together with the data following the head
+					this->_socket->off(this->_socket->data_event, this->_socket_data_iter);
+					this->_socket->off(this->_socket->end_event, this->_socket_end_iter);
+					this->_socket_data_iter = nullptr;
+					this->_socket_end_iter = nullptr;
+
+					node::callback<void(const node::buffer& rest)> cb;
+					cb.swap(this->upgrade_callback);
+					cb.emit(head.slice(std::size_t(r)));
+				} else if (this->_socket) {
+					// nobody accepted the upgrade and the connection can't continue as HTTP
+					this->_socket->end();
+				}
+
+				return;
+			}
+
+			data = head.slice(std::size_t(r));
+			break;
+		}
+		case body_state::content_length: {
+			const std::size_t n = this->_body_remaining < data.size() ? std::size_t(this->_body_remaining) : data.size();
+
+			this->_body_remaining -= n;
+
+			if (this->_body_remaining == 0) {
+				this->_body_state = body_state::head;
+			}
+
+			this->emit(data_event, data.slice(0, n));
+
+			if (this->_body_state == body_state::head) {
+				this->_message_complete();
+			}
+
+			data = data.slice(n);
+			break;
+		}
+		case body_state::chunked: {
+			std::size_t offset;
+			std::size_t size;
+			const std::size_t consumed = this->_chunked_decoder.decode(data.data(), data.size(), offset, size);
+
+			if (this->_chunked_decoder.has_error()) {
+				this->_socket->end();
+				return;
+			}
+
+			if (this->_chunked_decoder.is_complete()) {
+				this->_body_state = body_state::head;
+			}
+
+			if (size) {
+				this->emit(data_event, data.slice(offset, offset + size));
+			}
+
+			if (this->_body_state == body_state::head) {
+				this->_message_complete();
+			}
+
+			data = data.slice(consumed);
+			break;
+		}
+		default:
+			return;
+		}
+	}
+}
+
+int incoming_message::_on_request_head(const node::buffer& head, int size) {
+	using namespace node::literals;
+
+	const auto slice = [&head](const node::buffer_view& view) {
+		if (!view) {
+			return node::buffer();
+		}
+
+		const std::size_t start = std::size_t(view.data() - head.data());
+		return head.slice(start, start + view.size());
+	};
+
+	const auto& parser = this->_request_parser;
+	const auto headers = parser.headers();
+
+	for (std::size_t i = 0, n = parser.header_count(); i < n; i++) {
+		node::buffer field = slice(headers[i].name);
+
+		// manual tolower() to workaround some compiler hickups & issues
+		for (uint8_t* data = field.begin(), *end = field.end(); data < end; data++) {
+			const uint8_t ch = *data;
+
+			if (ch >= 0x41 && ch <= 0x5a) {
+				*data = ch + 0x20;
+			}
+		}
+
+		const node::buffer value = slice(headers[i].value);
+		const auto iter = this->_headers.emplace(field, value);
+
+		if (!iter.second) {
+			join_header(iter.first->second, field, value);
+		}
+	}
+
+	this->_http_version_major = 1;
+	this->_http_version_minor = parser.http_version_minor();
+	this->_generic_value = slice(parser.method());
+	this->url.set_url(slice(parser.path()));
+
+	const auto end = this->_headers.cend();
+	const auto transfer_encoding = this->_headers.find("transfer-encoding"_view);
+	const auto content_length = this->_headers.find("content-length"_view);
+	const auto connection = this->_headers.find("connection"_view);
+
+	this->_body_state = body_state::head;
+	this->_body_remaining = 0;
+
+	if (transfer_encoding != end) {
+		/*
+		 * RFC 7230 §3.3.3: If "chunked" isn't the final encoding the length can't be determined.
+		 * A content-length in addition to it is a sign of request smuggling.
+		 */
+		if (content_length != end || !has_token(transfer_encoding->second, "chunked", 7, true)) {
+			return request_parser::error;
+		}
+
+		this->_chunked_decoder.reset();
+		this->_body_state = body_state::chunked;
+	} else if (content_length != end) {
+		if (!parse_content_length(content_length->second, this->_body_remaining)) {
+			return request_parser::error;
+		}
+
+		if (this->_body_remaining) {
+			this->_body_state = body_state::content_length;
+		}
+	}
+
+	const bool upgrade = this->_generic_value.equals("CONNECT"_view) || (connection != end && has_token(connection->second, "upgrade", 7) && this->_headers.find("upgrade"_view) != end);
+	const bool keep_alive = this->_http_version_minor >= 1
+		? connection == end || !has_token(connection->second, "close", 5)
+		: connection != end && has_token(connection->second, "keep-alive", 10);
+
+	if (upgrade) {
+		this->_body_state = body_state::upgraded;
+	}
+
+	this->_is_upgrade = upgrade;
+	this->headers_complete_callback.emit(upgrade, keep_alive);
+
+	if (this->_body_state == body_state::head) {
+		this->_message_complete();
+	}
+
+	return size;
+}
+
+void incoming_message::_message_complete() {
+	if (this->_is_websocket != 1) {
+		this->emit(end_event);
+		this->_generic_value.reset();
+		this->_headers.clear();
+		this->_cookies.clear();
+		this->_has_cookies = false;
+		this->url.clear();
+	}
+}
+
+void incoming_message::_attach(const node::shared_ptr<node::tcp::socket>& socket) {
+	this->_socket = socket;
+	this->_socket_data_iter = this->_socket->on(this->_socket->data_event, [this](const node::buffer& buf) {
+		this->_on_request_data(buf);
+	});
+}
+
+void incoming_message::_detach() {
+	// the socket might be reused as well (e.g. by http::proxy)
+	if (this->_socket) {
+		this->_socket->off(this->_socket->data_event, this->_socket_data_iter);
+		this->_socket->off(this->_socket->end_event, this->_socket_end_iter);
+	}
+
+	this->_socket_data_iter = nullptr;
+	this->_socket_end_iter = nullptr;
+	this->_socket.reset();
+	this->removeAllListeners();
+	this->upgrade_callback.clear();
+	this->_reset();
+
+	// clear() retains the bucket array of the map
+	this->_headers.clear();
+	this->_cookies.clear();
+	this->_has_cookies = false;
+	this->_generic_value.reset();
+	this->_partial_header_field.reset();
+	this->_partial_header_value.reset();
+	this->url.clear();
+
+	this->_chunked_decoder.reset();
+	this->_partial_head.reset();
+	this->_body_remaining = 0;
+	this->_body_state = body_state::head;
+	this->_is_websocket = UINT8_MAX;
+	this->_is_upgrade = false;
+}
+
 void incoming_message::_destroy() {
 	if (this->_socket) {
 		this->_socket->destroy();
@@ -377,6 +819,7 @@ void incoming_message::_destroy() {
 
 	this->_socket.reset();
 	this->headers_complete_callback.clear();
+	this->upgrade_callback.clear();
 
 	object::_destroy();
 }
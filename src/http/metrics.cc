@@ -0,0 +1,212 @@
+#include "libnodecc/http/metrics.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+
+namespace {
+
+static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+
+static const char* const class_labels[] = {
+	"class=\"1xx\"",
+	"class=\"2xx\"",
+	"class=\"3xx\"",
+	"class=\"4xx\"",
+	"class=\"5xx\"",
+};
+
+
+inline void add(std::atomic<uint64_t>& counter, uint64_t value) noexcept {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline unsigned int status_index(uint16_t status) noexcept {
+	const unsigned int idx = status / 100;
+	return idx >= 1 && idx <= 5 ? idx - 1 : 4;
+}
+
+void append_sample(node::mutable_buffer& buf, const char* name, const node::buffer_view& labels, const char* label, uint64_t value) {
+	char tmp[24];
+	const int len = snprintf(tmp, sizeof(tmp), "%" PRIu64, value);
+
+	buf.append(name);
+	buf.push_back('{');
+	buf.append(labels.data(), labels.size());
+
+	if (label) {
+		buf.push_back(',');
+		buf.append(label);
+	}
+
+	buf.append("} ");
+	buf.append(tmp, std::size_t(len));
+	buf.push_back('\n');
+}
+
+void append_series(node::mutable_buffer& buf, const node::buffer_view& labels, const node::http::metrics::series& series, bool per_class) {
+	char label[32];
+
+	for (unsigned int i = 0; i < 5; i++) {
+		const uint64_t count = series.responses[i].load(std::memory_order_relaxed);
+
+		if (count) {
+			append_sample(buf, "http_responses_total", labels, per_class ? class_labels[i] : nullptr, count);
+		}
+	}
+
+	for (const double quantile : quantiles) {
+		snprintf(label, sizeof(label), "quantile=\"%g\"", quantile);
+		append_sample(buf, "http_request_duration_microseconds", labels, label, series.latency.value_at_quantile(quantile));
+	}
+
+	append_sample(buf, "http_request_duration_microseconds_sum", labels, nullptr, series.latency.sum());
+	append_sample(buf, "http_request_duration_microseconds_count", labels, nullptr, series.latency.count());
+	append_sample(buf, "http_response_bytes_total", labels, nullptr, series.bytes.load(std::memory_order_relaxed));
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+metrics::series::series() noexcept : bytes(0) {
+	for (auto& count : this->responses) {
+		count.store(0, std::memory_order_relaxed);
+	}
+}
+
+metrics::series::series(const series& other) noexcept : series() {
+	this->merge(other);
+}
+
+void metrics::series::merge(const series& other) noexcept {
+	this->latency.merge(other.latency);
+
+	for (unsigned int i = 0; i < 5; i++) {
+		add(this->responses[i], other.responses[i].load(std::memory_order_relaxed));
+	}
+
+	add(this->bytes, other.bytes.load(std::memory_order_relaxed));
+}
+
+
+metrics::metrics() {
+}
+
+metrics::metrics(const metrics& other) {
+	this->merge(other);
+}
+
+void metrics::record(uint16_t status, const node::buffer& route, uint64_t latency, uint64_t bytes) {
+	const unsigned int idx = status_index(status);
+
+	series& status_series = this->_status_classes[idx];
+	status_series.latency.record(latency);
+	add(status_series.responses[idx], 1);
+	add(status_series.bytes, bytes);
+
+	if (route) {
+		/*
+		 * Only the thread calling record() modifies the map and thus
+		 * lookups don't need to be synchronized with concurrent copies.
+		 */
+		auto it = this->_routes.find(node::hashed_buffer(route));
+
+		if (it == this->_routes.end()) {
+			// the route might be a weak reference to a literal or the request
+			node::hashed_buffer key(route.is_weak() ? route.copy() : route);
+			std::unique_ptr<series> value(new series());
+
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			it = this->_routes.emplace(std::move(key), std::move(value)).first;
+		}
+
+		series& route_series = *it->second;
+		route_series.latency.record(latency);
+		add(route_series.responses[idx], 1);
+		add(route_series.bytes, bytes);
+	}
+}
+
+void metrics::merge(const metrics& other) {
+	if (this == &other) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < 5; i++) {
+		this->_status_classes[i].merge(other._status_classes[i]);
+	}
+
+	std::unique_lock<std::mutex> lock1(this->_mutex, std::defer_lock);
+	std::unique_lock<std::mutex> lock2(other._mutex, std::defer_lock);
+	std::lock(lock1, lock2);
+
+	for (const auto& iter : other._routes) {
+		auto it = this->_routes.find(iter.first);
+
+		if (it == this->_routes.end()) {
+			this->_routes.emplace(iter.first, std::unique_ptr<series>(new series(*iter.second)));
+		} else {
+			it->second->merge(*iter.second);
+		}
+	}
+}
+
+const metrics::series& metrics::status_class(unsigned int status_class) const {
+	return this->_status_classes[status_class >= 1 && status_class <= 5 ? status_class - 1 : 4];
+}
+
+const metrics::series* metrics::route(const node::buffer& route) const {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	const auto it = this->_routes.find(node::hashed_buffer(route));
+	return it != this->_routes.end() ? it->second.get() : nullptr;
+}
+
+node::buffer metrics::to_text() const {
+	node::mutable_buffer buf;
+	buf.set_capacity(4096);
+
+	buf.append("# TYPE http_responses_total counter\n");
+	buf.append("# TYPE http_request_duration_microseconds summary\n");
+	buf.append("# TYPE http_response_bytes_total counter\n");
+
+	for (unsigned int i = 0; i < 5; i++) {
+		const auto& series = this->_status_classes[i];
+
+		if (series.latency.count()) {
+			append_series(buf, node::buffer_view(class_labels[i], strlen(class_labels[i])), series, false);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	node::mutable_buffer labels;
+
+	for (const auto& iter : this->_routes) {
+		labels.clear();
+		labels.append("route=\"");
+
+		// label values need to escape backslashes, double quotes and line feeds
+		for (const uint8_t ch : iter.first) {
+			if (ch == '\\' || ch == '"') {
+				labels.push_back('\\');
+				labels.push_back(ch);
+			} else if (ch == '\n') {
+				labels.append("\\n");
+			} else {
+				labels.push_back(ch);
+			}
+		}
+
+		labels.push_back('"');
+		append_series(buf, labels, *iter.second, true);
+	}
+
+	return buf;
+}
+
+} // namespace http
+} // namespace node
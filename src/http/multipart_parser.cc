@@ -0,0 +1,423 @@
+#include "libnodecc/http/multipart_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+// RFC 2046 §5.1.1: boundaries are at most 70 characters long
+const std::size_t max_boundary_size = 70;
+const std::size_t max_delimiter_size = max_boundary_size + 4;
+
+// the first boundary is not preceded by a line break, unless there is a preamble
+const node::buffer initial_tail("\r\n", 2, node::buffer_flags::weak);
+
+bool is_whitespace(uint8_t ch) {
+	return ch == ' ' || ch == '\t';
+}
+
+uint8_t to_lower(uint8_t ch) {
+	return ch >= 'A' && ch <= 'Z' ? ch + 0x20 : ch;
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+const std::size_t multipart_parser::max_header_size;
+
+node::buffer multipart_parser::boundary(const node::buffer& content_type) {
+	static const char param[] = "boundary=";
+	static const std::size_t param_size = sizeof(param) - 1;
+
+	const uint8_t* beg = content_type.begin();
+	const uint8_t* end = content_type.end();
+
+	for (const uint8_t* p = beg; std::size_t(end - p) > param_size; p++) {
+		// the parameter must be preceded by either a ";" or whitespace
+		if (p == beg || (p[-1] != ';' && !is_whitespace(p[-1]))) {
+			continue;
+		}
+
+		std::size_t i = 0;
+
+		while (i < param_size && to_lower(p[i]) == uint8_t(param[i])) {
+			i++;
+		}
+
+		if (i != param_size) {
+			continue;
+		}
+
+		const uint8_t* value_beg = p + param_size;
+		const uint8_t* value_end;
+
+		if (*value_beg == '"') {
+			value_beg++;
+			value_end = static_cast<const uint8_t*>(memchr(value_beg, '"', std::size_t(end - value_beg)));
+
+			if (!value_end) {
+				return node::buffer();
+			}
+		} else {
+			value_end = value_beg;
+
+			while (value_end != end && *value_end != ';' && !is_whitespace(*value_end)) {
+				value_end++;
+			}
+		}
+
+		return content_type.slice(std::size_t(value_beg - beg), std::size_t(value_end - beg));
+	}
+
+	return node::buffer();
+}
+
+multipart_parser::multipart_parser(const node::buffer_view& boundary) : _tail(initial_tail), _state(preamble), _is_paused(false) {
+	if (boundary.size() == 0 || boundary.size() > max_boundary_size) {
+		this->_state = error;
+		return;
+	}
+
+	node::mutable_buffer delimiter(boundary.size() + 4);
+	delimiter.append("\r\n--", 4);
+	delimiter.append(boundary.data(), boundary.size());
+	this->_delimiter = std::move(delimiter);
+
+	/*
+	 * Horspool's algorithm: On a mismatch the search can skip ahead by the distance
+	 * of the last compared input byte from the end of the delimiter.
+	 * Since delimiters are at most 74 bytes long all distances fit into an uint8_t.
+	 */
+	const uint8_t* d = this->_delimiter.data();
+	const std::size_t size = this->_delimiter.size();
+
+	memset(this->_skip, int(size), sizeof(this->_skip));
+
+	for (std::size_t i = 0; i < size - 1; i++) {
+		this->_skip[d[i]] = uint8_t(size - 1 - i);
+	}
+}
+
+bool multipart_parser::push(const node::buffer& data) {
+	if (this->_is_paused) {
+		// the caller didn't respect the backpressure - keep all of it
+		node::mutable_buffer pending(this->_pending.size() + data.size());
+		pending.append(this->_pending.data(), this->_pending.size());
+		pending.append(data.data(), data.size());
+		this->_pending = std::move(pending);
+		return false;
+	}
+
+	this->_execute(data);
+	return !this->_is_paused;
+}
+
+void multipart_parser::pause() noexcept {
+	this->_is_paused = true;
+}
+
+bool multipart_parser::resume() {
+	if (this->_is_paused) {
+		this->_is_paused = false;
+
+		node::buffer pending;
+		pending.swap(this->_pending);
+		this->_execute(std::move(pending));
+	}
+
+	return !this->_is_paused;
+}
+
+bool multipart_parser::is_paused() const noexcept {
+	return this->_is_paused;
+}
+
+bool multipart_parser::is_complete() const noexcept {
+	return this->_state == epilogue;
+}
+
+bool multipart_parser::has_error() const noexcept {
+	return this->_state == error;
+}
+
+void multipart_parser::_execute(node::buffer data) {
+	while (data.size() != 0 && !this->_is_paused) {
+		std::size_t consumed = 1;
+
+		switch (this->_state) {
+		case preamble:
+		case body:
+			consumed = this->_consume_body(data);
+			break;
+		case delimiter_suffix:
+			// RFC 2046 §5.1.1 allows "transport padding" after the boundary
+			switch (data[0]) {
+			case '-':
+				this->_state = delimiter_dash;
+				break;
+			case '\r':
+				this->_state = delimiter_lf;
+				break;
+			case ' ':
+			case '\t':
+				break;
+			default:
+				this->_state = error;
+				break;
+			}
+			break;
+		case delimiter_dash:
+			if (data[0] == '-') {
+				this->_state = epilogue;
+				this->end_callback.emit();
+			} else {
+				this->_state = error;
+			}
+			break;
+		case delimiter_lf:
+			this->_state = data[0] == '\n' ? headers : error;
+			break;
+		case headers:
+			consumed = this->_consume_headers(data);
+			break;
+		case epilogue:
+		case error:
+			return;
+		}
+
+		data = data.slice(consumed);
+	}
+
+	if (data.size() != 0) {
+		this->_pending = std::move(data);
+	}
+}
+
+/*
+ * Emits the content until the next delimiter, or up to a possible
+ * beginning of a delimiter at the end of the input, which is held back.
+ * A delimiter is only consumed if it starts at the beginning of the
+ * input, so that no further callback is emitted after a data callback.
+ */
+std::size_t multipart_parser::_consume_body(const node::buffer& data) {
+	if (this->_tail.size() != 0) {
+		return this->_consume_tail(data);
+	}
+
+	const uint8_t* p = data.data();
+	const std::size_t size = data.size();
+	const std::size_t delimiter_size = this->_delimiter.size();
+	const std::size_t pos = this->_search(p, size);
+
+	if (pos == 0) {
+		this->_delimiter_found();
+		return delimiter_size;
+	}
+
+	if (pos != node::buffer::npos) {
+		this->_emit_data(data.slice(0, pos));
+		return pos;
+	}
+
+	// find the first suffix of the input which is a prefix of the delimiter
+	std::size_t i = size > delimiter_size - 1 ? size - (delimiter_size - 1) : 0;
+
+	for (;;) {
+		const void* cr = memchr(p + i, '\r', size - i);
+
+		if (!cr) {
+			i = size;
+			break;
+		}
+
+		i = std::size_t(static_cast<const uint8_t*>(cr) - p);
+
+		if (memcmp(p + i, this->_delimiter.data(), size - i) == 0) {
+			break;
+		}
+
+		i++;
+	}
+
+	if (i != size) {
+		this->_tail = data.slice(i);
+	}
+
+	if (i != 0) {
+		this->_emit_data(data.slice(0, i));
+	}
+
+	return size;
+}
+
+/*
+ * Checks whether the held back tail of the previous input
+ * together with the current input forms a delimiter.
+ */
+std::size_t multipart_parser::_consume_tail(const node::buffer& data) {
+	const std::size_t delimiter_size = this->_delimiter.size();
+	const std::size_t tail_size = this->_tail.size();
+	const std::size_t data_size = std::min(data.size(), delimiter_size - 1);
+	const std::size_t size = tail_size + data_size;
+
+	uint8_t scratch[2 * max_delimiter_size];
+	memcpy(scratch, this->_tail.data(), tail_size);
+	memcpy(scratch + tail_size, data.data(), data_size);
+
+	for (std::size_t i = 0; i < tail_size; i++) {
+		const std::size_t n = std::min(size - i, delimiter_size);
+
+		if (scratch[i] != '\r' || memcmp(scratch + i, this->_delimiter.data(), n) != 0) {
+			continue;
+		}
+
+		if (i != 0) {
+			const node::buffer content = this->_tail.slice(0, i);
+			this->_tail = this->_tail.slice(i);
+			this->_emit_data(content);
+			return 0;
+		}
+
+		if (n == delimiter_size) {
+			this->_tail.reset();
+			this->_delimiter_found();
+			return delimiter_size - tail_size;
+		}
+
+		// the input is too short to decide - keep all of it
+		this->_tail = node::buffer(scratch, size, node::buffer_flags::copy);
+		return data.size();
+	}
+
+	node::buffer content;
+	content.swap(this->_tail);
+	this->_emit_data(content);
+	return 0;
+}
+
+std::size_t multipart_parser::_consume_headers(const node::buffer& data) {
+	const std::size_t last_size = this->_head.size();
+	const std::size_t n = std::min(data.size(), max_header_size + 4 - last_size);
+
+	this->_head.append(data.data(), n);
+
+	const uint8_t* head = this->_head.data();
+	const std::size_t size = this->_head.size();
+	std::size_t end = 0;
+
+	if (size >= 2 && head[0] == '\r' && head[1] == '\n') {
+		// a part without any headers
+		end = 2;
+	} else {
+		for (std::size_t i = last_size > 3 ? last_size - 3 : 0; i + 4 <= size; i++) {
+			if (head[i] == '\r' && memcmp(head + i, "\r\n\r\n", 4) == 0) {
+				end = i + 4;
+				break;
+			}
+		}
+	}
+
+	if (end == 0) {
+		if (size >= max_header_size + 4) {
+			this->_state = error;
+		}
+
+		return n;
+	}
+
+	if (!this->_parse_headers(end)) {
+		this->_state = error;
+		return n;
+	}
+
+	this->_state = body;
+	this->part_callback.emit(this->_headers);
+	this->_headers.clear();
+
+	return end - last_size;
+}
+
+bool multipart_parser::_parse_headers(std::size_t size) {
+	// the fields are lowercased in place and stay valid as long as they are referenced
+	const node::buffer fields(this->_head.slice(0, size));
+	uint8_t* p = this->_head.data();
+	uint8_t* end = p + size - 2;
+	const uint8_t* base = p;
+
+	this->_head.reset();
+
+	while (p != end) {
+		uint8_t* line_end = static_cast<uint8_t*>(memchr(p, '\r', std::size_t(end - p)));
+		uint8_t* name_end = p;
+
+		for (; name_end != line_end && *name_end != ':'; name_end++) {
+			*name_end = to_lower(*name_end);
+		}
+
+		if (name_end == p || name_end == line_end || line_end[1] != '\n') {
+			return false;
+		}
+
+		uint8_t* value_beg = name_end + 1;
+		uint8_t* value_end = line_end;
+
+		while (value_beg != value_end && is_whitespace(*value_beg)) {
+			value_beg++;
+		}
+
+		while (value_end != value_beg && is_whitespace(value_end[-1])) {
+			value_end--;
+		}
+
+		this->_headers.add(
+			node::hashed_buffer(fields.slice(std::size_t(p - base), std::size_t(name_end - base))),
+			fields.slice(std::size_t(value_beg - base), std::size_t(value_end - base))
+		);
+
+		p = line_end + 2;
+	}
+
+	return true;
+}
+
+void multipart_parser::_emit_data(const node::buffer& data) {
+	// the preamble is discarded
+	if (this->_state == body) {
+		this->data_callback.emit(data);
+	}
+}
+
+void multipart_parser::_delimiter_found() {
+	const bool was_body = this->_state == body;
+
+	this->_state = delimiter_suffix;
+
+	if (was_body) {
+		this->part_end_callback.emit();
+	}
+}
+
+std::size_t multipart_parser::_search(const uint8_t* data, std::size_t size) const noexcept {
+	const uint8_t* d = this->_delimiter.data();
+	const std::size_t n = this->_delimiter.size();
+	const uint8_t last = d[n - 1];
+
+	for (std::size_t i = 0; i + n <= size;) {
+		const uint8_t ch = data[i + n - 1];
+
+		if (ch == last && memcmp(data + i, d, n - 1) == 0) {
+			return i;
+		}
+
+		i += this->_skip[ch];
+	}
+
+	return node::buffer::npos;
+}
+
+} // namespace http
+} // namespace node
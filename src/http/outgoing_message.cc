@@ -7,20 +7,28 @@
 namespace node {
 namespace http {
 
-outgoing_message::outgoing_message(const node::shared_ptr<node::tcp::socket>& socket) : _socket(socket), _headers_sent(false) {
-	this->_headers.max_load_factor(0.75);
+outgoing_message::outgoing_message(const node::shared_ptr<node::tcp::socket>& socket) : _socket(socket), _headers_sent(false), _has_body(true) {
 }
 
 const node::shared_ptr<node::tcp::socket>& outgoing_message::socket() {
 	return this->_socket;
 }
 
-const node::buffer outgoing_message::header(node::hashed_buffer& key) {
-	return this->_headers.at(key);
+const node::buffer outgoing_message::header(const node::hashed_buffer& key) const {
+	const node::buffer* value = this->_headers.find(key);
+	return value ? *value : node::buffer();
 }
 
-void outgoing_message::set_header(node::hashed_buffer key, node::buffer value) {
-	this->_headers.emplace(std::forward<node::hashed_buffer>(key), std::forward<node::buffer>(value));
+void outgoing_message::set_header(const node::hashed_buffer& key, const node::buffer& value) {
+	this->_headers.set(key, value);
+}
+
+void outgoing_message::add_header(const node::hashed_buffer& key, const node::buffer& value) {
+	this->_headers.add(key, value);
+}
+
+void outgoing_message::remove_header(const node::hashed_buffer& key) {
+	this->_headers.erase(key);
 }
 
 bool outgoing_message::headers_sent() const {
@@ -41,9 +49,10 @@ void outgoing_message::http_write(const node::buffer bufs[], size_t bufcnt, bool
 		return;
 	}
 
-	size_t compiledBufcnt = 0;
-	size_t compiledBufsPos = 0;
-	node::buffer* compiledBufs = nullptr;
+	if (!this->_has_body) {
+		bufcnt = 0;
+	}
+
 	node::mutable_buffer buf;
 
 	// TODO: do not set chunked/content-length headers if there is no body at all (e.g. GET requests)
@@ -51,18 +60,18 @@ void outgoing_message::http_write(const node::buffer bufs[], size_t bufcnt, bool
 	if (!this->_headers_sent) {
 		using namespace node::literals;
 
-		if (this->_headers.find("content-length"_view) != this->_headers.end()) {
+		if (!this->_has_body || this->_headers.contains(header_list::content_length)) {
 			this->_is_chunked = false;
 		} else {
-			const auto p = this->_headers.find("transfer-encoding"_view);
+			const node::buffer* p = this->_headers.find(header_list::transfer_encoding);
 
 			/*
 			 * It's the first an last write call and
 			 * no transfer-encoding has benn specified.
 			 * ---> Try to set the content-length.
 			 */
-			if (p != this->_headers.end()) {
-				this->_is_chunked = p->second.equals("chunked"_view);
+			if (p) {
+				this->_is_chunked = p->equals("chunked"_view);
 			} else {
 				if (end) {
 					size_t contentLength = 0;
@@ -92,7 +101,7 @@ void outgoing_message::http_write(const node::buffer bufs[], size_t bufcnt, bool
 						buf.append_number(contentLength, 10);
 
 						if (buf) {
-							this->set_header("content-length"_view, buf);
+							this->_headers.add("content-length"_view, buf);
 							this->_is_chunked = false;
 
 							goto contentLengthSuccessfullySet;
@@ -104,121 +113,145 @@ void outgoing_message::http_write(const node::buffer bufs[], size_t bufcnt, bool
 				 * Calculating the content-length failed.
 				 * ---> Use chunked encoding.
 				 */
-				this->_headers.emplace_hint(p, "transfer-encoding"_view, "chunked"_view);
+				this->_headers.add("transfer-encoding"_view, "chunked"_view);
 				this->_is_chunked = true;
 			}
 		}
 
 	contentLengthSuccessfullySet:
-
-		/*
-		 * If this connection uses chunked encoding and
-		 * this method call will also send the headers out,
-		 * we will append the chunk length directly to the headers.
-		 *
-		 * If it isn't chunked we must use a seperate buffer for the header.
-		 */
-		if (!this->_is_chunked) {
-			compiledBufcnt++;
-		}
-	}
-
-	/*
-	 * If the chunked encoding is used we need 2*n+1 bufs:
-	 * ([header] + hex + \r\n) + data + (\r\n + hex + \r\n) + ... + (\r\n + 0\r\n\r\n)
-	 */
-	if (bufcnt > 0) {
-		compiledBufcnt += this->_is_chunked ? (2 * bufcnt + 1) : bufcnt;
-	} else if (end) {
-		compiledBufcnt++;
+		;
 	}
 
-	if (compiledBufcnt == 0) {
-		goto writeEnd;
-	} else {
-		// no need to copy the buffers if we can pipe the bufs 1:1 to the socket
-		if (compiledBufcnt == bufcnt) {
-			this->_socket->write(bufs, bufcnt);
-			goto writeEnd;
+	// send_headers() --> write the headers without any chunk framing
+	if (bufcnt == 0 && !end) {
+		if (!this->_headers_sent) {
+			buf.set_capacity(800);
+			this->compile_headers(buf);
+			this->_headers.clear();
+			this->_headers_sent = true;
+			this->_socket->write(buf);
 		}
 
-		const size_t size = compiledBufcnt * sizeof(node::buffer);
-
-		compiledBufs = (node::buffer*)alloca(size);
-
-		/*
-		 * Using the array version of placement-new is only
-		 * guaranteed to be compatible with new[] and
-		 * might return a pointer different from the passed one.
-		 * E.g. MSVS sets the first 4 (or 8 on x64) Bytes to the passed array length.
-		 * memset() is fine in our case since node::buffer's default
-		 * constructor is a constexpr, setting all members to zero.
-		 */
-		memset(compiledBufs, 0, size);
+		return;
 	}
 
-	if (!this->_headers_sent) {
+	const bool send_head = !this->_headers_sent;
+
+	if (send_head) {
 		// an average HTTP header should be between 700-800 byte in size
 		buf.set_capacity(800);
 		this->compile_headers(buf);
 
-		/*
-		 * If it this write call uses chunked encoding and will also send the
-		 * headers out we can append the first chunk length field directly to it.
-		 *
-		 * If it isn't chunked we must use a seperate buffer for the header.
-		 */
-		if (!this->_is_chunked) {
-			compiledBufs[compiledBufsPos++] = buf;
-		}
-
 		this->_headers.clear();
 		this->_headers_sent = true;
 	}
 
+	/*
+	 * The chunked encoding needs up to 2*n+2 iovecs:
+	 * ([header] + hex + \r\n) + data + (\r\n + hex + \r\n) + ... + (\r\n + 0\r\n\r\n)
+	 *
+	 * The iovecs refer to the buffers directly, which
+	 * avoids copying (and thus retaining) every single one.
+	 */
+	const size_t maxcnt = this->_is_chunked ? 2 * bufcnt + 2 : bufcnt + 1;
+	uv_buf_t* iov = static_cast<uv_buf_t*>(alloca(maxcnt * sizeof(uv_buf_t)));
+	const node::buffer** owners = static_cast<const node::buffer**>(alloca(maxcnt * sizeof(node::buffer*)));
+	size_t iovcnt = 0;
+
+	const auto push = [&](const void* base, size_t len, const node::buffer* owner) {
+		iov[iovcnt].base = (char*)base;
+		iov[iovcnt].len = len;
+		owners[iovcnt] = owner;
+		iovcnt++;
+	};
+
 	if (this->_is_chunked) {
+		/*
+		 * All chunk size lines are appended to the (possibly empty) header buffer.
+		 * A size line consists of at most 20 bytes ("\r\n" + 16 hex digits + "\r\n")
+		 * and thus reserving the capacity up front keeps the pointers stable.
+		 */
+		const size_t capacity = buf.size() + bufcnt * 20;
+
+		if (buf.capacity() < capacity) {
+			buf.set_capacity(capacity);
+		}
+
+		size_t mark = 0;
+		size_t chunkcnt = 0;
+
 		for (size_t i = 0; i < bufcnt; i++) {
 			const size_t size = bufs[i].size();
 
-			if (i > 0) {
+			// a chunk of size 0 would terminate the body
+			if (size == 0) {
+				continue;
+			}
+
+			if (chunkcnt > 0) {
 				buf.append("\r\n");
 			}
 
 			buf.append_number(size, 16);
 			buf.append("\r\n");
 
-			compiledBufs[compiledBufsPos++] = buf;
-			compiledBufs[compiledBufsPos++] = bufs[i];
+			push(buf.data() + mark, buf.size() - mark, &buf);
+			push(bufs[i].data(), size, bufs + i);
 
-			buf.reset();
+			mark = buf.size();
+			chunkcnt++;
 		}
 
-		using namespace node::literals;
-		static const auto end_chunk = "\r\n0\r\n\r\n"_buffer_view;
-		static const auto end_chunk_0 = end_chunk.slice(2);
-		static const auto end_chunk_rn = end_chunk.slice(0, 2);
+		// the header, if no chunk has been written
+		if (mark < buf.size()) {
+			push(buf.data() + mark, buf.size() - mark, &buf);
+		}
+
+		static const char end_chunk[] = "\r\n0\r\n\r\n";
 
-		compiledBufs[compiledBufsPos++] = node::buffer(end ? (bufcnt > 0 ? end_chunk : end_chunk_0) : end_chunk_rn, node::buffer_flags::weak);
+		if (end) {
+			push(chunkcnt > 0 ? end_chunk : end_chunk + 2, chunkcnt > 0 ? 7 : 5, nullptr);
+		} else if (chunkcnt > 0) {
+			push(end_chunk, 2, nullptr);
+		}
 	} else {
+		if (send_head) {
+			push(buf.data(), buf.size(), &buf);
+		}
+
 		for (size_t i = 0; i < bufcnt; i++) {
-			compiledBufs[compiledBufsPos++] = bufs[i];
+			if (bufs[i].size()) {
+				push(bufs[i].data(), bufs[i].size(), bufs + i);
+			}
 		}
 	}
 
-	this->_socket->write(compiledBufs, compiledBufsPos);
-
-
-	for (size_t i = 0; i < compiledBufsPos; i++) {
-		compiledBufs[i].~buffer();
+	if (iovcnt) {
+		this->_socket->writev(iov, owners, iovcnt);
 	}
 
-writeEnd:
-
 	if (end) {
 		this->_headers_sent = false;
+		this->_has_body = true;
 	}
 }
 
+void outgoing_message::_attach(const node::shared_ptr<node::tcp::socket>& socket) {
+	this->_socket = socket;
+}
+
+void outgoing_message::_detach() {
+	this->_socket.reset();
+	this->removeAllListeners();
+	this->_reset();
+	this->_wm = 0;
+
+	this->_headers.clear();
+	this->_headers_sent = false;
+	this->_is_chunked = false;
+	this->_has_body = true;
+}
+
 void outgoing_message::_destroy() {
 	if (this->_socket) {
 		this->_socket->destroy();
@@ -0,0 +1,475 @@
+#include "libnodecc/http/proxy.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+bool is_whitespace(uint8_t ch) {
+	return ch == ' ' || ch == '\t';
+}
+
+uint8_t to_lower(uint8_t ch) {
+	return ch >= 'A' && ch <= 'Z' ? ch + 0x20 : ch;
+}
+
+/*
+ * Returns true if the comma separated list contains the (lowercase) token.
+ */
+bool has_token(const node::buffer_view& list, const node::buffer_view& token) {
+	const uint8_t* p = list.begin();
+	const uint8_t* end = list.end();
+
+	while (p != end) {
+		while (p != end && (*p == ',' || is_whitespace(*p))) {
+			p++;
+		}
+
+		const uint8_t* beg = p;
+
+		while (p != end && *p != ',' && !is_whitespace(*p)) {
+			p++;
+		}
+
+		if (std::size_t(p - beg) == token.size()) {
+			std::size_t i = 0;
+
+			while (i < token.size() && to_lower(beg[i]) == token[i]) {
+				i++;
+			}
+
+			if (i == token.size()) {
+				return true;
+			}
+		}
+
+		while (p != end && *p != ',') {
+			p++;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * RFC 7230 §6.1: Hop-by-hop headers are meant for a single connection
+ * and must not be forwarded, including those listed in "connection".
+ */
+bool is_hop_by_hop(const node::buffer_view& name, const node::buffer_view& connection) {
+	using namespace node::literals;
+
+	static const node::buffer_view names[] = {
+		"connection"_view,
+		"keep-alive"_view,
+		"proxy-authenticate"_view,
+		"proxy-authorization"_view,
+		"proxy-connection"_view,
+		"te"_view,
+		"trailer"_view,
+		"transfer-encoding"_view,
+		"upgrade"_view,
+	};
+
+	for (const auto& n : names) {
+		if (name.equals(n)) {
+			return true;
+		}
+	}
+
+	return connection.size() != 0 && has_token(connection, name);
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+struct proxy::exchange {
+	server::request req;
+	server::response res;
+	node::shared_ptr<node::tcp::socket> downstream;
+	node::shared_ptr<node::tcp::socket> upstream;
+	client::request upstream_req;
+	client::response upstream_res;
+
+	void* req_data_iter = nullptr;
+	void* req_end_iter = nullptr;
+	void* downstream_drain_iter = nullptr;
+	void* downstream_destroy_iter = nullptr;
+	void* upstream_drain_iter = nullptr;
+	void* upstream_error_iter = nullptr;
+	void* upstream_end_iter = nullptr;
+	void* upstream_destroy_iter = nullptr;
+
+	// the position in proxy::_exchanges
+	std::size_t index = 0;
+
+	bool is_head = false;
+	bool request_ended = false;
+	bool keep_alive = false;
+
+	// set by _finish() or _fail(), after which the exchange is torn down on the next tick
+	bool is_finished = false;
+	bool has_failed = false;
+	bool reply = false;
+};
+
+
+proxy::proxy(node::loop& loop, const sockaddr& upstream) : _loop(loop), _max_idle(16) {
+	const std::size_t size = upstream.sa_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+
+	memset(&this->_upstream, 0, sizeof(this->_upstream));
+	memcpy(&this->_upstream, &upstream, size);
+}
+
+void proxy::forward(const server::request& req, const server::response& res) {
+	using namespace node::literals;
+
+	const auto x = std::make_shared<exchange>();
+
+	// released by _teardown()
+	this->retain();
+
+	// the exchange is owned by the proxy, since listeners only hold weak references to it
+	x->index = this->_exchanges.size();
+	this->_exchanges.emplace_back(x);
+
+	x->req = req;
+	x->res = res;
+	x->downstream = req->socket();
+	x->upstream = this->_acquire();
+	x->is_head = req->method().equals("HEAD"_view);
+
+	x->upstream_req = node::make_shared<client::detail::request>(x->upstream, req->header("host"_view), req->method(), req->url());
+	x->upstream_res = node::make_shared<client::detail::response>(x->upstream);
+
+	{
+		const auto& connection = req->header("connection"_view);
+
+		for (const auto& header : req->headers()) {
+			// "host" is added by the request itself and "expect" would require
+			// forwarding the interim "100 Continue" response, which isn't supported
+			if (header.first.equals("host"_view) || header.first.equals("expect"_view) || is_hop_by_hop(header.first, connection)) {
+				continue;
+			}
+
+			x->upstream_req->add_header(header.first, header.second);
+		}
+	}
+
+	const std::weak_ptr<exchange> weak_x = x;
+
+	// downstream -> upstream
+	x->req_data_iter = req->on(req->data_event, [weak_x](const node::buffer& chunk) {
+		const auto x = weak_x.lock();
+
+		if (x && !x->is_finished) {
+			x->upstream_req->write(chunk);
+
+			if (x->upstream->is_flooded()) {
+				x->downstream->pause();
+			}
+		}
+	});
+
+	x->req_end_iter = req->on(req->end_event, [weak_x]() {
+		const auto x = weak_x.lock();
+
+		if (x && !x->is_finished) {
+			x->request_ended = true;
+			x->upstream_req->end();
+		}
+	});
+
+	x->upstream_drain_iter = x->upstream->on(node::tcp::socket::drain_event, [weak_x]() {
+		const auto x = weak_x.lock();
+
+		if (x && !x->is_finished) {
+			x->downstream->resume();
+		}
+	});
+
+	// upstream -> downstream
+	x->upstream_res->headers_complete_callback.connect([this, weak_x](bool upgrade, bool keep_alive) {
+		const auto x = weak_x.lock();
+
+		if (x && !x->is_finished) {
+			this->_on_response_headers(x, keep_alive && !upgrade);
+		}
+	});
+
+	x->upstream_res->on(x->upstream_res->data_event, [weak_x](const node::buffer& chunk) {
+		const auto x = weak_x.lock();
+
+		if (x && !x->is_finished) {
+			x->res->write(chunk);
+
+			if (x->downstream->is_flooded()) {
+				x->upstream->pause();
+			}
+		}
+	});
+
+	x->upstream_res->on(x->upstream_res->end_event, [this, weak_x]() {
+		const auto x = weak_x.lock();
+
+		if (x) {
+			this->_finish(x);
+		}
+	});
+
+	x->downstream_drain_iter = x->downstream->on(node::tcp::socket::drain_event, [weak_x]() {
+		const auto x = weak_x.lock();
+
+		if (x && !x->is_finished) {
+			x->upstream->resume();
+		}
+	});
+
+	// errors
+	x->upstream_error_iter = x->upstream->on(node::tcp::socket::error_event, [this, weak_x](const std::error_code&) {
+		const auto x = weak_x.lock();
+
+		if (x) {
+			this->_fail(x, true);
+		}
+	});
+
+	// the response parser has already been notified about the EOF, since it was added before
+	x->upstream_end_iter = x->upstream->on(node::tcp::socket::end_event, [this, weak_x]() {
+		const auto x = weak_x.lock();
+
+		if (x) {
+			this->_fail(x, true);
+		}
+	});
+
+	x->upstream_destroy_iter = x->upstream->on(node::tcp::socket::destroy_event, [this, weak_x]() {
+		const auto x = weak_x.lock();
+
+		if (x) {
+			this->_fail(x, true);
+		}
+	});
+
+	x->downstream_destroy_iter = x->downstream->on(node::tcp::socket::destroy_event, [this, weak_x]() {
+		const auto x = weak_x.lock();
+
+		if (x) {
+			this->_fail(x, false);
+		}
+	});
+}
+
+std::size_t proxy::max_idle_connections() const noexcept {
+	return this->_max_idle;
+}
+
+void proxy::set_max_idle_connections(std::size_t n) {
+	this->_max_idle = n;
+
+	while (this->_idle.size() > n) {
+		this->_remove_idle(this->_idle.front().get());
+	}
+}
+
+std::size_t proxy::idle_connections() const noexcept {
+	return this->_idle.size();
+}
+
+void proxy::_destroy() {
+	// destroying a socket calls _remove_idle() and thus modifies _idle
+	std::vector<node::shared_ptr<node::tcp::socket>> idle;
+	idle.swap(this->_idle);
+
+	for (const auto& socket : idle) {
+		socket->destroy();
+	}
+
+	node::object::_destroy();
+}
+
+node::shared_ptr<node::tcp::socket> proxy::_acquire() {
+	if (!this->_idle.empty()) {
+		// reuse the most recently used connection, since it's the least likely to have timed out
+		const auto socket = this->_idle.back();
+		this->_idle.pop_back();
+		return socket;
+	}
+
+	const auto socket = node::make_shared<node::tcp::socket>(this->_loop);
+
+	/*
+	 * Idle connections are dropped as soon as anything happens on them,
+	 * e.g. the upstream server closing it after its keep-alive timeout.
+	 * These listeners are added first and thus run before the ones of an
+	 * exchange, which releases the connection from within its listeners.
+	 * Only raw pointers may be captured here - shared ones would form a cycle.
+	 */
+	node::tcp::socket* raw = socket.get();
+
+	socket->on(node::tcp::socket::data_event, [this, raw](const node::buffer&) {
+		this->_remove_idle(raw);
+	});
+
+	socket->on(node::tcp::socket::end_event, [this, raw]() {
+		this->_remove_idle(raw);
+	});
+
+	socket->on(node::tcp::socket::error_event, [this, raw](const std::error_code&) {
+		this->_remove_idle(raw);
+	});
+
+	socket->on(node::tcp::socket::destroy_event, [this, raw]() {
+		this->_remove_idle(raw);
+	});
+
+	// writes are queued by libuv until the connection has been established
+	socket->on(node::tcp::socket::connect_event, [raw]() {
+		raw->resume();
+	});
+
+	socket->connect(reinterpret_cast<const sockaddr&>(this->_upstream));
+
+	return socket;
+}
+
+void proxy::_release(const node::shared_ptr<node::tcp::socket>& socket) {
+	if (this->_idle.size() >= this->_max_idle) {
+		socket->destroy();
+	} else {
+		this->_idle.emplace_back(socket);
+	}
+}
+
+void proxy::_remove_idle(node::tcp::socket* socket) {
+	const auto it = std::find_if(this->_idle.begin(), this->_idle.end(), [socket](const node::shared_ptr<node::tcp::socket>& s) {
+		return s.get() == socket;
+	});
+
+	if (it != this->_idle.end()) {
+		const auto s = *it;
+		this->_idle.erase(it);
+		s->destroy();
+	}
+}
+
+void proxy::_on_response_headers(const std::shared_ptr<exchange>& x, bool keep_alive) {
+	using namespace node::literals;
+
+	x->keep_alive = keep_alive;
+	x->res->set_status_code(x->upstream_res->status_code());
+
+	const auto& connection = x->upstream_res->header("connection"_view);
+
+	for (const auto& header : x->upstream_res->headers()) {
+		if (!is_hop_by_hop(header.first, connection)) {
+			x->res->add_header(header.first, header.second);
+		}
+	}
+
+	// the response parser would wait for the body announced by the "content-length"
+	if (x->is_head) {
+		x->keep_alive = false;
+		this->_finish(x);
+	}
+}
+
+void proxy::_finish(const std::shared_ptr<exchange>& x) {
+	if (x->is_finished) {
+		return;
+	}
+
+	x->is_finished = true;
+	this->_schedule_teardown(x);
+}
+
+void proxy::_fail(const std::shared_ptr<exchange>& x, bool reply) {
+	if (x->is_finished) {
+		return;
+	}
+
+	x->is_finished = true;
+	x->has_failed = true;
+	x->reply = reply;
+	this->_schedule_teardown(x);
+}
+
+/*
+ * _finish() and _fail() are called from within the listeners of the sockets and messages
+ * (e.g. the headers_complete_callback while the response parser is still running),
+ * which thus must not be removed or destroyed until the emission has returned.
+ */
+void proxy::_schedule_teardown(const std::shared_ptr<exchange>& x) {
+	this->_loop.next_tick([this, x]() {
+		this->_teardown(x);
+	});
+}
+
+void proxy::_teardown(const std::shared_ptr<exchange>& x) {
+	this->_detach(*x);
+
+	if (!x->has_failed) {
+		x->res->end();
+
+		// the upstream connection might have been closed since _finish() was called
+		if (x->keep_alive && x->request_ended && !x->upstream->is_closing()) {
+			this->_release(x->upstream);
+		} else {
+			x->upstream->destroy();
+		}
+	} else {
+		if (x->reply) {
+			if (x->res->headers_sent()) {
+				// the response can't be completed anymore
+				x->downstream->destroy();
+			} else {
+				x->res->set_status_code(502);
+				x->res->end();
+			}
+		}
+
+		x->upstream->destroy();
+	}
+
+	// swap-pop the exchange out of _exchanges, which drops the last reference besides x
+	auto& last = this->_exchanges.back();
+	last->index = x->index;
+	std::swap(this->_exchanges[x->index], last);
+	this->_exchanges.pop_back();
+
+	this->release();
+}
+
+/*
+ * Removes all listeners added by forward(), which only hold weak references
+ * to the exchange, and detaches the upstream messages from their socket,
+ * since destroying them would otherwise destroy the socket as well.
+ */
+void proxy::_detach(exchange& x) {
+	x.req->off(x.req->data_event, x.req_data_iter);
+	x.req->off(x.req->end_event, x.req_end_iter);
+	x.downstream->off(node::tcp::socket::drain_event, x.downstream_drain_iter);
+	x.downstream->off(node::tcp::socket::destroy_event, x.downstream_destroy_iter);
+
+	if (!x.downstream->is_closing()) {
+		x.downstream->resume();
+	}
+
+	x.upstream->off(node::tcp::socket::drain_event, x.upstream_drain_iter);
+	x.upstream->off(node::tcp::socket::error_event, x.upstream_error_iter);
+	x.upstream->off(node::tcp::socket::end_event, x.upstream_end_iter);
+	x.upstream->off(node::tcp::socket::destroy_event, x.upstream_destroy_iter);
+
+	if (!x.upstream->is_closing()) {
+		x.upstream->resume();
+	}
+
+	x.upstream_req->_detach();
+	x.upstream_res->_detach();
+}
+
+} // namespace http
+} // namespace node
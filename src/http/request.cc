@@ -1,5 +1,7 @@
 #include "libnodecc/http/request.h"
 
+#include <algorithm>
+#include <memory>
 #include <http-parser/http_parser.h>
 
 
@@ -10,6 +12,61 @@ namespace http {
 namespace client {
 namespace detail {
 
+namespace {
+
+/*
+ * Enforces the first_byte and total timeouts of a request after it has been connected.
+ * Only the earliest of them is kept as a pending loop timeout at any time.
+ */
+struct watchdog : std::enable_shared_from_this<watchdog> {
+	explicit watchdog(const node::shared_ptr<node::tcp::socket>& socket, uint64_t first_byte, uint64_t deadline) : loop(socket->loop()), socket(socket), first_byte(first_byte), deadline(deadline), timeout_id(0), has_first_byte(false) {
+	}
+
+	// sets the timeout to the given absolute due time, limited by the deadline
+	void set(uint64_t due) {
+		this->clear();
+
+		if (this->deadline) {
+			due = due ? std::min(due, this->deadline) : this->deadline;
+		}
+
+		if (!due || !this->socket) {
+			return;
+		}
+
+		const uint64_t now = uv_now(this->loop);
+		const auto self = this->shared_from_this();
+
+		this->timeout_id = this->loop.set_timeout(due > now ? due - now : 0, [self]() {
+			self->timeout_id = 0;
+
+			const auto socket = self->socket;
+
+			if (socket) {
+				socket->emit(node::tcp::socket::error_event, std::make_error_code(std::errc::timed_out));
+				socket->destroy();
+			}
+		});
+	}
+
+	void clear() {
+		if (this->timeout_id) {
+			this->loop.clear_timeout(this->timeout_id);
+			this->timeout_id = 0;
+		}
+	}
+
+	node::loop& loop;
+	node::shared_ptr<node::tcp::socket> socket;
+	uint64_t first_byte;
+	uint64_t deadline;
+	uint64_t timeout_id;
+	bool has_first_byte;
+};
+
+} // namespace
+
+
 request::request(const node::shared_ptr<node::tcp::socket>& socket, const node::buffer& host, const node::buffer& method, const node::buffer& path) : outgoing_message(socket), _host(host), _method(method), _path(path) {
 }
 
@@ -24,32 +81,76 @@ void request::compile_headers(node::mutable_buffer& buf) {
 	}
 
 	{
-		for (const auto& iter : this->_headers) {
-			buf.append(iter.first);
-			buf.append(": ");
-			buf.append(iter.second);
-			buf.append("\r\n");
-		}
-
+		this->_headers.serialize(buf);
 		buf.append("\r\n");
 	}
 }
 
 
+void request::_destroy() {
+	this->_end_callback = nullptr;
+	outgoing_message::_destroy();
+}
+
+void request::_end(const node::buffer chunks[], size_t chunkcnt) {
+	outgoing_message::_end(chunks, chunkcnt);
+
+	if (this->_end_callback) {
+		std::function<void()> cb;
+		cb.swap(this->_end_callback);
+		cb();
+	}
+}
+
+
 response::response(const node::shared_ptr<node::tcp::socket>& socket) : incoming_message(socket, HTTP_RESPONSE) {
 }
 
 
-static NODE_HTTP_REQUEST_GENERATOR_SIGNATURE {
+NODE_HTTP_REQUEST_GENERATOR_SIGNATURE {
 	const auto req = node::make_shared<detail::request>(socket, host, method, path);
 	const auto res = node::make_shared<detail::response>(socket);
 
-	socket->on(node::tcp::socket::destroy_event, [req, res]() {
+	std::shared_ptr<watchdog> dog;
+
+	if (timeouts.first_byte || deadline) {
+		dog = std::make_shared<watchdog>(socket, timeouts.first_byte, deadline);
+
+		req->_end_callback = [dog]() {
+			if (dog->first_byte && !dog->has_first_byte) {
+				dog->set(uv_now(dog->loop) + dog->first_byte);
+			}
+		};
+
+		// the first byte of the response leaves only the deadline in effect
+		socket->on(node::tcp::socket::data_event, [dog](const node::buffer&) {
+			if (!dog->has_first_byte) {
+				dog->has_first_byte = true;
+				dog->set(0);
+			}
+		});
+
+		res->on(node::http::client::detail::response::end_event, [dog]() {
+			dog->deadline = 0;
+			dog->clear();
+		});
+	}
+
+	socket->on(node::tcp::socket::destroy_event, [req, res, dog]() {
+		if (dog) {
+			dog->socket.reset();
+			dog->clear();
+		}
+
 		req->destroy();
 		res->destroy();
 	});
 
-	socket->on(node::tcp::socket::connect_event, [req, res, cb]() {
+	socket->on(node::tcp::socket::connect_event, [req, res, cb, dog]() {
+		if (dog) {
+			dog->set(0);
+		}
+
 		cb(nullptr, req, res);
 		req->socket()->resume();
 		req->socket()->removeAllListeners(node::tcp::socket::connect_event);
@@ -64,7 +165,18 @@ static NODE_HTTP_REQUEST_GENERATOR_SIGNATURE {
 } // namespace client
 
 
+/*
+ * Returns the absolute due time of the total timeout or 0 if there is none.
+ */
+static uint64_t deadline(node::loop& loop, const client::timeouts& timeouts) {
+	return timeouts.total ? uv_now(loop) + timeouts.total : 0;
+}
+
 void request(node::loop& loop, const node::buffer& method, const node::buffer& url, const client::on_connect_t& cb) {
+	request(loop, method, url, client::timeouts(), cb);
+}
+
+void request(node::loop& loop, const node::buffer& method, const node::buffer& url, const client::timeouts& timeouts, const client::on_connect_t& cb) {
 	http_parser_url parser;
 	const int r = http_parser_parse_url(url.data<char>(), url.size(), false, &parser);
 
@@ -86,21 +198,41 @@ void request(node::loop& loop, const node::buffer& method, const node::buffer& u
 		path = "/"_view;
 	}
 
-	tcp::socket::connect(loop, host, parser.port ? parser.port : 80, [host, method, path, cb](const std::error_code* err, const node::shared_ptr<node::tcp::socket>& socket) {
+	node::tcp::connect_timeouts connect_timeouts;
+	connect_timeouts.lookup = timeouts.lookup;
+	connect_timeouts.connect = timeouts.connect;
+	connect_timeouts.total = timeouts.total;
+
+	const uint64_t due = deadline(loop, timeouts);
+
+	tcp::socket::connect(loop, host, parser.port ? parser.port : 80, [host, method, path, timeouts, due, cb](const std::error_code* err, const node::shared_ptr<node::tcp::socket>& socket) {
 		if (err) {
 			cb(err, client::request(), client::response());
 		} else {
-			_generate(socket, host, method, path, cb);
+			_generate(socket, host, method, path, timeouts, due, cb);
+
+			// the socket is connected already and thus won't emit the event by itself
+			socket->emit(node::tcp::socket::connect_event);
 		}
-	});
+	}, connect_timeouts);
 }
 
 void request(node::loop& loop, const sockaddr& addr, const node::buffer& host, const node::buffer& method, const node::buffer& path, const client::on_connect_t& cb) {
+	request(loop, addr, host, method, path, client::timeouts(), cb);
+}
+
+void request(node::loop& loop, const sockaddr& addr, const node::buffer& host, const node::buffer& method, const node::buffer& path, const client::timeouts& timeouts, const client::on_connect_t& cb) {
 	const auto socket = node::make_shared<node::tcp::socket>(loop);
 
-	_generate(socket, host, method, path, cb);
+	_generate(socket, host, method, path, timeouts, deadline(loop, timeouts), cb);
+
+	uint64_t connect_timeout = timeouts.connect;
+
+	if (timeouts.total) {
+		connect_timeout = connect_timeout ? std::min(connect_timeout, timeouts.total) : timeouts.total;
+	}
 
-	socket->connect(addr);
+	socket->connect(addr, connect_timeout);
 }
 
 } // namespace node
@@ -0,0 +1,431 @@
+#include "libnodecc/http/request_parser.h"
+
+#include <cstring>
+
+#ifdef __SSE4_2__
+# include <nmmintrin.h>
+#endif
+
+
+namespace {
+
+// tchar as per RFC 7230 §3.2.6
+const uint8_t token_table[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+#ifdef __SSE4_2__
+
+// bytes which end a request-target: CTLs, SP and DEL
+alignas(16) const char path_ranges[16] = "\x00\x20\x7f\x7f";
+
+// bytes which end a field-value: CTLs except HTAB, and DEL
+alignas(16) const char value_ranges[16] = "\x00\x08\x0a\x1f\x7f\x7f";
+
+/*
+ * Returns a pointer to the first byte within one of the ranges, or if none was found,
+ * to the beginning of the trailing (less than 16 byte) part of the input.
+ */
+inline const uint8_t* find_range_fast(const uint8_t* p, const uint8_t* end, const char* ranges, int ranges_size) noexcept {
+	const __m128i ranges16 = _mm_load_si128(reinterpret_cast<const __m128i*>(ranges));
+
+	for (; end - p >= 16; p += 16) {
+		const __m128i b16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const int r = _mm_cmpestri(ranges16, ranges_size, b16, 16, _SIDD_LEAST_SIGNIFICANT | _SIDD_CMP_RANGES | _SIDD_UBYTE_OPS);
+
+		if (r != 16) {
+			return p + r;
+		}
+	}
+
+	return p;
+}
+
+#endif // __SSE4_2__
+
+inline bool is_path_char(uint8_t ch) noexcept {
+	return ch > 0x20 && ch != 0x7f;
+}
+
+inline bool is_value_char(uint8_t ch) noexcept {
+	return (ch >= 0x20 && ch != 0x7f) || ch == '\t';
+}
+
+inline int hex_value(uint8_t ch) noexcept {
+	if (ch >= '0' && ch <= '9') {
+		return ch - '0';
+	}
+
+	ch |= 0x20;
+
+	if (ch >= 'a' && ch <= 'f') {
+		return ch - 'a' + 10;
+	}
+
+	return -1;
+}
+
+/*
+ * Consumes a CRLF or a bare LF (RFC 7230 §3.5).
+ * Returns 0 on success, or a value of request_parser::result.
+ */
+inline int consume_eol(const uint8_t*& p, const uint8_t* end) noexcept {
+	if (*p == '\r') {
+		if (++p == end) {
+			return node::http::request_parser::incomplete;
+		}
+	}
+
+	if (*p != '\n') {
+		return node::http::request_parser::error;
+	}
+
+	p++;
+	return 0;
+}
+
+/*
+ * Returns true if the buffer contains an empty line after offset "last_size - 3".
+ * This allows us to skip parsing incomplete requests repeatedly.
+ */
+bool is_complete(const uint8_t* beg, const uint8_t* end, std::size_t last_size) noexcept {
+	const uint8_t* p = beg + (last_size < 3 ? 0 : last_size - 3);
+
+	while (p != end) {
+		p = static_cast<const uint8_t*>(memchr(p, '\n', std::size_t(end - p)));
+
+		if (!p || ++p == end) {
+			break;
+		}
+
+		if (*p == '\n' || (*p == '\r' && end - p >= 2 && p[1] == '\n')) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+request_parser::request_parser() noexcept : _header_count(0), _http_version_minor(0) {
+}
+
+int request_parser::parse(const node::buffer_view& buf, std::size_t last_size) noexcept {
+	const uint8_t* const beg = buf.data<const uint8_t>();
+	const uint8_t* const end = beg + buf.size();
+	const uint8_t* p = beg;
+	const uint8_t* tok;
+	int r;
+
+	this->_header_count = 0;
+
+	if (p == end || (last_size != 0 && !is_complete(beg, end, last_size))) {
+		return incomplete;
+	}
+
+	// RFC 7230 §3.5: ignore empty lines received prior to the request-line
+	while (p != end && (*p == '\r' || *p == '\n')) {
+		p++;
+	}
+
+	// method
+	for (tok = p; p != end && token_table[*p]; p++) {
+	}
+
+	if (p == end) {
+		return incomplete;
+	}
+
+	if (p == tok || *p != ' ') {
+		return error;
+	}
+
+	this->_method = node::buffer_view(tok, std::size_t(p - tok));
+	p++;
+
+	// request-target
+	tok = p;
+
+#ifdef __SSE4_2__
+	p = find_range_fast(p, end, path_ranges, 4);
+#endif
+
+	while (p != end && is_path_char(*p)) {
+		p++;
+	}
+
+	if (p == end) {
+		return incomplete;
+	}
+
+	if (p == tok || *p != ' ') {
+		return error;
+	}
+
+	this->_path = node::buffer_view(tok, std::size_t(p - tok));
+	p++;
+
+	// HTTP-version
+	if (end - p < 9) {
+		return incomplete;
+	}
+
+	if (memcmp(p, "HTTP/1.", 7) != 0 || p[7] < '0' || p[7] > '9') {
+		return error;
+	}
+
+	this->_http_version_minor = uint8_t(p[7] - '0');
+	p += 8;
+
+	if ((r = consume_eol(p, end)) != 0) {
+		return r;
+	}
+
+	// header-fields
+	for (;;) {
+		if (p == end) {
+			return incomplete;
+		}
+
+		if (*p == '\r' || *p == '\n') {
+			if ((r = consume_eol(p, end)) != 0) {
+				return r;
+			}
+
+			break;
+		}
+
+		if (this->_header_count == max_headers) {
+			return error;
+		}
+
+		for (tok = p; p != end && token_table[*p]; p++) {
+		}
+
+		if (p == end) {
+			return incomplete;
+		}
+
+		/*
+		 * RFC 7230 §3.2.4: No whitespace is allowed between the field-name and colon.
+		 * This also rejects obsolete line folding, which is permitted by the same section.
+		 */
+		if (p == tok || *p != ':') {
+			return error;
+		}
+
+		header& h = this->_headers[this->_header_count];
+		h.name = node::buffer_view(tok, std::size_t(p - tok));
+
+		for (p++; p != end && (*p == ' ' || *p == '\t'); p++) {
+		}
+
+		tok = p;
+
+#ifdef __SSE4_2__
+		p = find_range_fast(p, end, value_ranges, 6);
+#endif
+
+		while (p != end && is_value_char(*p)) {
+			p++;
+		}
+
+		if (p == end) {
+			return incomplete;
+		}
+
+		const uint8_t* value_end = p;
+
+		if ((r = consume_eol(p, end)) != 0) {
+			return r;
+		}
+
+		while (value_end != tok && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+			value_end--;
+		}
+
+		h.value = node::buffer_view(tok, std::size_t(value_end - tok));
+		this->_header_count++;
+	}
+
+	return int(p - beg);
+}
+
+const node::buffer_view& request_parser::method() const noexcept {
+	return this->_method;
+}
+
+const node::buffer_view& request_parser::path() const noexcept {
+	return this->_path;
+}
+
+uint8_t request_parser::http_version_minor() const noexcept {
+	return this->_http_version_minor;
+}
+
+const request_parser::header* request_parser::headers() const noexcept {
+	return this->_headers;
+}
+
+std::size_t request_parser::header_count() const noexcept {
+	return this->_header_count;
+}
+
+
+chunked_decoder::chunked_decoder() noexcept : _remaining(0), _state(state::size), _size_digits(0) {
+}
+
+std::size_t chunked_decoder::decode(const uint8_t* data, std::size_t size, std::size_t& data_offset, std::size_t& data_size) noexcept {
+	const uint8_t* p = data;
+	const uint8_t* const end = data + size;
+
+	data_offset = 0;
+	data_size = 0;
+
+	for (; p != end; p++) {
+		const uint8_t ch = *p;
+
+		switch (this->_state) {
+		case state::size: {
+			const int value = hex_value(ch);
+
+			if (value >= 0) {
+				// more than 15 digits would overflow _remaining
+				if (this->_size_digits == 15) {
+					this->_state = state::error;
+					return std::size_t(p - data);
+				}
+
+				this->_remaining = (this->_remaining << 4) | uint64_t(value);
+				this->_size_digits++;
+				break;
+			}
+
+			if (this->_size_digits == 0) {
+				this->_state = state::error;
+				return std::size_t(p - data);
+			}
+
+			if (ch == '\r') {
+				this->_state = state::size_lf;
+				break;
+			} else if (ch == ';' || ch == ' ' || ch == '\t') {
+				this->_state = state::extension;
+				break;
+			} else if (ch != '\n') {
+				this->_state = state::error;
+				return std::size_t(p - data);
+			}
+
+			// a bare LF ends the chunk-size line
+		}
+		// fall through
+		case state::extension:
+		case state::size_lf:
+			if (ch == '\n') {
+				this->_size_digits = 0;
+				this->_state = this->_remaining ? state::data : state::trailer_start;
+			} else if (this->_state == state::size_lf) {
+				this->_state = state::error;
+				return std::size_t(p - data);
+			}
+
+			break;
+		case state::data: {
+			const std::size_t available = std::size_t(end - p);
+			const std::size_t n = this->_remaining < available ? std::size_t(this->_remaining) : available;
+
+			data_offset = std::size_t(p - data);
+			data_size = n;
+
+			this->_remaining -= n;
+
+			if (this->_remaining == 0) {
+				this->_state = state::data_cr;
+			}
+
+			return data_offset + n;
+		}
+		case state::data_cr:
+			if (ch == '\r') {
+				this->_state = state::data_lf;
+				break;
+			}
+		// fall through
+		case state::data_lf:
+			if (ch != '\n') {
+				this->_state = state::error;
+				return std::size_t(p - data);
+			}
+
+			this->_state = state::size;
+			break;
+		case state::trailer_start:
+			if (ch == '\r') {
+				this->_state = state::trailer_lf;
+			} else if (ch == '\n') {
+				this->_state = state::complete;
+				return std::size_t(p - data) + 1;
+			} else {
+				this->_state = state::trailer;
+			}
+
+			break;
+		case state::trailer:
+			if (ch == '\n') {
+				this->_state = state::trailer_start;
+			}
+
+			break;
+		case state::trailer_lf:
+			if (ch != '\n') {
+				this->_state = state::error;
+				return std::size_t(p - data);
+			}
+
+			this->_state = state::complete;
+			return std::size_t(p - data) + 1;
+		default:
+			return std::size_t(p - data);
+		}
+	}
+
+	return size;
+}
+
+bool chunked_decoder::is_complete() const noexcept {
+	return this->_state == state::complete;
+}
+
+bool chunked_decoder::has_error() const noexcept {
+	return this->_state == state::error;
+}
+
+void chunked_decoder::reset() noexcept {
+	this->_remaining = 0;
+	this->_state = state::size;
+	this->_size_digits = 0;
+}
+
+} // namespace http
+} // namespace node
@@ -0,0 +1,271 @@
+#include "libnodecc/http/response_cache.h"
+
+#include <algorithm>
+
+#include "libnodecc/http/incoming_message.h"
+
+
+namespace {
+
+bool is_whitespace(uint8_t ch) {
+	return ch == ' ' || ch == '\t';
+}
+
+bool iequals(const uint8_t* a, const char* b, std::size_t size) {
+	for (std::size_t i = 0; i < size; i++) {
+		uint8_t ch = a[i];
+
+		if (ch >= 'A' && ch <= 'Z') {
+			ch += 0x20;
+		}
+
+		if (ch != uint8_t(b[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Returns UINT64_MAX if the directive isn't followed by a valid number.
+ */
+uint64_t parse_delta_seconds(const uint8_t* p, const uint8_t* end) {
+	if (p == end || *p != '=') {
+		return UINT64_MAX;
+	}
+
+	p++;
+
+	// the value may be quoted as per RFC 7234 §1.2.1
+	const bool quoted = p != end && *p == '"';
+
+	if (quoted) {
+		p++;
+	}
+
+	uint64_t value = 0;
+	const uint8_t* beg = p;
+
+	for (; p != end && *p >= '0' && *p <= '9'; p++) {
+		// a value larger than about 68 years is useless anyways
+		if (value < UINT32_MAX) {
+			value = value * 10 + (*p - '0');
+		}
+	}
+
+	return p == beg ? UINT64_MAX : value;
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+response_cache::response_cache(std::size_t max_size) : _size(0), _max_size(max_size), _hits(0), _misses(0) {
+	this->_index.max_load_factor(0.75);
+}
+
+std::size_t response_cache::size() const noexcept {
+	return this->_size;
+}
+
+std::size_t response_cache::max_size() const noexcept {
+	return this->_max_size;
+}
+
+void response_cache::set_max_size(std::size_t max_size) {
+	this->_max_size = max_size;
+	this->_evict(0);
+}
+
+std::size_t response_cache::hits() const noexcept {
+	return this->_hits;
+}
+
+std::size_t response_cache::misses() const noexcept {
+	return this->_misses;
+}
+
+void response_cache::set_vary_headers(std::vector<node::hashed_buffer> headers) {
+	this->_vary_headers = std::move(headers);
+	this->clear();
+}
+
+node::hashed_buffer response_cache::key(incoming_message& req) const {
+	const node::buffer& method = req.method();
+	const node::buffer url = req.url();
+
+	std::size_t capacity = method.size() + url.size() + 1;
+
+	for (const auto& name : this->_vary_headers) {
+		capacity += req.header(name).size() + 1;
+	}
+
+	node::mutable_buffer buf;
+	buf.set_capacity(capacity);
+	buf.append(method);
+	buf.push_back(' ');
+	buf.append(url);
+
+	/*
+	 * Header values can't contain a raw "\n" and thus
+	 * the concatenated key is unique for every combination.
+	 */
+	for (const auto& name : this->_vary_headers) {
+		buf.push_back('\n');
+		buf.append(req.header(name));
+	}
+
+	return node::hashed_buffer(buf);
+}
+
+bool response_cache::is_vary_covered(const node::buffer_view& vary) const noexcept {
+	const uint8_t* p = vary.begin();
+	const uint8_t* end = vary.end();
+
+	while (p != end) {
+		while (p != end && (*p == ',' || is_whitespace(*p))) {
+			p++;
+		}
+
+		const uint8_t* beg = p;
+
+		while (p != end && *p != ',' && !is_whitespace(*p)) {
+			p++;
+		}
+
+		const std::size_t len = std::size_t(p - beg);
+
+		if (len == 0) {
+			continue;
+		}
+
+		// "*" never matches any configured header
+		const auto it = std::find_if(this->_vary_headers.cbegin(), this->_vary_headers.cend(), [beg, len](const node::hashed_buffer& name) {
+			return name.size() == len && iequals(beg, name.data<char>(), len);
+		});
+
+		if (it == this->_vary_headers.cend()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const response_cache::entry* response_cache::find(const node::hashed_buffer& key, uint64_t now) {
+	const auto it = this->_index.find(key);
+
+	if (it == this->_index.end()) {
+		this->_misses++;
+		return nullptr;
+	}
+
+	const auto entry = it->second;
+
+	if (entry->expires <= now) {
+		this->_erase(entry);
+		this->_misses++;
+		return nullptr;
+	}
+
+	this->_entries.splice(this->_entries.begin(), this->_entries, entry);
+	this->_hits++;
+
+	return &*entry;
+}
+
+void response_cache::insert(const node::hashed_buffer& key, std::vector<node::buffer>&& bufs, uint64_t expires, const node::buffer& etag, const node::buffer& cache_control, uint64_t date) {
+	std::size_t size = key.size();
+
+	for (const auto& buf : bufs) {
+		size += buf.size();
+	}
+
+	this->erase(key);
+
+	if (size > this->_max_size) {
+		return;
+	}
+
+	this->_evict(size);
+
+	this->_entries.push_front(entry{ key, std::move(bufs), etag, cache_control, size, expires, date });
+	this->_index.emplace(key, this->_entries.begin());
+	this->_size += size;
+}
+
+void response_cache::erase(const node::hashed_buffer& key) {
+	const auto it = this->_index.find(key);
+
+	if (it != this->_index.end()) {
+		this->_erase(it->second);
+	}
+}
+
+void response_cache::clear() {
+	this->_index.clear();
+	this->_entries.clear();
+	this->_size = 0;
+}
+
+uint64_t response_cache::max_age(const node::buffer_view& cache_control) noexcept {
+	const uint8_t* p = cache_control.begin();
+	const uint8_t* end = cache_control.end();
+
+	uint64_t max_age = UINT64_MAX;
+	uint64_t s_maxage = UINT64_MAX;
+
+	while (p != end) {
+		// skip the delimiter and leading whitespace of the next directive
+		while (p != end && (*p == ',' || is_whitespace(*p))) {
+			p++;
+		}
+
+		const uint8_t* beg = p;
+
+		while (p != end && *p != ',' && *p != '=' && !is_whitespace(*p)) {
+			p++;
+		}
+
+		const std::size_t len = std::size_t(p - beg);
+		const uint8_t* value_end = p;
+
+		while (value_end != end && *value_end != ',') {
+			value_end++;
+		}
+
+		if ((len == 8 && iequals(beg, "no-store", 8)) || (len == 8 && iequals(beg, "no-cache", 8)) || (len == 7 && iequals(beg, "private", 7))) {
+			return 0;
+		} else if (len == 7 && iequals(beg, "max-age", 7)) {
+			max_age = parse_delta_seconds(p, value_end);
+		} else if (len == 8 && iequals(beg, "s-maxage", 8)) {
+			s_maxage = parse_delta_seconds(p, value_end);
+		}
+
+		p = value_end;
+	}
+
+	if (s_maxage != UINT64_MAX) {
+		return s_maxage;
+	}
+
+	return max_age != UINT64_MAX ? max_age : 0;
+}
+
+void response_cache::_erase(list_type::iterator it) {
+	this->_size -= it->size;
+	this->_index.erase(it->key);
+	this->_entries.erase(it);
+}
+
+void response_cache::_evict(std::size_t required) {
+	while (!this->_entries.empty() && this->_size + required > this->_max_size) {
+		this->_erase(std::prev(this->_entries.end()));
+	}
+}
+
+} // namespace http
+} // namespace node
@@ -1,5 +1,7 @@
 #include "libnodecc/http/server.h"
 
+#include <stdexcept>
+
 #include "_status_codes.h"
 #include "libnodecc/http/_http_date_buffer.h"
 #include "libnodecc/util/base64.h"
@@ -34,7 +36,7 @@ static node::http::http_date_buffer date_buffer;
 namespace node {
 namespace http {
 
-server::server_response::server_response(const node::shared_ptr<node::tcp::socket>& socket) : outgoing_message(socket), _status_code(200), _shutdown_on_end(true) {
+server::server_response::server_response(const node::shared_ptr<node::tcp::socket>& socket) : outgoing_message(socket), _cache_expires(0), _cache_date(0), _start_time(0), _bytes_sent(0), _status_code(200), _shutdown_on_end(true), _auto_etag(false), _is_head(false) {
 }
 
 uint16_t server::server_response::status_code() const {
@@ -45,7 +47,46 @@ void server::server_response::set_status_code(uint16_t code) {
 	this->_status_code = code;
 }
 
+void server::server_response::set_auto_etag(bool enabled) {
+	this->_auto_etag = enabled;
+}
+
+void server::server_response::set_route(const node::buffer& route) {
+	this->_route = route;
+}
+
+void server::server_response::set_cookie(const node::buffer_view& name, const node::buffer_view& value, const cookie_attributes& attributes) {
+	using namespace node::literals;
+	this->add_header("set-cookie"_view, cookies::serialize(name, value, attributes));
+}
+
+void server::server_response::send(const static_response& response) {
+	// the prebuilt head would otherwise be appended to the one already written
+	if (this->_headers_sent) {
+		throw std::logic_error("headers already sent");
+	}
+
+	if (this->_socket) {
+		date_buffer.update(uv_now(*this->_socket.get()));
+	}
+
+	node::buffer buf = response.get(date_buffer.get_buffer());
+
+	this->_status_code = response.status_code();
+
+	// the body is located at the end of the serialized response
+	if (this->_is_head) {
+		buf = buf.slice(0, buf.size() - response.body_size());
+	} else if (this->_start_time) {
+		this->_bytes_sent += response.body_size();
+	}
+
+	this->_send_raw(&buf, 1);
+}
+
 void server::server_response::compile_headers(node::mutable_buffer& buf) {
+	using namespace node::literals;
+
 	uv_buf_t status = str_status_code(this->status_code());
 
 	if (!status.base) {
@@ -64,137 +105,610 @@ void server::server_response::compile_headers(node::mutable_buffer& buf) {
 	buf.append(status.base, status.len);
 	buf.append("\r\n");
 
-	if (this->_headers.find("date"_view) == this->_headers.cend()) {
+	const std::size_t status_size = buf.size();
+	const bool has_date = this->_headers.contains(header_list::date);
+
+	if (!has_date) {
 		date_buffer.update(uv_now(*this->socket().get()));
 		buf.append(date_buffer.get_buffer());
 	}
 
-	for (const auto& iter : this->_headers) {
-		buf.append(iter.first);
-		buf.append(": ");
-		buf.append(iter.second);
-		buf.append("\r\n");
-	}
+	const std::size_t date_size = buf.size() - status_size;
+
+	this->_headers.serialize(buf);
 
-	if (this->_shutdown_on_end && this->_headers.find("connection"_view) == this->_headers.cend()) {
+	if (this->_shutdown_on_end && !this->_headers.contains(header_list::connection)) {
 		buf.append("connection: close\r\n");
 	}
 
 	buf.append("\r\n");
+
+	if (this->_cache_key) {
+		const node::buffer* cache_control = this->_headers.find(header_list::cache_control);
+		const uint64_t max_age = cache_control ? response_cache::max_age(*cache_control) : 0;
+
+		/*
+		 * A chunked response can't be replayed as a single unit without recompiling it.
+		 * A custom "date" header couldn't be refreshed on cache hits.
+		 * A response varying on headers, which aren't part of the cache key, would be served to every client.
+		 */
+		bool is_cacheable = max_age > 0 && this->_status_code == 200 && !this->_is_chunked && !has_date && !this->_headers.contains(header_list::set_cookie);
+
+		for (const auto& header : this->_headers) {
+			if (is_cacheable && header.first.equals("vary"_view) && !this->_cache->is_vary_covered(header.second)) {
+				is_cacheable = false;
+			}
+		}
+
+		if (is_cacheable) {
+			const node::buffer* etag = this->_headers.find(header_list::etag);
+			const node::buffer& head = buf;
+
+			// the head is stored without the "date" header, which is inserted in between on cache hits
+			this->_cache_date = uv_now(*this->socket().get());
+			this->_cache_expires = this->_cache_date + max_age * 1000;
+			this->_cache_bufs.emplace_back(head.slice(0, status_size));
+			this->_cache_bufs.emplace_back(head.slice(status_size + date_size));
+			this->_cache_control = *cache_control;
+
+			if (etag) {
+				this->_cache_etag = *etag;
+			}
+		} else {
+			this->_cache_key = node::hashed_buffer();
+		}
+	}
+}
+
+void server::server_response::_write(const node::buffer chunks[], size_t chunkcnt) {
+	if (this->_start_time) {
+		for (size_t i = 0; i < chunkcnt; i++) {
+			this->_bytes_sent += chunks[i].size();
+		}
+	}
+
+	outgoing_message::_write(chunks, chunkcnt);
+
+	if (this->_cache_key) {
+		this->_capture(chunks, chunkcnt);
+	}
 }
 
 void server::server_response::_end(const node::buffer chunks[], size_t chunkcnt) {
-	auto socket = this->socket();
+	using namespace node::literals;
+
+	// the ETag can only be determined if the complete body is passed to end()
+	if (!this->_headers_sent && this->_status_code == 200) {
+		const node::buffer* tag = this->_headers.find(header_list::etag);
+
+		if (!tag && this->_auto_etag) {
+			this->_headers.add("etag"_view, etag::generate(chunks, chunkcnt));
+			tag = this->_headers.find(header_list::etag);
+		}
+
+		if (tag && this->_if_none_match && etag::matches(this->_if_none_match, *tag)) {
+			this->_status_code = 304;
+		}
+	}
+
+	if (this->_status_code == 304) {
+		this->_has_body = false;
+	}
+
+	if (this->_start_time && this->_has_body) {
+		for (size_t i = 0; i < chunkcnt; i++) {
+			this->_bytes_sent += chunks[i].size();
+		}
+	}
 
 	outgoing_message::_end(chunks, chunkcnt);
 
+	if (this->_cache_key) {
+		this->_capture(chunks, chunkcnt);
+		this->_cache->insert(this->_cache_key, std::move(this->_cache_bufs), this->_cache_expires, this->_cache_etag, this->_cache_control, this->_cache_date);
+	}
+
+	this->_finish();
+}
+
+void server::server_response::_send_raw(const node::buffer bufs[], size_t bufcnt, size_t headcnt) {
+	if (this->_socket) {
+		this->_socket->write(bufs, bufcnt);
+	}
+
+	// the first headcnt buffers contain the head
+	if (this->_start_time) {
+		for (size_t i = headcnt; i < bufcnt; i++) {
+			this->_bytes_sent += bufs[i].size();
+		}
+	}
+
+	this->_is_writable = false;
+	this->_finish();
+}
+
+void server::server_response::_finish() {
+	auto socket = this->socket();
+
 	if (this->_shutdown_on_end && socket) {
 		socket->end();
 	}
 
+	if (this->_start_time) {
+		const uint64_t latency = (uv_hrtime() - this->_start_time) / 1000;
+
+		if (this->_access_log) {
+			this->_access_log->log(this->_log_method, this->_log_path, this->_status_code, this->_bytes_sent, latency);
+			this->_access_log.reset();
+			this->_log_method.reset();
+			this->_log_path.reset();
+		}
+
+		if (this->_metrics) {
+			this->_metrics->record(this->_status_code, this->_route, latency, this->_bytes_sent);
+			this->_metrics.reset();
+		}
+
+		this->_route.reset();
+		this->_start_time = 0;
+		this->_bytes_sent = 0;
+	}
+
 	// reset fields for the next response in a keepalive connection
 	this->_status_code = 200;
 	this->_shutdown_on_end = true;
+	this->_cache.reset();
+	this->_cache_key = node::hashed_buffer();
+	this->_cache_bufs.clear();
+	this->_cache_etag.reset();
+	this->_cache_control.reset();
+	this->_if_none_match.reset();
+	this->_is_head = false;
+}
+
+void server::server_response::_detach() {
+	outgoing_message::_detach();
+
+	this->_status_code = 200;
+	this->_shutdown_on_end = true;
+	this->_auto_etag = false;
+	this->_cache.reset();
+	this->_cache_key = node::hashed_buffer();
+	this->_cache_bufs.clear();
+	this->_cache_etag.reset();
+	this->_cache_control.reset();
+	this->_cache_expires = 0;
+	this->_cache_date = 0;
+	this->_if_none_match.reset();
+	this->_is_head = false;
+	this->_access_log.reset();
+	this->_log_method.reset();
+	this->_log_path.reset();
+	this->_metrics.reset();
+	this->_route.reset();
+	this->_start_time = 0;
+	this->_bytes_sent = 0;
+}
+
+void server::server_response::_capture(const node::buffer chunks[], size_t chunkcnt) {
+	for (size_t i = 0; i < chunkcnt; i++) {
+		const node::buffer& chunk = chunks[i];
+
+		if (chunk) {
+			// weak buffers might refer to memory, which is only valid during the write() call
+			this->_cache_bufs.emplace_back(chunk.is_weak() ? chunk.copy() : chunk);
+		}
+	}
 }
 
 
 decltype(server::request_event) server::request_event;
+decltype(server::upgrade_event) server::upgrade_event;
 
-server::server(node::loop& loop) : tcp::server(loop), _is_destroyed(std::make_shared<bool>(false)) {
+server::server(node::loop& loop) : tcp::server(loop), _is_destroyed(std::make_shared<bool>(false)), _clients(nullptr), _connection_pool_size(128), _shed_requests(0), _is_shedding(false), _is_accept_paused(false), _auto_etag(false) {
 	this->on(connection_event, [this]() {
 		const auto socket = node::make_shared<tcp::socket>(*this);
-		this->accept(*socket);
-
-		this->_clients.emplace_front(socket);
 
-		const auto it = this->_clients.cbegin();
-		const auto req = node::make_shared<server_request>(socket, HTTP_REQUEST);
-		const auto res = node::make_shared<server_response>(socket);
+		if (!this->accept(*socket)) {
+			return;
+		}
 
-		// TODO: (create and) use node::weak_ptr instead?
-		const auto& _is_destroyed = this->_is_destroyed;
-		socket->on(destroy_event, [this, _is_destroyed, it, req, res]() {
-			req->destroy();
-			res->destroy();
+		connection* conn = this->_acquire_connection(socket);
 
-			if (!*_is_destroyed) {
-				this->_clients.erase(it);
+		// the socket might outlive the server
+		const auto& is_destroyed = this->_is_destroyed;
+		socket->on(destroy_event, [this, is_destroyed, conn]() {
+			if (!*is_destroyed) {
+				this->_release_connection(conn);
 			}
 		});
 
-		req->headers_complete_callback.connect([this, req, res](bool upgrade, bool keep_alive) {
-			using namespace node::literals;
+		socket->resume();
+	});
+}
 
-			/*
-			 * TODO: A HTTP_REQUEST parser should continously run
-			 * for the socket and *spawn* req/res pairs when needed.
-			 * The same goes for http::request().
-			 */
-			//res->_shutdown_on_end = !keep_alive;
-			//res->_reset();
+void server::set_cache(const std::shared_ptr<http::response_cache>& cache) {
+	this->_cache = cache;
+}
 
-			// RFC 2616 - 14.23
-			if (!req->has_header("host"_view)) {
-				res->set_status_code(400);
-				res->end();
-				return;
-			}
+const std::shared_ptr<http::response_cache>& server::cache() const {
+	return this->_cache;
+}
 
-			if (!this->has_listener(request_event)) {
-				res->set_status_code(500);
-				res->end();
-				return;
-			}
+void server::set_auto_etag(bool enabled) {
+	this->_auto_etag = enabled;
+}
+
+void server::set_access_log(const node::shared_ptr<http::access_log>& log) {
+	this->_access_log = log;
+}
+
+const node::shared_ptr<http::access_log>& server::access_log() const {
+	return this->_access_log;
+}
+
+void server::set_metrics(const std::shared_ptr<http::metrics>& metrics, const node::buffer& path) {
+	this->_metrics = metrics;
+	this->_metrics_path = metrics ? path : node::buffer();
+}
+
+const std::shared_ptr<http::metrics>& server::metrics() const {
+	return this->_metrics;
+}
+
+void server::set_connection_pool_size(std::size_t size) {
+	this->_connection_pool_size = size;
+
+	while (this->_connection_pool.size() > size) {
+		this->_delete_connection(this->_connection_pool.back());
+		this->_connection_pool.pop_back();
+	}
+}
+
+std::size_t server::connection_pool_size() const {
+	return this->_connection_pool_size;
+}
+
+void server::set_load_shedding(const load_shedding_options& options) {
+	this->_shedding = options;
+	this->_is_shedding = false;
+
+	if (this->_is_accept_paused) {
+		this->_is_accept_paused = false;
+		this->_set_suspended(false);
+	}
+
+	if (options.reject_above || options.pause_above) {
+		// the "date" header is the only part of the response, which changes
+		node::mutable_buffer head(128);
+		head.append("HTTP/1.1 503 Service Unavailable\r\nretry-after: ");
+		head.append_number(std::size_t(options.retry_after));
+		head.append("\r\ncontent-length: 0\r\nconnection: close\r\n");
+		this->_shed_head = head;
+
+		if (!this->_lag_monitor) {
+			this->_lag_monitor = node::make_shared<util::lag_monitor>(*this);
+
+			// the lag is sampled as well, as otherwise paused connections would never be accepted again
+			this->_lag_monitor->on(util::lag_monitor::lag_event, [this](uint64_t) {
+				this->_update_shedding(this->_lag_monitor->lag());
+			});
+		}
+
+		this->_lag_monitor->start(options.interval);
+	} else if (this->_lag_monitor) {
+		this->_lag_monitor->destroy();
+		this->_lag_monitor.reset();
+		this->_shed_head.reset();
+	}
+}
+
+const load_shedding_options& server::load_shedding() const {
+	return this->_shedding;
+}
+
+uint64_t server::loop_lag() const {
+	return this->_lag_monitor ? this->_lag_monitor->lag() : 0;
+}
+
+bool server::is_shedding() const {
+	return this->_is_shedding;
+}
+
+uint64_t server::shed_requests() const {
+	return this->_shed_requests;
+}
+
+server::connection* server::_acquire_connection(const node::shared_ptr<tcp::socket>& socket) {
+	connection* conn;
+
+	if (this->_connection_pool.empty()) {
+		conn = new connection();
+		conn->req = node::make_shared<server_request>(socket, HTTP_REQUEST);
+		conn->res = node::make_shared<server_response>(socket);
+
+		// only raw pointers may be captured here - shared ones would form a cycle
+		conn->req->headers_complete_callback.connect([this, conn](bool upgrade, bool keep_alive) {
+			this->_on_headers_complete(conn, upgrade, keep_alive);
+		});
+	} else {
+		conn = this->_connection_pool.back();
+		this->_connection_pool.pop_back();
+
+		conn->req->_attach(socket);
+		conn->res->_attach(socket);
+	}
+
+	conn->socket = socket;
+	conn->prev = nullptr;
+	conn->next = this->_clients;
+
+	if (this->_clients) {
+		this->_clients->prev = conn;
+	}
+
+	this->_clients = conn;
+
+	return conn;
+}
+
+void server::_release_connection(connection* conn) {
+	if (conn->prev) {
+		conn->prev->next = conn->next;
+	} else {
+		this->_clients = conn->next;
+	}
+
+	if (conn->next) {
+		conn->next->prev = conn->prev;
+	}
+
+	conn->socket.reset();
+
+	/*
+	 * If the user still holds a reference to the request or response,
+	 * reusing them would be observable and they are thus destroyed instead.
+	 */
+	if (!*this->_is_destroyed && this->_connection_pool.size() < this->_connection_pool_size && conn->req.use_count() == 1 && conn->res.use_count() == 1) {
+		conn->req->_detach();
+		conn->res->_detach();
+		this->_connection_pool.push_back(conn);
+	} else {
+		this->_delete_connection(conn);
+	}
+}
+
+void server::_delete_connection(connection* conn) {
+	conn->req->destroy();
+	conn->res->destroy();
+	delete conn;
+}
+
+void server::_on_headers_complete(connection* conn, bool upgrade, bool keep_alive) {
+	using namespace node::literals;
+
+	/*
+	 * The connection might be released by one of the calls below
+	 * (e.g. if the socket gets destroyed) and thus copies are used.
+	 */
+	const auto req = conn->req;
+	const auto res = conn->res;
 
-			if (upgrade) {
-				// TODO: externalize into upgrade adaptor classes
-				/*
-				if (req->_is_websocket == 1) {
-					static const auto websocketMagic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"_view;
-					const auto key = req->header("sec-websocket-key"_view);
-					uint8_t digest[SHA1_DIGEST_LENGTH];
-
-					node::mutable_buffer buffer;
-					buffer.set_capacity(key.size() + websocketMagic.size());
-					buffer.append(key);
-					buffer.append(websocketMagic);
-
-					node::util::sha1 s;
-					s.push(buffer);
-					s.get_digest(digest);
-
-					const auto acceptHash = node::util::base64::encode(node::buffer_view(digest, sizeof(digest)));
-
-					res->_shutdown_on_end = true;
-					res->set_status_code(101);
-					res->set_header("connection"_view, "upgrade"_view);
-					res->set_header("upgrade"_view,    "websocket"_view);
-					res->set_header("sec-websocket-accept"_view, acceptHash);
-					res->send_headers();
-					return;
-				}
-				*/
-
-				res->set_status_code(501);
+	/*
+	 * TODO: A HTTP_REQUEST parser should continously run
+	 * for the socket and *spawn* req/res pairs when needed.
+	 * The same goes for http::request().
+	 */
+	//res->_shutdown_on_end = !keep_alive;
+	//res->_reset();
+
+	if (this->_access_log || this->_metrics) {
+		res->_access_log = this->_access_log;
+		res->_metrics = this->_metrics;
+		res->_start_time = uv_hrtime();
+
+		if (this->_access_log) {
+			res->_log_method = req->method();
+			res->_log_path = req->url();
+		}
+	}
+
+	if (this->_lag_monitor) {
+		this->_update_shedding(this->_lag_monitor->lag());
+	}
+
+	if (this->_is_shedding) {
+		static const node::buffer crlf(node::literal_string("\r\n", 2));
+
+		date_buffer.update(uv_now(*this));
+
+		const node::buffer bufs[] = { this->_shed_head, date_buffer.get_buffer(), crlf };
+
+		this->_shed_requests++;
+		res->set_status_code(503);
+		res->_send_raw(bufs, 3, 3);
+		return;
+	}
+
+	// RFC 2616 - 14.23
+	if (!req->has_header("host"_view)) {
+		res->set_status_code(400);
+		res->end();
+		return;
+	}
+
+	if (upgrade && this->has_listener(upgrade_event)) {
+		const auto socket = conn->socket;
+
+		// called by the request right after this method returned, once the head has been consumed
+		req->upgrade_callback.connect([this, req, socket](const node::buffer& head) {
+			this->emit(upgrade_event, req, socket, head);
+		});
+
+		return;
+	}
+
+	if (!this->has_listener(request_event)) {
+		res->set_status_code(500);
+		res->end();
+		return;
+	}
+
+	if (upgrade) {
+		// TODO: externalize into upgrade adaptor classes
+		/*
+		if (req->_is_websocket == 1) {
+			static const auto websocketMagic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"_view;
+			const auto key = req->header("sec-websocket-key"_view);
+			uint8_t digest[SHA1_DIGEST_LENGTH];
+
+			node::mutable_buffer buffer;
+			buffer.set_capacity(key.size() + websocketMagic.size());
+			buffer.append(key);
+			buffer.append(websocketMagic);
+
+			node::util::sha1 s;
+			s.push(buffer);
+			s.get_digest(digest);
+
+			const auto acceptHash = node::util::base64::encode(node::buffer_view(digest, sizeof(digest)));
+
+			res->_shutdown_on_end = true;
+			res->set_status_code(101);
+			res->set_header("connection"_view, "upgrade"_view);
+			res->set_header("upgrade"_view,    "websocket"_view);
+			res->set_header("sec-websocket-accept"_view, acceptHash);
+			res->send_headers();
+			return;
+		}
+		*/
+
+		res->set_status_code(501);
+		res->end();
+		return;
+	}
+
+	if (this->_metrics_path && req->url().equals(this->_metrics_path) && req->method().equals("GET"_view)) {
+		res->set_header("content-type"_view, "text/plain; version=0.0.4"_view);
+		res->set_header("cache-control"_view, "no-store"_view);
+		res->end(this->_metrics->to_text());
+		return;
+	}
+
+	const auto& headers = req->headers();
+	const auto if_none_match = headers.find("if-none-match"_view);
+
+	/*
+	 * RFC 7232 §3.2 - only GET and HEAD may be answered with "304 Not Modified".
+	 * Other methods would require a 412 before the handler performed them,
+	 * which is up to the handler and thus their response is left unchanged.
+	 */
+	if (if_none_match != headers.cend() && (req->method().equals("GET"_view) || req->method().equals("HEAD"_view))) {
+		res->_if_none_match = if_none_match->second;
+	}
+
+	res->_auto_etag = this->_auto_etag;
+	res->_is_head = req->method().equals("HEAD"_view);
+
+	if (this->_cache && req->method().equals("GET"_view) && headers.find("authorization"_view) == headers.cend()) {
+		const uint64_t now = uv_now(*this);
+		auto key = this->_cache->key(*req);
+		const auto entry = this->_cache->find(key, now);
+
+		if (entry) {
+			// RFC 7234 §4 and §5.1 - a cached response is sent with a current "date" and its "age"
+			node::mutable_buffer age(32);
+			age.append("age: ");
+			age.append_number(std::size_t((now - entry->date) / 1000));
+			age.append("\r\n");
+
+			if (entry->etag && res->_if_none_match && etag::matches(res->_if_none_match, entry->etag)) {
+				res->set_status_code(304);
+				res->set_header("etag"_view, entry->etag);
+				res->set_header("cache-control"_view, entry->cache_control);
+				res->set_header("age"_view, age.slice(5, age.size() - 2));
 				res->end();
-				return;
+			} else {
+				date_buffer.update(now);
+
+				// the head consists of the status line, "date", "age" and the remaining headers
+				std::vector<node::buffer> bufs;
+				bufs.reserve(entry->bufs.size() + 2);
+				bufs.emplace_back(entry->bufs[0]);
+				bufs.emplace_back(date_buffer.get_buffer());
+				bufs.emplace_back(age);
+				bufs.insert(bufs.end(), entry->bufs.begin() + 1, entry->bufs.end());
+
+				res->_send_raw(bufs.data(), bufs.size(), 4);
 			}
 
-			this->emit(request_event, req, res);
-		});
+			return;
+		}
 
-		socket->resume();
-	});
+		res->_cache = this->_cache;
+		res->_cache_key = std::move(key);
+	}
+
+	this->emit(request_event, req, res);
+}
+
+/*
+ * Applies the thresholds of the load shedding options with hysteresis,
+ * i.e. a measure is only lifted once the lag is well below its threshold,
+ * so that it doesn't flap around the threshold.
+ */
+void server::_update_shedding(uint64_t lag) {
+	const load_shedding_options& o = this->_shedding;
+
+	if (o.reject_above) {
+		const uint64_t recover = o.recover_below ? o.recover_below : o.reject_above / 2;
+
+		if (lag > uint64_t(o.reject_above) * 1000) {
+			this->_is_shedding = true;
+		} else if (lag <= recover * 1000) {
+			this->_is_shedding = false;
+		}
+	}
+
+	if (o.pause_above) {
+		const uint64_t recover = o.recover_below ? o.recover_below : o.pause_above / 2;
+
+		if (lag > uint64_t(o.pause_above) * 1000) {
+			if (!this->_is_accept_paused) {
+				this->_is_accept_paused = true;
+				this->_set_suspended(true);
+			}
+		} else if (lag <= recover * 1000 && this->_is_accept_paused) {
+			this->_is_accept_paused = false;
+			this->_set_suspended(false);
+		}
+	}
 }
 
 void server::_destroy() {
+	// closing the connections below would otherwise accept pending ones
+	this->pause_accepting();
+
+	if (this->_lag_monitor) {
+		this->_lag_monitor->destroy();
+		this->_lag_monitor.reset();
+	}
+
+	// destroying a socket releases its connection into the pool, which is cleared below
+	for (connection* conn = this->_clients; conn;) {
+		connection* next = conn->next;
+		conn->socket->destroy();
+		conn = next;
+	}
+
 	*this->_is_destroyed = true;
 
-	for (const auto& socket : this->_clients) {
-		socket->destroy();
+	for (connection* conn : this->_connection_pool) {
+		this->_delete_connection(conn);
 	}
 
-	this->_clients.clear();
+	this->_clients = nullptr;
+	this->_connection_pool.clear();
 
 	node::tcp::server::_destroy();
 }
@@ -0,0 +1,92 @@
+#include "libnodecc/http/static_response.h"
+
+#include <cstring>
+
+#include "_status_codes.h"
+
+
+namespace {
+
+node::buffer_view status_line(uint16_t status_code) {
+	switch (status_code) {
+#define XX(_status_, _len_, _str_) case _status_: return node::buffer_view(_str_, _len_);
+	STATUS_CODES(XX)
+#undef XX
+	default: return node::buffer_view();
+	}
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+static_response::static_response(uint16_t status_code, const header_list& headers, const node::buffer& body) : _body_size(body.size()), _status_code(status_code) {
+	using namespace node::literals;
+
+	node::buffer_view status = status_line(status_code);
+
+	if (!status) {
+		this->_status_code = 500;
+		status = status_line(500);
+	}
+
+	node::mutable_buffer buf(256 + body.size());
+	buf.append("HTTP/1.1 ");
+	buf.append(status.data(), status.size());
+	buf.append("\r\n");
+
+	// the placeholder has the length of "date: Tue, 15 Nov 1994 08:12:31 GMT\r\n"
+	this->_date_offset = buf.size();
+	buf.append("date: Thu, 01 Jan 1970 00:00:00 GMT\r\n");
+
+	for (const auto& header : headers) {
+		if (header.first.equals("date"_view) || header.first.equals("content-length"_view)) {
+			continue;
+		}
+
+		buf.append(header.first.data(), header.first.size());
+		buf.append(": ");
+		buf.append(header.second.data(), header.second.size());
+		buf.append("\r\n");
+	}
+
+	buf.append("content-length: ");
+	buf.append_number(body.size());
+	buf.append("\r\n");
+
+	if (!headers.contains(header_list::connection)) {
+		buf.append("connection: close\r\n");
+	}
+
+	buf.append("\r\n");
+	buf.append(body.data(), body.size());
+
+	this->_buffer = buf;
+}
+
+node::buffer static_response::get(const node::buffer& date) const {
+	// the date buffer is replaced (and not modified) whenever it changes
+	if (date.data() != this->_date.data() && date.size() == 37) {
+		if (this->_buffer.use_count() > 1) {
+			this->_buffer = this->_buffer.copy();
+		}
+
+		memcpy(this->_buffer.data() + this->_date_offset, date.data(), date.size());
+		this->_date = date;
+	}
+
+	return this->_buffer;
+}
+
+uint16_t static_response::status_code() const noexcept {
+	return this->_status_code;
+}
+
+std::size_t static_response::body_size() const noexcept {
+	return this->_body_size;
+}
+
+} // namespace http
+} // namespace node
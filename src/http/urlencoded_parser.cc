@@ -0,0 +1,200 @@
+#include "libnodecc/http/urlencoded_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+// returns 0xff for invalid hex digits
+uint8_t hex_to_int(uint8_t ch) {
+	if (ch >= '0' && ch <= '9') {
+		return ch - '0';
+	}
+
+	ch |= 0x20;
+
+	if (ch >= 'a' && ch <= 'f') {
+		return ch - 'a' + 10;
+	}
+
+	return 0xff;
+}
+
+const uint8_t* find_escape(const uint8_t* p, const uint8_t* end) {
+	while (p != end && *p != '%' && *p != '+') {
+		p++;
+	}
+
+	return p;
+}
+
+} // namespace
+
+
+namespace node {
+namespace http {
+
+const std::size_t urlencoded_parser::arena_block_size;
+
+urlencoded_parser::urlencoded_parser() : _arena_used(0) {
+}
+
+void urlencoded_parser::push(const node::buffer& data) {
+	const uint8_t* p = data.data();
+	const std::size_t size = data.size();
+	std::size_t i = 0;
+
+	while (i < size) {
+		const void* amp = memchr(p + i, '&', size - i);
+
+		if (!amp) {
+			this->_partial.append(p + i, size - i);
+			break;
+		}
+
+		const std::size_t j = std::size_t(static_cast<const uint8_t*>(amp) - p);
+
+		if (this->_partial.size() != 0) {
+			// the pair started in a previous slice
+			this->_partial.append(p + i, j - i);
+
+			const node::buffer pair(this->_partial);
+			this->_partial.reset();
+			this->_add(pair);
+		} else if (j != i) {
+			this->_add(data.slice(i, j));
+		}
+
+		i = j + 1;
+	}
+}
+
+void urlencoded_parser::finish() {
+	if (this->_partial.size() != 0) {
+		const node::buffer pair(this->_partial);
+		this->_partial.reset();
+		this->_add(pair);
+	}
+}
+
+const node::buffer* urlencoded_parser::find(const node::buffer_view& key) const noexcept {
+	for (const auto& pair : this->_pairs) {
+		if (pair.first.equals(key)) {
+			return &pair.second;
+		}
+	}
+
+	return nullptr;
+}
+
+std::size_t urlencoded_parser::count(const node::buffer_view& key) const noexcept {
+	std::size_t n = 0;
+
+	for (const auto& pair : this->_pairs) {
+		if (pair.first.equals(key)) {
+			n++;
+		}
+	}
+
+	return n;
+}
+
+std::size_t urlencoded_parser::size() const noexcept {
+	return this->_pairs.size();
+}
+
+bool urlencoded_parser::empty() const noexcept {
+	return this->_pairs.empty();
+}
+
+urlencoded_parser::const_iterator urlencoded_parser::begin() const noexcept {
+	return this->_pairs.cbegin();
+}
+
+urlencoded_parser::const_iterator urlencoded_parser::end() const noexcept {
+	return this->_pairs.cend();
+}
+
+void urlencoded_parser::clear() noexcept {
+	this->_pairs.clear();
+	this->_partial.reset();
+	this->_arena.reset();
+	this->_arena_used = 0;
+}
+
+void urlencoded_parser::_add(const node::buffer& pair) {
+	const void* eq = memchr(pair.data(), '=', pair.size());
+	node::buffer key;
+	node::buffer value;
+
+	if (eq) {
+		const std::size_t pos = std::size_t(static_cast<const uint8_t*>(eq) - pair.data());
+		key = this->_decode(pair.slice(0, pos));
+		value = this->_decode(pair.slice(pos + 1));
+	} else {
+		key = this->_decode(pair);
+	}
+
+	this->_pairs.emplace_back(key, value);
+	this->pair_callback.emit(key, value);
+}
+
+/*
+ * Invalid escapes are kept as is, just like browsers do.
+ */
+node::buffer urlencoded_parser::_decode(const node::buffer& buf) {
+	const uint8_t* p = buf.data();
+	const uint8_t* end = buf.end();
+	const uint8_t* q = find_escape(p, end);
+
+	if (q == end) {
+		return buf;
+	}
+
+	// the decoded string is never longer than the encoded one
+	const std::size_t size = buf.size();
+
+	if (this->_arena.size() - this->_arena_used < size) {
+		this->_arena = node::buffer(std::max(size, arena_block_size));
+		this->_arena_used = 0;
+	}
+
+	uint8_t* const out_beg = this->_arena.data() + this->_arena_used;
+	uint8_t* out = out_beg;
+
+	memcpy(out, p, std::size_t(q - p));
+	out += q - p;
+
+	while (q != end) {
+		if (*q == '+') {
+			*out++ = ' ';
+			q++;
+			continue;
+		}
+
+		if (*q == '%' && end - q > 2) {
+			const uint8_t hi = hex_to_int(q[1]);
+			const uint8_t lo = hex_to_int(q[2]);
+
+			if (hi < 16 && lo < 16) {
+				*out++ = uint8_t(hi << 4 | lo);
+				q += 3;
+				continue;
+			}
+		}
+
+		const uint8_t* r = find_escape(q + 1, end);
+		memcpy(out, q, std::size_t(r - q));
+		out += r - q;
+		q = r;
+	}
+
+	const std::size_t beg = this->_arena_used;
+	this->_arena_used += std::size_t(out - out_beg);
+
+	return this->_arena.slice(beg, this->_arena_used);
+}
+
+} // namespace http
+} // namespace node
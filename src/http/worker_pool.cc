@@ -0,0 +1,135 @@
+#include "libnodecc/http/worker_pool.h"
+
+#include <memory>
+#include <system_error>
+
+#include "libnodecc/uv/queue_work.h"
+
+
+namespace node {
+namespace http {
+
+worker_pool::worker_pool(node::loop& loop, std::size_t max_concurrency, std::size_t max_queued) : _loop(loop), _completed(0), _rejected(0), _max_concurrency(max_concurrency ? max_concurrency : 1), _max_queued(max_queued), _running(0) {
+}
+
+bool worker_pool::submit(work_t work, done_t done) {
+	job j{std::move(work), std::move(done), uv_hrtime()};
+
+	if (this->_running < this->_max_concurrency) {
+		this->_start(std::move(j));
+	} else if (this->_queue.size() < this->_max_queued) {
+		this->_queue.emplace_back(std::move(j));
+	} else {
+		this->_rejected++;
+		return false;
+	}
+
+	return true;
+}
+
+bool worker_pool::submit(const server::response& res, work_t work) {
+	const bool accepted = this->submit(std::move(work), [res](const std::exception_ptr& err, const node::buffer& result) {
+		if (err) {
+			res->set_status_code(500);
+			res->end();
+		} else {
+			res->end(result);
+		}
+	});
+
+	if (!accepted) {
+		res->set_status_code(503);
+		res->end();
+	}
+
+	return accepted;
+}
+
+std::size_t worker_pool::running() const noexcept {
+	return this->_running;
+}
+
+std::size_t worker_pool::queued() const noexcept {
+	return this->_queue.size();
+}
+
+uint64_t worker_pool::completed() const noexcept {
+	return this->_completed;
+}
+
+uint64_t worker_pool::rejected() const noexcept {
+	return this->_rejected;
+}
+
+const node::util::histogram& worker_pool::wait_time() const noexcept {
+	return this->_wait_time;
+}
+
+const node::util::histogram& worker_pool::run_time() const noexcept {
+	return this->_run_time;
+}
+
+/*
+ * Jobs which haven't been started yet are cancelled,
+ * while running ones still complete and call their done callback.
+ */
+void worker_pool::_destroy() {
+	std::deque<job> queue;
+	queue.swap(this->_queue);
+
+	const auto err = std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::operation_canceled)));
+
+	for (const auto& j : queue) {
+		j.done(err, node::buffer());
+	}
+
+	node::object::_destroy();
+}
+
+void worker_pool::_start(job&& j) {
+	struct task {
+		job j;
+		node::buffer result;
+		std::exception_ptr err;
+		uint64_t run_time;
+	};
+
+	const auto t = std::make_shared<task>();
+	t->j = std::move(j);
+
+	this->_wait_time.record((uv_hrtime() - t->j.submit_time) / 1000);
+	this->_running++;
+
+	// released once the job has completed
+	this->retain();
+
+	// the task is only accessed by one thread at a time, separated by the thread pool's queue
+	node::uv::queue_work(this->_loop, [t]() {
+		const uint64_t start = uv_hrtime();
+
+		try {
+			t->result = t->j.work();
+		} catch (...) {
+			t->err = std::current_exception();
+		}
+
+		t->run_time = (uv_hrtime() - start) / 1000;
+	}, [this, t]() {
+		this->_running--;
+		this->_completed++;
+		this->_run_time.record(t->run_time);
+
+		// the next job is started first, so that done may submit further ones
+		if (!this->_queue.empty()) {
+			job next = std::move(this->_queue.front());
+			this->_queue.pop_front();
+			this->_start(std::move(next));
+		}
+
+		t->j.done(t->err, t->result);
+		this->release();
+	});
+}
+
+} // namespace http
+} // namespace node
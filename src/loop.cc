@@ -1,21 +1,26 @@
 #include "libnodecc/loop.h"
 
+#include <algorithm>
+
 
 namespace node {
 
-loop::loop() {
+loop::loop() : _next_timeout_id(1) {
 	node::uv::check(uv_loop_init(&this->_loop));
 	node::uv::check(uv_async_init(&this->_loop, &this->_tick_async, &loop::_on_async));
+	node::uv::check(uv_timer_init(&this->_loop, &this->_timer));
 
 	uv_unref(reinterpret_cast<uv_handle_t*>(&this->_tick_async));
 
 	this->_loop.data = this;
 	this->_tick_async.data = this;
+	this->_timer.data = this;
 }
 
 loop::~loop() {
 	uv_close(reinterpret_cast<uv_handle_t*>(&this->_tick_async), nullptr);
-	this->run(); // close the async handle
+	uv_close(reinterpret_cast<uv_handle_t*>(&this->_timer), nullptr);
+	this->run(); // close the async and timer handle
 	node::uv::check(uv_loop_close(&this->_loop));
 }
 
@@ -39,6 +44,53 @@ bool loop::alive() {
 	return uv_loop_alive(&this->_loop) != 0;
 }
 
+uint64_t loop::set_timeout(uint64_t timeout, on_tick_t cb) {
+	const uint64_t id = this->_next_timeout_id++;
+	const uint64_t due = uv_now(&this->_loop) + timeout;
+
+	// rebuild the heap once it mostly consists of cleared timeouts
+	if (this->_timeouts.size() >= 64 && this->_timeouts.size() > 2 * this->_timeout_callbacks.size()) {
+		const auto& callbacks = this->_timeout_callbacks;
+
+		this->_timeouts.erase(std::remove_if(this->_timeouts.begin(), this->_timeouts.end(), [&callbacks](const timeout_entry& t) {
+			return callbacks.find(t.id) == callbacks.end();
+		}), this->_timeouts.end());
+
+		std::make_heap(this->_timeouts.begin(), this->_timeouts.end());
+	}
+
+	this->_timeout_callbacks.emplace(id, std::move(cb));
+	this->_timeouts.push_back(timeout_entry{ due, id });
+	std::push_heap(this->_timeouts.begin(), this->_timeouts.end());
+
+	// only rearm the timer if this is the earliest timeout now
+	if (this->_timeouts.front().id == id) {
+		this->_arm_timer();
+	}
+
+	return id;
+}
+
+bool loop::clear_timeout(uint64_t id) {
+	const auto it = this->_timeout_callbacks.find(id);
+
+	if (it == this->_timeout_callbacks.end()) {
+		return false;
+	}
+
+	// see callback::clear() - the function might hold the last reference to its owner
+	on_tick_t cb;
+	std::swap(cb, it->second);
+	this->_timeout_callbacks.erase(it);
+
+	if (this->_timeout_callbacks.empty()) {
+		this->_timeouts.clear();
+		uv_timer_stop(&this->_timer);
+	}
+
+	return true;
+}
+
 loop::operator uv_loop_t*() {
 	return &this->_loop;
 }
@@ -70,4 +122,45 @@ void loop::_on_async(uv_async_t* handle) noexcept {
 	self->_tick_callbacks.clear();
 }
 
+void loop::_on_timer(uv_timer_t* handle) noexcept {
+	auto self = reinterpret_cast<loop*>(handle->data);
+	const uint64_t now = uv_now(&self->_loop);
+
+	while (!self->_timeouts.empty() && self->_timeouts.front().due <= now) {
+		const uint64_t id = self->_timeouts.front().id;
+
+		std::pop_heap(self->_timeouts.begin(), self->_timeouts.end());
+		self->_timeouts.pop_back();
+
+		const auto it = self->_timeout_callbacks.find(id);
+
+		if (it != self->_timeout_callbacks.end()) {
+			// the callback might set or clear timeouts itself
+			const on_tick_t cb = std::move(it->second);
+			self->_timeout_callbacks.erase(it);
+			cb();
+		}
+	}
+
+	self->_arm_timer();
+}
+
+void loop::_arm_timer() {
+	// skip cleared timeouts, to not wake up for them
+	while (!this->_timeouts.empty() && this->_timeout_callbacks.find(this->_timeouts.front().id) == this->_timeout_callbacks.end()) {
+		std::pop_heap(this->_timeouts.begin(), this->_timeouts.end());
+		this->_timeouts.pop_back();
+	}
+
+	if (this->_timeouts.empty()) {
+		uv_timer_stop(&this->_timer);
+		return;
+	}
+
+	const uint64_t now = uv_now(&this->_loop);
+	const uint64_t due = this->_timeouts.front().due;
+
+	uv_timer_start(&this->_timer, &loop::_on_timer, due > now ? due - now : 0, 0);
+}
+
 } // namespace node
@@ -0,0 +1,143 @@
+#include "libnodecc/tcp/address_counter.h"
+
+#include <cstring>
+
+#include "libnodecc/buffer.h"
+#include "libnodecc/util/fnv.h"
+
+
+namespace node {
+namespace tcp {
+
+address_counter::address_counter() : _size(0) {
+}
+
+uint32_t address_counter::increment(const sockaddr& addr) {
+	// the load factor is kept below 1/2, which keeps probe sequences short
+	if ((this->_size + 1) * 2 > this->_slots.size()) {
+		this->_grow();
+	}
+
+	uint8_t key[16];
+	address_counter::_key(addr, key);
+
+	slot& s = this->_slots[this->_find(key)];
+
+	if (s.count == 0) {
+		memcpy(s.address, key, sizeof(key));
+		this->_size++;
+	}
+
+	return ++s.count;
+}
+
+/*
+ * Empty slots have a count of zero. Since there are no tombstones, removing
+ * an address shifts subsequent entries of the same probe sequence backwards.
+ */
+uint32_t address_counter::decrement(const sockaddr& addr) {
+	if (this->_size == 0) {
+		return 0;
+	}
+
+	uint8_t key[16];
+	address_counter::_key(addr, key);
+
+	const std::size_t mask = this->_slots.size() - 1;
+	std::size_t i = this->_find(key);
+
+	if (this->_slots[i].count == 0) {
+		return 0;
+	}
+
+	if (--this->_slots[i].count != 0) {
+		return this->_slots[i].count;
+	}
+
+	this->_size--;
+
+	for (std::size_t j = (i + 1) & mask; this->_slots[j].count != 0; j = (j + 1) & mask) {
+		const std::size_t home = this->_home(this->_slots[j].address);
+
+		// the entry at j may only be moved to i, if i lies cyclically within [home, j)
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			this->_slots[i] = this->_slots[j];
+			this->_slots[j].count = 0;
+			i = j;
+		}
+	}
+
+	return 0;
+}
+
+uint32_t address_counter::count(const sockaddr& addr) const {
+	if (this->_size == 0) {
+		return 0;
+	}
+
+	uint8_t key[16];
+	address_counter::_key(addr, key);
+
+	return this->_slots[this->_find(key)].count;
+}
+
+std::size_t address_counter::size() const noexcept {
+	return this->_size;
+}
+
+void address_counter::clear() noexcept {
+	this->_slots.clear();
+	this->_size = 0;
+}
+
+void address_counter::_key(const sockaddr& addr, uint8_t key[16]) {
+	if (addr.sa_family == AF_INET6) {
+		memcpy(key, &reinterpret_cast<const sockaddr_in6&>(addr).sin6_addr, 16);
+	} else {
+		static const uint8_t mapped_prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+		memcpy(key, mapped_prefix, 12);
+		memcpy(key + 12, &reinterpret_cast<const sockaddr_in&>(addr).sin_addr, 4);
+	}
+}
+
+std::size_t address_counter::_home(const uint8_t key[16]) const {
+	return node::util::fnv1a<uint32_t>::hash(node::buffer_view(key, 16)) & (this->_slots.size() - 1);
+}
+
+/*
+ * Returns the index of the slot containing the key,
+ * or the index of the empty slot, where it would be inserted.
+ */
+std::size_t address_counter::_find(const uint8_t key[16]) const {
+	const std::size_t mask = this->_slots.size() - 1;
+	std::size_t i = this->_home(key);
+
+	while (this->_slots[i].count != 0 && memcmp(this->_slots[i].address, key, 16) != 0) {
+		i = (i + 1) & mask;
+	}
+
+	return i;
+}
+
+void address_counter::_grow() {
+	std::vector<slot> slots(this->_slots.empty() ? 16 : this->_slots.size() * 2);
+	slots.swap(this->_slots);
+
+	const std::size_t mask = this->_slots.size() - 1;
+
+	for (const slot& s : slots) {
+		if (s.count != 0) {
+			std::size_t i = this->_home(s.address);
+
+			while (this->_slots[i].count != 0) {
+				i = (i + 1) & mask;
+			}
+
+			this->_slots[i] = s;
+		}
+	}
+}
+
+} // namespace tcp
+} // namespace node
@@ -0,0 +1,349 @@
+#include "libnodecc/tcp/forwarder.h"
+
+#ifdef __linux__
+# include <fcntl.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+
+namespace node {
+namespace tcp {
+
+#ifdef __linux__
+
+struct forwarder::splice_state {
+	/*
+	 * Each socket is polled through a duplicate of its descriptor, since
+	 * libuv can't watch a single descriptor with more than one handle.
+	 */
+	struct side {
+		int fd = -1;
+		int events = 0;
+		uv_poll_t* poll = nullptr;
+	};
+
+	// data read from sides[i] is buffered in pipes[i], until it's written to the other side
+	struct pipe {
+		int fds[2] = {-1, -1};
+		std::size_t capacity = 0;
+		std::size_t pending = 0;
+		bool has_ended = false;
+		bool is_shut_down = false;
+	};
+
+	~splice_state() {
+		for (auto& side : this->sides) {
+			if (side.poll) {
+				uv_close(reinterpret_cast<uv_handle_t*>(side.poll), [](uv_handle_t* handle) {
+					delete reinterpret_cast<uv_poll_t*>(handle);
+				});
+			}
+
+			if (side.fd >= 0) {
+				close(side.fd);
+			}
+		}
+
+		for (auto& pipe : this->pipes) {
+			for (const int fd : pipe.fds) {
+				if (fd >= 0) {
+					close(fd);
+				}
+			}
+		}
+	}
+
+	side sides[2];
+	pipe pipes[2];
+};
+
+#else
+
+struct forwarder::splice_state {
+};
+
+#endif
+
+
+forwarder::forwarder(const node::shared_ptr<node::tcp::socket>& a, const node::shared_ptr<node::tcp::socket>& b) : _sockets{a, b}, _bytes{0, 0}, _is_destroyed{false, false}, _destroyed_sockets(0), _is_spliced(false), _is_finished(false) {
+}
+
+forwarder::~forwarder() {
+}
+
+void forwarder::start() {
+	// released by _finish()
+	this->retain();
+
+	if (!this->_start_splice()) {
+		this->_start_buffered();
+	}
+}
+
+uint64_t forwarder::bytes_a_to_b() const noexcept {
+	return this->_bytes[0];
+}
+
+uint64_t forwarder::bytes_b_to_a() const noexcept {
+	return this->_bytes[1];
+}
+
+bool forwarder::is_spliced() const noexcept {
+	return this->_is_spliced;
+}
+
+#ifdef __linux__
+
+bool forwarder::_start_splice() {
+	for (const auto& socket : this->_sockets) {
+		socket->uncork();
+
+		// splicing would overtake writes, which are still queued in libuv
+		if (static_cast<uv_tcp_t*>(*socket)->write_queue_size != 0) {
+			return false;
+		}
+	}
+
+	std::unique_ptr<splice_state> state(new splice_state);
+
+	for (std::size_t i = 0; i < 2; i++) {
+		auto& side = state->sides[i];
+		auto& pipe = state->pipes[i];
+		uv_os_fd_t fd;
+
+		if (uv_fileno(*this->_sockets[i], &fd) != 0) {
+			return false;
+		}
+
+		side.fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+
+		if (side.fd < 0 || pipe2(pipe.fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+			return false;
+		}
+
+		const int capacity = fcntl(pipe.fds[1], F_GETPIPE_SZ);
+		pipe.capacity = capacity > 0 ? std::size_t(capacity) : 65536;
+
+		side.poll = new uv_poll_t;
+
+		if (uv_poll_init(*this->_sockets[i], side.poll, side.fd) != 0) {
+			delete side.poll;
+			side.poll = nullptr;
+			return false;
+		}
+
+		side.poll->data = this;
+	}
+
+	for (const auto& socket : this->_sockets) {
+		socket->pause();
+
+		// the socket would otherwise linger on through the duplicated descriptor
+		socket->on(node::tcp::socket::destroy_event, [this]() {
+			const auto err = std::make_error_code(std::errc::operation_canceled);
+			this->_finish(&err);
+		});
+	}
+
+	this->_splice = std::move(state);
+	this->_is_spliced = true;
+	this->_pump();
+	return true;
+}
+
+/*
+ * Moves as much data as possible in both directions
+ * and then waits until the sockets become readable/writable again.
+ * A pipe is only refilled once it has been drained completely, since
+ * a partially filled one can't tell whether it has room for another read.
+ */
+void forwarder::_pump() {
+	auto& state = *this->_splice;
+
+	for (std::size_t i = 0; i < 2; i++) {
+		auto& pipe = state.pipes[i];
+		const int in = state.sides[i].fd;
+		const int out = state.sides[i ^ 1].fd;
+
+		// the number of rounds is limited, to not starve other connections
+		for (unsigned int round = 0; round < 16; round++) {
+			bool progress = false;
+
+			if (!pipe.has_ended && pipe.pending == 0) {
+				const ssize_t n = splice(in, nullptr, pipe.fds[1], nullptr, pipe.capacity, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+				if (n > 0) {
+					pipe.pending = std::size_t(n);
+					progress = true;
+				} else if (n == 0) {
+					pipe.has_ended = true;
+				} else if (errno != EAGAIN && errno != EINTR) {
+					const auto err = node::uv::to_error(-errno);
+					this->_finish(&err);
+					return;
+				}
+			}
+
+			if (pipe.pending != 0) {
+				const ssize_t n = splice(pipe.fds[0], nullptr, out, nullptr, pipe.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+				if (n > 0) {
+					pipe.pending -= std::size_t(n);
+					this->_bytes[i] += uint64_t(n);
+					progress = true;
+				} else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+					const auto err = node::uv::to_error(-errno);
+					this->_finish(&err);
+					return;
+				}
+			}
+
+			if (!progress) {
+				break;
+			}
+		}
+
+		if (pipe.has_ended && pipe.pending == 0 && !pipe.is_shut_down) {
+			pipe.is_shut_down = true;
+			shutdown(out, SHUT_WR);
+		}
+	}
+
+	if (state.pipes[0].is_shut_down && state.pipes[1].is_shut_down) {
+		this->_finish(nullptr);
+		return;
+	}
+
+	for (std::size_t i = 0; i < 2; i++) {
+		auto& side = state.sides[i];
+		int events = 0;
+
+		if (!state.pipes[i].has_ended && state.pipes[i].pending == 0) {
+			events |= UV_READABLE;
+		}
+
+		if (state.pipes[i ^ 1].pending != 0) {
+			events |= UV_WRITABLE;
+		}
+
+		if (events == side.events) {
+			continue;
+		}
+
+		side.events = events;
+
+		if (events == 0) {
+			uv_poll_stop(side.poll);
+			continue;
+		}
+
+		const int r = uv_poll_start(side.poll, events, [](uv_poll_t* handle, int status, int) {
+			auto self = static_cast<forwarder*>(handle->data);
+
+			if (status < 0) {
+				const auto err = node::uv::to_error(status);
+				self->_finish(&err);
+			} else {
+				self->_pump();
+			}
+		});
+
+		if (r != 0) {
+			const auto err = node::uv::to_error(r);
+			this->_finish(&err);
+			return;
+		}
+	}
+}
+
+#else
+
+bool forwarder::_start_splice() {
+	return false;
+}
+
+void forwarder::_pump() {
+}
+
+#endif
+
+void forwarder::_start_buffered() {
+	for (std::size_t i = 0; i < 2; i++) {
+		node::tcp::socket* from = this->_sockets[i].get();
+		node::tcp::socket* to = this->_sockets[i ^ 1].get();
+
+		from->on(node::tcp::socket::data_event, [this, i, from, to](const node::buffer& chunk) {
+			// the data is discarded until the other side has ended as well
+			if (this->_is_destroyed[i ^ 1]) {
+				return;
+			}
+
+			this->_bytes[i] += chunk.size();
+			to->write(chunk);
+
+			if (to->is_flooded()) {
+				from->pause();
+			}
+		});
+
+		to->on(node::tcp::socket::drain_event, [from]() {
+			from->resume();
+		});
+
+		from->on(node::tcp::socket::end_event, [this, i, to]() {
+			if (!this->_is_destroyed[i ^ 1]) {
+				to->end();
+			}
+		});
+
+		from->on(node::tcp::socket::error_event, [this](const std::error_code& err) {
+			if (!this->_error) {
+				this->_error = err;
+			}
+		});
+
+		from->on(node::tcp::socket::destroy_event, [this, i, to]() {
+			this->_is_destroyed[i] = true;
+
+			// the other side might have been paused by a flooded write into this one
+			if (!this->_is_destroyed[i ^ 1]) {
+				to->end();
+				to->resume();
+			}
+
+			if (++this->_destroyed_sockets == 2) {
+				this->_finish(this->_error ? &this->_error : nullptr);
+			}
+		});
+	}
+
+	for (const auto& socket : this->_sockets) {
+		socket->set_allow_half_open(true);
+		socket->resume();
+	}
+}
+
+void forwarder::_finish(const std::error_code* err) {
+	if (this->_is_finished) {
+		return;
+	}
+
+	this->_is_finished = true;
+	this->_splice.reset();
+
+	// this removes all listeners added by start()
+	for (const auto& socket : this->_sockets) {
+		socket->destroy();
+	}
+
+	// see uv::handle<>
+	decltype(this->close_callback) close_callback;
+	close_callback.swap(this->close_callback);
+	close_callback.emit(err);
+
+	this->release();
+}
+
+} // namespace tcp
+} // namespace node
@@ -1,5 +1,7 @@
 #include "libnodecc/tcp/server.h"
 
+#include <memory>
+
 
 namespace node {
 namespace tcp {
@@ -7,7 +9,7 @@ namespace tcp {
 decltype(server::connection_event) server::connection_event;
 
 
-server::server(node::loop& loop) : uv::handle<uv_tcp_t>() {
+server::server(node::loop& loop) : uv::handle<uv_tcp_t>(), _max_connections(0), _connections(0), _rejected_connections(0), _max_connections_per_address(0), _is_accepting(true), _is_suspended(false), _has_pending_connection(false) {
 	node::uv::check(uv_tcp_init(loop, *this));
 }
 
@@ -17,7 +19,8 @@ void server::listen(const sockaddr& addr, int backlog, node::tcp::flags flags) {
 	node::uv::check(uv_listen(reinterpret_cast<uv_stream_t*>(&this->_handle), backlog, [](uv_stream_t* server, int status) {
 		if (status == 0) {
 			auto self = reinterpret_cast<node::tcp::server*>(server->data);
-			self->emit(connection_event);
+			self->_has_pending_connection = true;
+			self->_emit_pending_connection();
 		}
 	}));
 }
@@ -34,14 +37,109 @@ void server::listen6(uint16_t port, const node::string& ip, int backlog, node::t
 	this->listen(reinterpret_cast<const sockaddr&>(addr), backlog, flags);
 }
 
-void server::accept(socket& client) {
+bool server::accept(socket& client) {
 	node::uv::check(uv_accept(reinterpret_cast<uv_stream_t*>(&this->_handle), static_cast<uv_stream_t*>(client)));
+
+	std::shared_ptr<sockaddr_storage> addr;
+
+	if (this->_max_connections_per_address) {
+		addr = std::make_shared<sockaddr_storage>();
+		int len = sizeof(sockaddr_storage);
+
+		if (uv_tcp_getpeername(client, reinterpret_cast<sockaddr*>(addr.get()), &len) != 0) {
+			addr.reset();
+		} else if (this->_addresses.increment(reinterpret_cast<const sockaddr&>(*addr)) > this->_max_connections_per_address) {
+			this->_addresses.decrement(reinterpret_cast<const sockaddr&>(*addr));
+			this->_rejected_connections++;
+			client.destroy();
+			return false;
+		}
+	}
+
+	// released by the destroy_event listener below
+	this->retain();
+	this->_connections++;
+
+	client.on(destroy_event, [this, addr]() {
+		this->_on_connection_closed(addr.get());
+		this->release();
+	});
+
+	return true;
+}
+
+void server::pause_accepting() {
+	this->_is_accepting = false;
+}
+
+void server::resume_accepting() {
+	this->_is_accepting = true;
+	this->_emit_pending_connection();
+}
+
+bool server::is_accepting() const noexcept {
+	return this->_is_accepting && !this->_is_suspended && (this->_max_connections == 0 || this->_connections < this->_max_connections);
+}
+
+void server::_set_suspended(bool suspended) {
+	this->_is_suspended = suspended;
+
+	if (!suspended) {
+		this->_emit_pending_connection();
+	}
+}
+
+void server::set_max_connections(std::size_t max) {
+	this->_max_connections = max;
+	this->_emit_pending_connection();
+}
+
+std::size_t server::max_connections() const noexcept {
+	return this->_max_connections;
+}
+
+void server::set_max_connections_per_address(uint32_t max) {
+	this->_max_connections_per_address = max;
+}
+
+uint32_t server::max_connections_per_address() const noexcept {
+	return this->_max_connections_per_address;
+}
+
+std::size_t server::connections() const noexcept {
+	return this->_connections;
+}
+
+uint64_t server::rejected_connections() const noexcept {
+	return this->_rejected_connections;
 }
 
 void server::address(sockaddr& addr, int& len) {
 	node::uv::check(uv_tcp_getsockname(*this, &addr, &len));
 }
 
+/*
+ * If a connection isn't accepted from within connection_event,
+ * libuv stops polling the listening socket until it is.
+ * This is used to leave new connections in the backlog while paused.
+ */
+void server::_emit_pending_connection() {
+	if (this->_has_pending_connection && this->is_accepting() && !this->is_closing()) {
+		this->_has_pending_connection = false;
+		this->emit(connection_event);
+	}
+}
+
+void server::_on_connection_closed(const sockaddr_storage* addr) {
+	this->_connections--;
+
+	if (addr) {
+		this->_addresses.decrement(reinterpret_cast<const sockaddr&>(*addr));
+	}
+
+	this->_emit_pending_connection();
+}
+
 uint16_t server::port() {
 	static_assert(offsetof(sockaddr_in, sin_port) == offsetof(sockaddr_in6, sin6_port), "sockaddr_in and sockaddr_in6 struct layouts must be the same");
 
@@ -1,5 +1,7 @@
 #include "libnodecc/tcp/socket.h"
 
+#include <algorithm>
+
 #include "libnodecc/dns/lookup.h"
 
 
@@ -10,10 +12,57 @@ decltype(socket::connect_event) socket::connect_event;
 
 
 struct connect_pack {
-	explicit connect_pack(node::loop& loop, socket::dns_connect_t&& cb) : loop(loop), cb(cb) {
+	explicit connect_pack(node::loop& loop, socket::dns_connect_t&& cb, const connect_timeouts& timeouts) : loop(loop), cb(cb), timeouts(timeouts), start(uv_now(loop)), timeout_id(0), has_timed_out(false) {
 		this->req.data = this;
 	};
 
+	~connect_pack() {
+		if (this->timeout_id) {
+			this->loop.clear_timeout(this->timeout_id);
+		}
+	}
+
+	/*
+	 * Limits the current phase to the given timeout and the total timeout,
+	 * using a single loop timeout for whichever expires first.
+	 */
+	void set_timeout(uint64_t timeout) {
+		const uint64_t now = uv_now(this->loop);
+		uint64_t due = timeout ? now + timeout : 0;
+
+		if (this->timeouts.total) {
+			const uint64_t total_due = this->start + this->timeouts.total;
+			due = due ? std::min(due, total_due) : total_due;
+		}
+
+		if (this->timeout_id) {
+			this->loop.clear_timeout(this->timeout_id);
+			this->timeout_id = 0;
+		}
+
+		if (due) {
+			this->timeout_id = this->loop.set_timeout(due > now ? due - now : 0, [this]() {
+				this->timeout_id = 0;
+				this->expire();
+			});
+		}
+	}
+
+	void expire() {
+		this->has_timed_out = true;
+
+		const auto err = std::make_error_code(std::errc::timed_out);
+		this->cb(&err, nullptr);
+
+		/*
+		 * Closing the socket cancels the connect request, whose callback deletes this instance.
+		 * A pending lookup can't be aborted and is only discarded once it completed.
+		 */
+		if (this->socket) {
+			this->socket->destroy();
+		}
+	}
+
 	void set_ai(const std::shared_ptr<addrinfo>& ai) {
 		this->ai = ai;
 		this->current_ai = this->ai.get();
@@ -42,6 +91,11 @@ struct connect_pack {
 
 			self->socket->release();
 
+			if (self->has_timed_out) {
+				delete self;
+				return;
+			}
+
 			if (status == 0) {
 				// connect successful ---> call callback with socket
 				self->cb(nullptr, self->socket);
@@ -78,6 +132,10 @@ struct connect_pack {
 
 	node::loop& loop;
 	socket::dns_connect_t cb;
+	connect_timeouts timeouts;
+	uint64_t start;
+	uint64_t timeout_id;
+	bool has_timed_out;
 	std::shared_ptr<addrinfo> ai;
 	addrinfo* current_ai;
 	node::shared_ptr<socket> socket;
@@ -85,21 +143,38 @@ struct connect_pack {
 };
 
 
+struct connect_req {
+	uv_connect_t req;
+	uint64_t timeout_id;
+	bool has_timed_out;
+};
+
+
 socket::socket(node::loop& loop) : uv::stream<uv_tcp_t>() {
 	uv_tcp_init(loop, *this);
 }
 
-void socket::connect(const sockaddr& addr) {
-	auto req = std::unique_ptr<uv_connect_t>(new uv_connect_t);
-	req->data = this;
+void socket::connect(const sockaddr& addr, uint64_t timeout) {
+	auto req = std::unique_ptr<connect_req>(new connect_req);
+	req->req.data = this;
+	req->timeout_id = 0;
+	req->has_timed_out = false;
 
-	node::uv::check(uv_tcp_connect(req.get(), *this, &addr, [](uv_connect_t* req, int status) {
-		auto self = reinterpret_cast<tcp::socket*>(req->data);
+	node::uv::check(uv_tcp_connect(&req->req, *this, &addr, [](uv_connect_t* uv_req, int status) {
+		auto req = reinterpret_cast<connect_req*>(uv_req);
+		auto self = reinterpret_cast<tcp::socket*>(uv_req->data);
+		const bool has_timed_out = req->has_timed_out;
+
+		if (req->timeout_id) {
+			self->loop().clear_timeout(req->timeout_id);
+		}
 
 		delete req;
 
 
-		if (status == 0) {
+		if (has_timed_out) {
+			// the error has been emitted already
+		} else if (status == 0) {
 			self->emit(connect_event);
 		} else {
 			self->emit(error_event, node::uv::to_error(status));
@@ -109,6 +184,18 @@ void socket::connect(const sockaddr& addr) {
 		self->release();
 	}));
 
+	if (timeout) {
+		connect_req* raw = req.get();
+
+		// destroying the socket cancels the connect request
+		req->timeout_id = this->loop().set_timeout(timeout, [this, raw]() {
+			raw->timeout_id = 0;
+			raw->has_timed_out = true;
+			this->emit(error_event, std::make_error_code(std::errc::timed_out));
+			this->destroy();
+		});
+	}
+
 	this->retain();
 	req.release();
 }
@@ -120,22 +207,28 @@ void socket::connect(const sockaddr& addr) {
  *
  * That's why this method must be a factory method.
  */
-void socket::connect(node::loop& loop, const node::string& address, uint16_t port, dns_connect_t cb) {
-	auto pack = std::unique_ptr<connect_pack>(new connect_pack(loop, std::move(cb)));
+void socket::connect(node::loop& loop, const node::string& address, uint16_t port, dns_connect_t cb, const connect_timeouts& timeouts) {
+	auto pack = std::unique_ptr<connect_pack>(new connect_pack(loop, std::move(cb), timeouts));
 	auto pack_ptr = pack.get();
 
 	dns::lookup([pack_ptr](std::error_code* err, const std::shared_ptr<addrinfo>& info) {
 		auto pack = std::unique_ptr<connect_pack>(pack_ptr);
 
+		if (pack->has_timed_out) {
+			return;
+		}
+
 		if (err) {
 			pack->cb(err, nullptr);
 		} else {
 			pack->set_ai(info);
+			pack->set_timeout(pack->timeouts.connect);
 			pack->connect();
 			pack.release();
 		}
 	}, loop, address, port);
 
+	pack->set_timeout(timeouts.lookup);
 	pack.release();
 }
 
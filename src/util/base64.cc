@@ -126,7 +126,8 @@ node::buffer base64::encode(const node::buffer_view& buffer, bool base64url) {
 				}
 			}
 
-			const uint8_t* end_aligned = base + len - 11;
+			// at least 12 bytes must be left for each iteration
+			const uint8_t* end_aligned = end - 11;
 
 			while (base < end_aligned) {
 				/*
@@ -27,7 +27,7 @@ uint32_t crc32c::push(uint32_t crc, node::buffer_view& buffer) {
 	const uint8_t* dataend = data + buffer.size();
 
 	if (!data || data == dataend) {
-		return 0xffffffff;
+		return crc;
 	}
 
 	const uint8_t* div8start = (const uint8_t*)((uintptr_t(data) + 7) & ~7);
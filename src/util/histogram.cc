@@ -0,0 +1,200 @@
+#include "libnodecc/util/histogram.h"
+
+#include <cmath>
+
+#include "libnodecc/util/math.h"
+
+
+namespace {
+
+/*
+ * There is only a single writer and thus a relaxed load & store
+ * is sufficient and cheaper than an atomic read-modify-write.
+ */
+inline void add(std::atomic<uint64_t>& counter, uint64_t value) noexcept {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline uint64_t load(const std::atomic<uint64_t>& counter) noexcept {
+	return counter.load(std::memory_order_relaxed);
+}
+
+inline void store(std::atomic<uint64_t>& counter, uint64_t value) noexcept {
+	counter.store(value, std::memory_order_relaxed);
+}
+
+inline unsigned int digits2(uint64_t value) noexcept {
+	// split the value to avoid depending on 64 bit intrinsics on 32 bit platforms
+	const uint32_t high = uint32_t(value >> 32);
+	return high ? 32 + node::util::digits2(static_cast<unsigned int>(high)) : node::util::digits2(static_cast<unsigned int>(value));
+}
+
+} // namespace
+
+
+namespace node {
+namespace util {
+
+const std::size_t histogram::sub_bucket_bits;
+const std::size_t histogram::sub_bucket_count;
+const std::size_t histogram::sub_bucket_half_count;
+const std::size_t histogram::bucket_count;
+
+histogram::histogram() noexcept {
+	this->reset();
+}
+
+histogram::histogram(const histogram& other) noexcept {
+	this->reset();
+	this->merge(other);
+}
+
+histogram& histogram::operator=(const histogram& other) noexcept {
+	if (this != &other) {
+		this->reset();
+		this->merge(other);
+	}
+
+	return *this;
+}
+
+void histogram::record(uint64_t value) noexcept {
+	add(this->_counts[bucket_index(value)], 1);
+	add(this->_count, 1);
+	add(this->_sum, value);
+
+	if (value < load(this->_min)) {
+		store(this->_min, value);
+	}
+
+	if (value > load(this->_max)) {
+		store(this->_max, value);
+	}
+}
+
+void histogram::merge(const histogram& other) noexcept {
+	for (std::size_t i = 0; i < bucket_count; i++) {
+		const uint64_t count = load(other._counts[i]);
+
+		if (count) {
+			add(this->_counts[i], count);
+		}
+	}
+
+	add(this->_count, load(other._count));
+	add(this->_sum, load(other._sum));
+
+	const uint64_t min = load(other._min);
+	const uint64_t max = load(other._max);
+
+	if (min < load(this->_min)) {
+		store(this->_min, min);
+	}
+
+	if (max > load(this->_max)) {
+		store(this->_max, max);
+	}
+}
+
+void histogram::reset() noexcept {
+	for (auto& count : this->_counts) {
+		store(count, 0);
+	}
+
+	store(this->_count, 0);
+	store(this->_sum, 0);
+	store(this->_min, UINT64_MAX);
+	store(this->_max, 0);
+}
+
+uint64_t histogram::count() const noexcept {
+	return load(this->_count);
+}
+
+uint64_t histogram::sum() const noexcept {
+	return load(this->_sum);
+}
+
+uint64_t histogram::min() const noexcept {
+	return this->count() ? load(this->_min) : 0;
+}
+
+uint64_t histogram::max() const noexcept {
+	return load(this->_max);
+}
+
+double histogram::mean() const noexcept {
+	const uint64_t count = this->count();
+	return count ? double(this->sum()) / double(count) : 0.0;
+}
+
+uint64_t histogram::value_at_quantile(double quantile) const noexcept {
+	const uint64_t count = this->count();
+
+	if (count == 0) {
+		return 0;
+	}
+
+	quantile = quantile < 0.0 ? 0.0 : quantile > 1.0 ? 1.0 : quantile;
+
+	const uint64_t max = this->max();
+	uint64_t target = uint64_t(std::ceil(quantile * double(count)));
+	uint64_t total = 0;
+
+	if (target == 0) {
+		target = 1;
+	}
+
+	for (std::size_t i = 0; i < bucket_count; i++) {
+		total += load(this->_counts[i]);
+
+		if (total >= target) {
+			const uint64_t value = bucket_highest_value(i);
+			return value < max ? value : max;
+		}
+	}
+
+	return max;
+}
+
+std::size_t histogram::bucket_index(uint64_t value) noexcept {
+	if (value < sub_bucket_count) {
+		return std::size_t(value);
+	}
+
+	// value >= sub_bucket_count --> the mantissa is in [sub_bucket_half_count, sub_bucket_count)
+	const unsigned int shift = digits2(value) - sub_bucket_bits;
+	const std::size_t mantissa = std::size_t(value >> shift);
+
+	return sub_bucket_count + (shift - 1) * sub_bucket_half_count + (mantissa - sub_bucket_half_count);
+}
+
+uint64_t histogram::bucket_lowest_value(std::size_t index) noexcept {
+	if (index < sub_bucket_count) {
+		return index;
+	}
+
+	index -= sub_bucket_count;
+
+	const std::size_t shift = index / sub_bucket_half_count + 1;
+	const uint64_t mantissa = sub_bucket_half_count + index % sub_bucket_half_count;
+
+	return mantissa << shift;
+}
+
+uint64_t histogram::bucket_highest_value(std::size_t index) noexcept {
+	if (index < sub_bucket_count) {
+		return index;
+	}
+
+	index -= sub_bucket_count;
+
+	const std::size_t shift = index / sub_bucket_half_count + 1;
+	const uint64_t mantissa = sub_bucket_half_count + index % sub_bucket_half_count;
+
+	// this wraps around to UINT64_MAX for the very last bucket
+	return ((mantissa + 1) << shift) - 1;
+}
+
+} // namespace util
+} // namespace node
@@ -0,0 +1,50 @@
+#include "libnodecc/util/lag_monitor.h"
+
+#include <algorithm>
+
+
+namespace node {
+namespace util {
+
+decltype(lag_monitor::lag_event) lag_monitor::lag_event;
+
+
+lag_monitor::lag_monitor(node::loop& loop) : uv::handle<uv_timer_t>(), _interval(0), _last_sample(0), _lag(0) {
+	node::uv::check(uv_timer_init(loop, *this));
+	this->unref();
+}
+
+void lag_monitor::start(uint64_t interval) {
+	this->_interval = interval * 1000000;
+	this->_last_sample = uv_hrtime();
+	this->_lag = 0;
+
+	node::uv::check(uv_timer_start(*this, [](uv_timer_t* timer) {
+		auto self = reinterpret_cast<node::util::lag_monitor*>(timer->data);
+
+		const uint64_t now = uv_hrtime();
+		const uint64_t expected = self->_last_sample + self->_interval;
+		const uint64_t sample = now > expected ? (now - expected) / 1000 : 0;
+
+		// a weight of 1/4 smoothes single outliers, while reacting within a few samples
+		self->_last_sample = now;
+		self->_lag = (self->_lag * 3 + sample) / 4;
+
+		self->emit(lag_event, self->_lag);
+	}, interval, interval));
+}
+
+void lag_monitor::stop() {
+	node::uv::check(uv_timer_stop(*this));
+}
+
+uint64_t lag_monitor::lag() const noexcept {
+	// the loop time is updated with millisecond precision whenever polling for I/O returns
+	const uint64_t now = uv_hrtime() / 1000;
+	const uint64_t start = uv_now(*this) * 1000;
+
+	return std::max(this->_lag, now > start ? now - start : 0);
+}
+
+} // namespace util
+} // namespace node
@@ -143,10 +143,10 @@ void sha1::get_digest(digest_t digest) {
 
 	for (size_t i = 0; i < 5; i++) {
 		const uint32_t h = this->_h[i];
-		digest[i * 4 + 0] = (h >> 12) & 0xff000000;
-		digest[i * 4 + 1] = (h >>  8) & 0x00ff0000;
-		digest[i * 4 + 2] = (h >>  4) & 0x0000ff00;
-		digest[i * 4 + 3] = (h >>  0) & 0x000000ff;
+		digest[i * 4 + 0] = static_cast<uint8_t>((h >> 24) & 0xff);
+		digest[i * 4 + 1] = static_cast<uint8_t>((h >> 16) & 0xff);
+		digest[i * 4 + 2] = static_cast<uint8_t>((h >>  8) & 0xff);
+		digest[i * 4 + 3] = static_cast<uint8_t>((h >>  0) & 0xff);
 	}
 }
 
@@ -29,12 +29,12 @@ namespace util {
 node::buffer uri::component_decode(const node::buffer_view& buffer, bool urlencoded) noexcept {
 	try {
 		// TODO: UTF-8 support
-		// TODO: use result.set_capacity() to minimize allocations
-		node::mutable_buffer result;
-
 		const uint8_t* base = buffer.data();
 		const size_t size = buffer.size();
 
+		// the decoded string is never longer than the encoded one
+		node::mutable_buffer result(size);
+
 		for (size_t i = 0; i < size; i++) {
 			uint8_t c = base[i];
 
@@ -43,8 +43,8 @@ node::buffer uri::component_decode(const node::buffer_view& buffer, bool urlenco
 			} else if (urlencoded && c == '+') {
 				c = ' ';
 			} else if (c == '%' && (size - i) > 2) {
-				const uint8_t lo = hex_to_int(base[i + 1]);
-				const uint8_t hi = hex_to_int(base[i + 2]);
+				const uint8_t hi = hex_to_int(base[i + 1]);
+				const uint8_t lo = hex_to_int(base[i + 2]);
 
 				c = (hi << 4) + lo;
 				i += 2;
@@ -0,0 +1,261 @@
+#include "libnodecc/websocket/broadcaster.h"
+
+#include <stdexcept>
+
+
+namespace node {
+namespace websocket {
+
+broadcaster::broadcaster(flood_policy policy, std::size_t max_queued) : _broadcasts(0), _delivered(0), _dropped(0), _disconnected(0), _max_queued(max_queued), _policy(policy), _is_broadcasting(false), _has_removed(false) {
+}
+
+bool broadcaster::subscribe(const node::shared_ptr<node::tcp::socket>& socket) {
+	node::tcp::socket* raw = socket.get();
+
+	if (!this->_index.emplace(raw, this->_subscribers.size()).second) {
+		return false;
+	}
+
+	this->_subscribers.emplace_back();
+
+	subscriber& sub = this->_subscribers.back();
+	sub.socket = socket;
+
+	// only raw pointers may be captured here - shared ones would form a cycle
+	sub.destroy_iter = socket->on(node::tcp::socket::destroy_event, [this, raw]() {
+		this->_remove(raw, true);
+	});
+
+	sub.drain_iter = nullptr;
+
+	if (this->_policy == flood_policy::queue) {
+		sub.drain_iter = socket->on(node::tcp::socket::drain_event, [this, raw]() {
+			this->_on_drain(raw);
+		});
+	}
+
+	return true;
+}
+
+bool broadcaster::unsubscribe(const node::shared_ptr<node::tcp::socket>& socket) {
+	if (!this->is_subscribed(socket)) {
+		return false;
+	}
+
+	this->_remove(socket.get(), false);
+	return true;
+}
+
+bool broadcaster::is_subscribed(const node::shared_ptr<node::tcp::socket>& socket) const {
+	return this->_index.find(socket.get()) != this->_index.end();
+}
+
+std::size_t broadcaster::size() const noexcept {
+	return this->_index.size();
+}
+
+std::size_t broadcaster::broadcast(opcode op, const node::buffer_view& payload) {
+	return this->broadcast(encode(op, payload));
+}
+
+std::size_t broadcaster::broadcast(const node::buffer& frame) {
+	const uint64_t start = uv_hrtime();
+	std::size_t delivered = 0;
+
+	/*
+	 * Writes might destroy sockets and thus unsubscribe them synchronously.
+	 * Subscribers are only marked as removed until the loop has finished,
+	 * while new ones are appended and thus only receive the next broadcast.
+	 */
+	this->_is_broadcasting = true;
+
+	for (std::size_t i = 0, n = this->_subscribers.size(); i < n; i++) {
+		if (this->_subscribers[i].socket && this->_send(this->_subscribers[i], frame)) {
+			delivered++;
+		}
+	}
+
+	this->_is_broadcasting = false;
+
+	if (this->_has_removed) {
+		this->_compact();
+	}
+
+	this->_broadcasts++;
+	this->_delivered += delivered;
+	this->_duration.record((uv_hrtime() - start) / 1000);
+
+	return delivered;
+}
+
+uint64_t broadcaster::broadcasts() const noexcept {
+	return this->_broadcasts;
+}
+
+uint64_t broadcaster::delivered() const noexcept {
+	return this->_delivered;
+}
+
+uint64_t broadcaster::dropped() const noexcept {
+	return this->_dropped;
+}
+
+uint64_t broadcaster::disconnected() const noexcept {
+	return this->_disconnected;
+}
+
+const node::util::histogram& broadcaster::duration() const noexcept {
+	return this->_duration;
+}
+
+void broadcaster::_destroy() {
+	for (const auto& sub : this->_subscribers) {
+		if (sub.socket) {
+			sub.socket->off(node::tcp::socket::destroy_event, sub.destroy_iter);
+			sub.socket->off(node::tcp::socket::drain_event, sub.drain_iter);
+		}
+	}
+
+	this->_subscribers.clear();
+	this->_index.clear();
+
+	node::object::_destroy();
+}
+
+bool broadcaster::_send(subscriber& sub, const node::buffer& frame) {
+	// queued frames must be sent first to preserve the order of messages
+	if (sub.socket->is_flooded() || !sub.queue.empty()) {
+		switch (this->_policy) {
+		case flood_policy::drop:
+			this->_dropped++;
+			return false;
+		case flood_policy::queue:
+			if (sub.queue.size() < this->_max_queued) {
+				sub.queue.emplace_back(frame);
+				return true;
+			}
+			break;
+		case flood_policy::disconnect:
+			break;
+		}
+
+		this->_dropped++;
+		this->_disconnected++;
+		sub.socket->destroy();
+		return false;
+	}
+
+	try {
+		sub.socket->write(frame);
+	} catch (const std::logic_error&) {
+		// the socket has been ended, but isn't destroyed yet
+		this->_dropped++;
+		this->_remove(sub.socket.get(), false);
+		return false;
+	}
+
+	return true;
+}
+
+void broadcaster::_on_drain(node::tcp::socket* socket) {
+	const auto it = this->_index.find(socket);
+
+	if (it == this->_index.end()) {
+		return;
+	}
+
+	/*
+	 * Writes might destroy the socket and thus remove the subscriber synchronously,
+	 * which invalidates any reference into _subscribers (see _remove()).
+	 * The queue is therefore taken out and the subscriber is looked up again after every write.
+	 */
+	const node::shared_ptr<node::tcp::socket> ref = this->_subscribers[it->second].socket;
+	std::vector<node::buffer> queue;
+	queue.swap(this->_subscribers[it->second].queue);
+	std::size_t i = 0;
+
+	try {
+		while (i < queue.size() && this->_index.find(socket) != this->_index.end() && !socket->is_flooded()) {
+			socket->write(queue[i]);
+			i++;
+		}
+	} catch (const std::logic_error&) {
+		// the socket has been ended, but isn't destroyed yet
+		this->_dropped += queue.size() - i;
+		this->_remove(socket, false);
+		return;
+	}
+
+	const auto current = this->_index.find(socket);
+
+	if (current == this->_index.end()) {
+		return;
+	}
+
+	// frames queued in the meantime are sent after the remaining ones
+	subscriber& sub = this->_subscribers[current->second];
+	queue.erase(queue.begin(), queue.begin() + i);
+	queue.insert(queue.end(), std::make_move_iterator(sub.queue.begin()), std::make_move_iterator(sub.queue.end()));
+	sub.queue.swap(queue);
+}
+
+void broadcaster::_remove(node::tcp::socket* socket, bool is_destroyed) {
+	const auto it = this->_index.find(socket);
+
+	if (it == this->_index.end()) {
+		return;
+	}
+
+	const std::size_t i = it->second;
+	this->_index.erase(it);
+
+	subscriber& sub = this->_subscribers[i];
+
+	// the destroy_event listener is currently being emitted and removed by the destruction anyways
+	if (!is_destroyed) {
+		sub.socket->off(node::tcp::socket::destroy_event, sub.destroy_iter);
+		sub.socket->off(node::tcp::socket::drain_event, sub.drain_iter);
+	}
+
+	sub.socket.reset();
+	sub.queue.clear();
+
+	if (this->_is_broadcasting) {
+		this->_has_removed = true;
+		return;
+	}
+
+	// swap with the last subscriber, to remove it in constant time
+	if (i != this->_subscribers.size() - 1) {
+		sub = std::move(this->_subscribers.back());
+		this->_index[sub.socket.get()] = i;
+	}
+
+	this->_subscribers.pop_back();
+}
+
+/*
+ * Removes the subscribers marked as removed during a broadcast.
+ */
+void broadcaster::_compact() {
+	std::size_t n = 0;
+
+	for (std::size_t i = 0; i < this->_subscribers.size(); i++) {
+		if (!this->_subscribers[i].socket) {
+			continue;
+		}
+
+		if (i != n) {
+			this->_subscribers[n] = std::move(this->_subscribers[i]);
+			this->_index[this->_subscribers[n].socket.get()] = n;
+		}
+
+		n++;
+	}
+
+	this->_subscribers.resize(n);
+	this->_has_removed = false;
+}
+
+} // namespace websocket
+} // namespace node
@@ -0,0 +1,566 @@
+#include "libnodecc/websocket/client.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "libnodecc/error.h"
+#include "libnodecc/util/base64.h"
+#include "libnodecc/util/sha1.h"
+
+
+namespace {
+
+const node::buffer_view websocket_magic("258EAFA5-E914-47DA-95CA-C5AB0DC85B11", 36);
+
+bool iequals(const node::buffer_view& view, const char* str, std::size_t len) {
+	if (view.size() != len) {
+		return false;
+	}
+
+	for (std::size_t i = 0; i < len; i++) {
+		uint8_t ch = view[i];
+
+		if (ch >= 'A' && ch <= 'Z') {
+			ch += 0x20;
+		}
+
+		if (ch != uint8_t(str[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+} // namespace
+
+
+namespace node {
+namespace websocket {
+
+decltype(client::open_event) client::open_event;
+decltype(client::drain_event) client::drain_event;
+decltype(client::error_event) client::error_event;
+decltype(client::close_event) client::close_event;
+
+
+client::client(node::loop& loop) : _loop(loop), _frame_remaining(0), _header_size(0), _max_message_size(16 * 1024 * 1024), _close_code(1006), _random_offset(sizeof(_random_pool)), _state(state::initial), _message_op(opcode::continuation), _is_text(false), _in_frame(false), _is_paused(false), _close_sent(false), _close_received(false), _has_failed(false) {
+	// messages are emitted as soon as the connection is open
+	this->_is_consuming = true;
+}
+
+void client::set_header(const node::buffer& key, const node::buffer& value) {
+	this->_headers.emplace_back(key, value);
+}
+
+void client::set_max_message_size(std::size_t size) noexcept {
+	this->_max_message_size = size;
+}
+
+void client::connect(const node::buffer& url) {
+	using namespace node::literals;
+
+	if (this->_state != state::initial) {
+		throw std::logic_error("already connected");
+	}
+
+	if (url.size() >= 6 && iequals(url.slice(0, 6), "wss://", 6)) {
+		throw std::invalid_argument("wss is not supported");
+	}
+
+	this->_state = state::connecting;
+	this->retain();
+
+	try {
+		node::http::request(this->_loop, "GET"_view, url, [this](const std::error_code* err, const node::http::client::request& req, const node::http::client::response& res) {
+			this->_on_connect(err, req, res);
+		});
+	} catch (...) {
+		this->_state = state::initial;
+		this->release();
+		throw;
+	}
+}
+
+void client::connect(const sockaddr& addr, const node::buffer& host, const node::buffer& path) {
+	using namespace node::literals;
+
+	if (this->_state != state::initial) {
+		throw std::logic_error("already connected");
+	}
+
+	this->_state = state::connecting;
+	this->retain();
+
+	try {
+		node::http::request(this->_loop, addr, host, "GET"_view, path, [this](const std::error_code* err, const node::http::client::request& req, const node::http::client::response& res) {
+			this->_on_connect(err, req, res);
+		});
+	} catch (...) {
+		this->_state = state::initial;
+		this->release();
+		throw;
+	}
+}
+
+bool client::is_open() const noexcept {
+	return this->_state == state::open;
+}
+
+bool client::is_text() const noexcept {
+	return this->_is_text;
+}
+
+bool client::is_flooded() const noexcept {
+	return this->_socket && this->_socket->is_flooded();
+}
+
+bool client::send(opcode op, const node::buffer_view& payload) {
+	if (this->_state != state::open) {
+		throw std::logic_error("websocket isn't open");
+	}
+
+	return this->_send_frame(op, payload);
+}
+
+void client::close(uint16_t code, const node::buffer_view& reason) {
+	switch (this->_state) {
+	case state::connecting:
+		// the connection is dropped as soon as the socket is available
+		this->_has_failed = true;
+
+		if (this->_socket) {
+			this->_socket->destroy();
+		}
+
+		break;
+	case state::open: {
+		const std::size_t reason_size = std::min<std::size_t>(reason.size(), 123);
+		uint8_t payload[125];
+
+		payload[0] = uint8_t(code >> 8);
+		payload[1] = uint8_t(code);
+
+		if (reason_size) {
+			memcpy(payload + 2, reason.data(), reason_size);
+		}
+
+		this->_close_sent = true;
+		this->_state = state::closing;
+		this->_send_frame(opcode::close, node::buffer_view(payload, 2 + reason_size));
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void client::_resume() {
+	this->_is_paused = false;
+
+	if (this->_socket && this->_state != state::connecting) {
+		this->_socket->resume();
+
+		if (this->_pending) {
+			// readable::resume() sets this only afterwards, which would prevent listeners from pausing again
+			this->_is_consuming = true;
+
+			node::buffer data;
+			std::swap(data, this->_pending);
+			this->_on_data(data);
+		}
+	}
+}
+
+void client::_pause() {
+	this->_is_paused = true;
+
+	// the handshake is always received completely
+	if (this->_socket && this->_state != state::connecting) {
+		this->_socket->pause();
+	}
+}
+
+void client::_destroy() {
+	this->_has_failed = true;
+
+	if (this->_socket) {
+		this->_socket->destroy();
+	}
+
+	node::object::_destroy();
+}
+
+void client::_on_connect(const std::error_code* err, const node::http::client::request& req, const node::http::client::response& res) {
+	using namespace node::literals;
+
+	if (err) {
+		if (this->_state != state::closed) {
+			this->emit(error_event, *err);
+
+			// without a socket (e.g. if the lookup or connect failed) no destroy_event will follow
+			if (!this->_socket) {
+				this->_on_close();
+			}
+		}
+
+		return;
+	}
+
+	this->_socket = req->socket();
+	this->_socket->on(node::tcp::socket::destroy_event, [this]() {
+		this->_on_close();
+	});
+
+	if (this->_has_failed) {
+		this->_socket->destroy();
+		return;
+	}
+
+	uint8_t key[16];
+	this->_random(key, sizeof(key));
+	this->_key = node::util::base64::encode(node::buffer_view(key, sizeof(key)));
+
+	req->set_header("connection"_view, "upgrade"_view);
+	req->set_header("upgrade"_view, "websocket"_view);
+	req->set_header("sec-websocket-key"_view, this->_key);
+	req->set_header("sec-websocket-version"_view, "13"_view);
+
+	for (const auto& header : this->_headers) {
+		req->set_header(header.first, header.second);
+	}
+
+	// only raw pointers may be captured here - shared ones would form a cycle
+	node::http::incoming_message* msg = res.get();
+
+	res->headers_complete_callback.connect([this, msg](bool upgrade, bool) {
+		if (this->_has_failed || (upgrade && this->_verify(*msg))) {
+			return;
+		}
+
+		this->_has_failed = true;
+		this->emit(error_event, std::make_error_code(std::errc::protocol_error));
+
+		// the response is still being parsed and thus can't be destroyed right away
+		const auto socket = this->_socket;
+		this->_loop.next_tick([socket]() {
+			socket->destroy();
+		});
+	});
+
+	res->upgrade_callback.connect([this](const node::buffer& rest) {
+		if (!this->_has_failed) {
+			this->_on_upgrade(rest);
+		}
+	});
+
+	req->end();
+}
+
+/*
+ * RFC 6455 §4.1: The server must switch to the "websocket" protocol and
+ * prove that it received the handshake by hashing the sec-websocket-key.
+ */
+bool client::_verify(const node::http::incoming_message& res) const {
+	using namespace node::literals;
+
+	if (res.status_code() != 101 || !iequals(res.header("upgrade"_view), "websocket", 9)) {
+		return false;
+	}
+
+	node::mutable_buffer buffer;
+	buffer.set_capacity(this->_key.size() + websocket_magic.size());
+	buffer.append(this->_key.data(), this->_key.size());
+	buffer.append(websocket_magic.data(), websocket_magic.size());
+
+	uint8_t digest[SHA1_DIGEST_LENGTH];
+
+	node::util::sha1 s;
+	s.push(buffer);
+	s.get_digest(digest);
+
+	return res.header("sec-websocket-accept"_view).equals(node::util::base64::encode(node::buffer_view(digest, sizeof(digest))));
+}
+
+void client::_on_upgrade(const node::buffer& rest) {
+	this->_state = state::open;
+
+	this->_socket->on(node::tcp::socket::data_event, [this](const node::buffer& chunk) {
+		this->_on_data(chunk);
+	});
+
+	this->_socket->on(node::tcp::socket::drain_event, [this]() {
+		this->emit(drain_event);
+	});
+
+	if (this->_is_paused) {
+		this->_socket->pause();
+	}
+
+	this->emit(open_event);
+
+	if (rest && this->_socket) {
+		this->_on_data(rest);
+	}
+}
+
+void client::_on_data(node::buffer data) {
+	// a listener might destroy the client while a message is being emitted
+	this->retain();
+
+	while (data && this->_socket && !this->_has_failed && !this->_close_received) {
+		if (this->_is_paused) {
+			this->_pending = data;
+			break;
+		}
+
+		if (!this->_in_frame && !this->_process_frame_header(data)) {
+			break;
+		}
+
+		const std::size_t n = std::size_t(std::min<uint64_t>(this->_frame_remaining, data.size()));
+		const node::buffer chunk = data.slice(0, n);
+
+		data = data.slice(n);
+		this->_frame_remaining -= n;
+
+		if (this->_frame.is_control()) {
+			this->_control.append(chunk.data(), n);
+
+			if (this->_frame_remaining == 0) {
+				this->_in_frame = false;
+				this->_process_control();
+			}
+
+			continue;
+		}
+
+		// unfragmented messages received within a single read are emitted without copying them
+		if (this->_frame_remaining == 0 && this->_frame.fin && this->_message.size() == 0) {
+			this->_in_frame = false;
+			this->_emit_message(chunk);
+			continue;
+		}
+
+		this->_message.append(chunk.data(), n);
+
+		if (this->_frame_remaining == 0) {
+			this->_in_frame = false;
+
+			if (this->_frame.fin) {
+				const node::buffer message(std::move(this->_message));
+
+				// moving doesn't reset the capacity of a mutable_buffer
+				this->_message.reset();
+				this->_emit_message(message);
+			}
+		}
+	}
+
+	this->release();
+}
+
+/*
+ * Parses the header of the next frame from the beginning of the data and removes it from it.
+ *
+ * @return false if the header is incomplete or invalid.
+ */
+bool client::_process_frame_header(node::buffer& data) {
+	std::size_t consumed = 0;
+	int r;
+
+	if (this->_header_size) {
+		const std::size_t n = std::min(max_header_size - this->_header_size, data.size());
+		memcpy(this->_header + this->_header_size, data.data(), n);
+
+		r = this->_frame.parse(this->_header, this->_header_size + n);
+
+		if (r == frame_header::incomplete) {
+			this->_header_size += n;
+			data.reset();
+			return false;
+		}
+
+		if (r >= 0) {
+			consumed = std::size_t(r) - this->_header_size;
+		}
+	} else {
+		r = this->_frame.parse(data.data(), data.size());
+
+		// the data is smaller than max_header_size in this case
+		if (r == frame_header::incomplete) {
+			memcpy(this->_header, data.data(), data.size());
+			this->_header_size = data.size();
+			data.reset();
+			return false;
+		}
+
+		if (r >= 0) {
+			consumed = std::size_t(r);
+		}
+	}
+
+	this->_header_size = 0;
+
+	const frame_header& f = this->_frame;
+
+	// servers must not mask frames and no extension has been negotiated
+	if (r < 0 || f.rsv1 || f.rsv2 || f.rsv3 || f.masked) {
+		this->_fail(1002);
+		return false;
+	}
+
+	if (f.is_control()) {
+		if (!f.fin || f.payload_size > 125 || (f.op != opcode::close && f.op != opcode::ping && f.op != opcode::pong)) {
+			this->_fail(1002);
+			return false;
+		}
+	} else {
+		const bool is_valid = f.op == opcode::continuation
+			? this->_message_op != opcode::continuation
+			: this->_message_op == opcode::continuation && (f.op == opcode::text || f.op == opcode::binary);
+
+		if (!is_valid) {
+			this->_fail(1002);
+			return false;
+		}
+
+		if (f.payload_size > this->_max_message_size - this->_message.size()) {
+			this->_fail(1009);
+			return false;
+		}
+
+		if (f.op != opcode::continuation) {
+			this->_message_op = f.op;
+		}
+
+		// allocate the frame at once if it spans multiple reads
+		if (f.payload_size > data.size() - consumed) {
+			this->_message.set_capacity(this->_message.size() + std::size_t(f.payload_size));
+		}
+	}
+
+	data = data.slice(consumed);
+	this->_frame_remaining = f.payload_size;
+	this->_in_frame = true;
+
+	return true;
+}
+
+void client::_process_control() {
+	const node::buffer payload(std::move(this->_control));
+	this->_control.reset();
+
+	switch (this->_frame.op) {
+	case opcode::ping:
+		if (this->_state == state::open) {
+			this->_send_frame(opcode::pong, payload);
+		}
+
+		break;
+	case opcode::close:
+		if (payload.size() == 1) {
+			this->_fail(1002);
+			return;
+		}
+
+		this->_close_received = true;
+
+		if (payload.size() >= 2) {
+			this->_close_code = uint16_t(payload[0] << 8 | payload[1]);
+			this->_close_reason = payload.slice(2);
+		} else {
+			this->_close_code = 1005;
+		}
+
+		// RFC 6455 §5.5.1: the close frame is echoed, after which the server closes the connection
+		if (!this->_close_sent) {
+			this->_close_sent = true;
+			this->_send_frame(opcode::close, payload.slice(0, 2));
+		}
+
+		this->_state = state::closing;
+		this->_socket->end();
+		break;
+	default:
+		break;
+	}
+}
+
+void client::_emit_message(const node::buffer& message) {
+	this->_is_text = this->_message_op == opcode::text;
+	this->_message_op = opcode::continuation;
+	this->emit(data_event, message);
+}
+
+void client::_fail(uint16_t code) {
+	this->_has_failed = true;
+	this->emit(error_event, std::make_error_code(code == 1009 ? std::errc::message_size : std::errc::protocol_error));
+
+	if (!this->_socket) {
+		return;
+	}
+
+	if (!this->_close_sent) {
+		const uint8_t payload[2] = { uint8_t(code >> 8), uint8_t(code) };
+
+		this->_close_sent = true;
+		this->_send_frame(opcode::close, node::buffer_view(payload, 2));
+	}
+
+	this->_state = state::closing;
+	this->_socket->end();
+}
+
+void client::_on_close() {
+	if (this->_state == state::closed) {
+		return;
+	}
+
+	this->_state = state::closed;
+	this->_socket.reset();
+	this->_pending.reset();
+	this->_message.reset();
+	this->_control.reset();
+
+	this->_set_reading_ended();
+	this->emit(close_event, this->_close_code, this->_close_reason);
+
+	// balances the retain() in connect()
+	this->release();
+}
+
+bool client::_send_frame(opcode op, const node::buffer_view& payload) {
+	const std::size_t size = payload.size();
+	uint8_t mask[4];
+
+	this->_random(mask, sizeof(mask));
+
+	node::buffer frame(header_size(size, true) + size);
+	const std::size_t n = write_header(frame.data(), op, size, true, false, mask);
+
+	if (size) {
+		memcpy(frame.data() + n, payload.data(), size);
+		apply_mask(frame.data() + n, size, mask);
+	}
+
+	return this->_socket->write(frame);
+}
+
+/*
+ * RFC 6455 §5.3: Masking keys must be unpredictable and are thus taken from the
+ * system's CSPRNG, whose output is buffered to avoid a syscall per frame.
+ */
+void client::_random(uint8_t* data, std::size_t size) {
+	if (this->_random_offset + size > sizeof(this->_random_pool)) {
+		node::uv::check(uv_random(nullptr, nullptr, this->_random_pool, sizeof(this->_random_pool), 0, nullptr));
+		this->_random_offset = 0;
+	}
+
+	memcpy(data, this->_random_pool + this->_random_offset, size);
+	this->_random_offset += size;
+}
+
+} // namespace websocket
+} // namespace node
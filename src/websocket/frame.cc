@@ -0,0 +1,167 @@
+#include "libnodecc/websocket/frame.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+
+namespace node {
+namespace websocket {
+
+int frame_header::parse(const uint8_t* data, std::size_t size) noexcept {
+	if (size < 2) {
+		return incomplete;
+	}
+
+	this->fin = (data[0] & 0x80) != 0;
+	this->rsv1 = (data[0] & 0x40) != 0;
+	this->rsv2 = (data[0] & 0x20) != 0;
+	this->rsv3 = (data[0] & 0x10) != 0;
+	this->op = opcode(data[0] & 0x0f);
+	this->masked = (data[1] & 0x80) != 0;
+
+	const uint8_t len = data[1] & 0x7f;
+	std::size_t n = 2;
+
+	if (len < 126) {
+		this->payload_size = len;
+	} else if (len == 126) {
+		if (size < 4) {
+			return incomplete;
+		}
+
+		this->payload_size = uint64_t(data[2]) << 8 | data[3];
+		n = 4;
+	} else {
+		if (size < 10) {
+			return incomplete;
+		}
+
+		// the most significant bit must be 0
+		if (data[2] & 0x80) {
+			return error;
+		}
+
+		this->payload_size = 0;
+
+		for (n = 2; n < 10; n++) {
+			this->payload_size = this->payload_size << 8 | data[n];
+		}
+	}
+
+	if (this->masked) {
+		if (size < n + 4) {
+			return incomplete;
+		}
+
+		memcpy(this->mask, data + n, 4);
+		n += 4;
+	}
+
+	return int(n);
+}
+
+bool frame_header::is_control() const noexcept {
+	return (uint8_t(this->op) & 0x08) != 0;
+}
+
+std::size_t header_size(uint64_t payload_size, bool masked) noexcept {
+	std::size_t size = payload_size < 126 ? 2 : payload_size <= UINT16_MAX ? 4 : 10;
+	return masked ? size + 4 : size;
+}
+
+std::size_t write_header(uint8_t* out, opcode op, uint64_t payload_size, bool fin, bool rsv1, const uint8_t* mask) noexcept {
+	uint8_t* p = out;
+
+	*p++ = uint8_t((fin ? 0x80 : 0) | (rsv1 ? 0x40 : 0) | uint8_t(op));
+
+	const uint8_t mask_bit = mask ? 0x80 : 0;
+
+	// the payload length is encoded in network byte order using the minimal number of bytes
+	if (payload_size < 126) {
+		*p++ = uint8_t(mask_bit | payload_size);
+	} else if (payload_size <= UINT16_MAX) {
+		*p++ = uint8_t(mask_bit | 126);
+		*p++ = uint8_t(payload_size >> 8);
+		*p++ = uint8_t(payload_size);
+	} else {
+		*p++ = uint8_t(mask_bit | 127);
+
+		for (int shift = 56; shift >= 0; shift -= 8) {
+			*p++ = uint8_t(payload_size >> shift);
+		}
+	}
+
+	if (mask) {
+		memcpy(p, mask, 4);
+		p += 4;
+	}
+
+	return std::size_t(p - out);
+}
+
+node::buffer encode(opcode op, const node::buffer_view& payload, bool rsv1) {
+	const std::size_t head = header_size(payload.size());
+	node::buffer frame(head + payload.size());
+
+	write_header(frame.data(), op, payload.size(), true, rsv1);
+
+	if (payload.size()) {
+		memcpy(frame.data() + head, payload.data(), payload.size());
+	}
+
+	return frame;
+}
+
+void apply_mask(uint8_t* data, std::size_t size, const uint8_t mask[4], uint64_t offset) noexcept {
+	// rotate the key, so that it starts at data[0]
+	uint8_t key[4];
+
+	for (std::size_t i = 0; i < 4; i++) {
+		key[i] = mask[(offset + i) & 3];
+	}
+
+	// the key repeats every 4 bytes and thus forms the same pattern in every wider word
+	uint32_t key32;
+	memcpy(&key32, key, 4);
+
+	std::size_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256i key256 = _mm256_set1_epi32(int(key32));
+
+	for (; size - i >= 32; i += 32) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(v, key256));
+	}
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+	const __m128i key128 = _mm_set1_epi32(int(key32));
+
+	for (; size - i >= 16; i += 16) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, key128));
+	}
+#endif
+
+	const uint64_t key64 = uint64_t(key32) | uint64_t(key32) << 32;
+
+	for (; size - i >= 8; i += 8) {
+		uint64_t v;
+		memcpy(&v, data + i, 8);
+		v ^= key64;
+		memcpy(data + i, &v, 8);
+	}
+
+	for (; i < size; i++) {
+		data[i] ^= key[i & 3];
+	}
+}
+
+} // namespace websocket
+} // namespace node
@@ -0,0 +1,478 @@
+#include "libnodecc/websocket/permessage_deflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <zlib.h>
+
+
+namespace {
+
+bool is_whitespace(uint8_t ch) {
+	return ch == ' ' || ch == '\t';
+}
+
+uint8_t to_lower(uint8_t ch) {
+	return ch >= 'A' && ch <= 'Z' ? ch + 0x20 : ch;
+}
+
+node::buffer_view trim(const uint8_t* beg, const uint8_t* end) {
+	while (beg != end && is_whitespace(*beg)) {
+		beg++;
+	}
+
+	while (end != beg && is_whitespace(end[-1])) {
+		end--;
+	}
+
+	// quoted-string values (RFC 7692 §7.1) don't need any escaping for the allowed values
+	if (end - beg >= 2 && *beg == '"' && end[-1] == '"') {
+		beg++;
+		end--;
+	}
+
+	return node::buffer_view(beg, std::size_t(end - beg));
+}
+
+/*
+ * Compares case-insensitively against a lowercase token.
+ */
+bool equals(const node::buffer_view& a, const char* token) {
+	const std::size_t size = strlen(token);
+
+	if (a.size() != size) {
+		return false;
+	}
+
+	for (std::size_t i = 0; i < size; i++) {
+		if (to_lower(a[i]) != uint8_t(token[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Parses a window bits parameter value, which must be a number between 8 and 15.
+ */
+int parse_window_bits(const node::buffer_view& value) {
+	if (value.size() == 1 && value[0] >= '8' && value[0] <= '9') {
+		return value[0] - '0';
+	}
+
+	if (value.size() == 2 && value[0] == '1' && value[1] >= '0' && value[1] <= '5') {
+		return 10 + value[1] - '0';
+	}
+
+	return 0;
+}
+
+// the empty uncompressed block appended by Z_SYNC_FLUSH (RFC 7692 §7.2.1)
+const uint8_t sync_tail[] = { 0x00, 0x00, 0xff, 0xff };
+
+
+z_stream* create_stream(bool inflate, int level, int window_bits, int mem_level) {
+	z_stream* z = new z_stream;
+	memset(z, 0, sizeof(z_stream));
+
+	// negative window bits select the raw deflate format without zlib header
+	const int r = inflate
+		? inflateInit2(z, -window_bits)
+		: deflateInit2(z, level, Z_DEFLATED, -window_bits, mem_level, Z_DEFAULT_STRATEGY);
+
+	if (r != Z_OK) {
+		delete z;
+		return nullptr;
+	}
+
+	return z;
+}
+
+void destroy_stream(z_stream* z, bool inflate) {
+	if (inflate) {
+		inflateEnd(z);
+	} else {
+		deflateEnd(z);
+	}
+
+	delete z;
+}
+
+/*
+ * The parameters of a stream are stored in its opaque field, which is only
+ * passed to custom allocators and thus unused, since zlib's default ones are used.
+ */
+int stream_key(bool inflate, int level, int window_bits, int mem_level) {
+	return (inflate ? 1 : 0) | (level + 1) << 1 | window_bits << 5 | mem_level << 9;
+}
+
+bool is_inflate_key(int key) {
+	return key & 1;
+}
+
+} // namespace
+
+
+namespace node {
+namespace websocket {
+
+deflate_pool::deflate_pool(std::size_t max_idle) : _max_idle(max_idle) {
+}
+
+deflate_pool::~deflate_pool() {
+	for (const auto& e : this->_idle) {
+		destroy_stream(e.stream, is_inflate_key(e.key));
+	}
+}
+
+z_stream_s* deflate_pool::acquire(bool inflate, int level, int window_bits, int mem_level) {
+	const int key = stream_key(inflate, level, window_bits, mem_level);
+
+	// the most recently used stream is the most likely to still be cached by the CPU
+	for (auto it = this->_idle.rbegin(); it != this->_idle.rend(); ++it) {
+		if (it->key == key) {
+			z_stream* z = it->stream;
+			this->_idle.erase(std::next(it).base());
+			return z;
+		}
+	}
+
+	z_stream* z = create_stream(inflate, level, window_bits, mem_level);
+
+	if (z) {
+		z->opaque = reinterpret_cast<voidpf>(intptr_t(key));
+	}
+
+	return z;
+}
+
+void deflate_pool::release(z_stream_s* stream) {
+	const int key = int(reinterpret_cast<intptr_t>(stream->opaque));
+	const bool inflate = is_inflate_key(key);
+
+	if (this->_idle.size() >= this->_max_idle) {
+		destroy_stream(stream, inflate);
+		return;
+	}
+
+	if (inflate) {
+		inflateReset(stream);
+	} else {
+		deflateReset(stream);
+	}
+
+	this->_idle.push_back({ stream, key });
+}
+
+std::size_t deflate_pool::idle() const noexcept {
+	return this->_idle.size();
+}
+
+
+permessage_deflate::permessage_deflate(const deflate_options& options, const std::shared_ptr<deflate_pool>& pool) : _options(options), _pool(pool), _deflate(nullptr), _inflate(nullptr), _is_enabled(false) {
+	this->_options.server_max_window_bits = std::max<uint8_t>(9, std::min<uint8_t>(15, this->_options.server_max_window_bits));
+	this->_options.client_max_window_bits = std::max<uint8_t>(8, std::min<uint8_t>(15, this->_options.client_max_window_bits));
+}
+
+permessage_deflate::~permessage_deflate() {
+	this->_release(this->_deflate, false);
+	this->_release(this->_inflate, false);
+}
+
+/*
+ * RFC 7692 §5 and §7.1: The header consists of comma separated extensions,
+ * each being a name followed by semicolon separated parameters:
+ *   permessage-deflate; client_max_window_bits, permessage-deflate
+ */
+bool permessage_deflate::negotiate(const node::buffer_view& offers) {
+	const uint8_t* p = offers.begin();
+	const uint8_t* const end = offers.end();
+
+	while (p != end) {
+		const uint8_t* const element_end = std::find(p, end, uint8_t(','));
+		const uint8_t* const name_end = std::find(p, element_end, uint8_t(';'));
+
+		if (!equals(trim(p, name_end), "permessage-deflate")) {
+			p = element_end == end ? end : element_end + 1;
+			continue;
+		}
+
+		deflate_options options = this->_options;
+		bool has_server_no_context_takeover = false;
+		bool has_client_no_context_takeover = false;
+		int server_max_window_bits = 0;
+		int client_max_window_bits = 0;
+		bool is_acceptable = true;
+
+		for (const uint8_t* q = name_end; q != element_end && is_acceptable;) {
+			q++;
+
+			const uint8_t* const param_end = std::find(q, element_end, uint8_t(';'));
+			const uint8_t* const eq = std::find(q, param_end, uint8_t('='));
+			const node::buffer_view name = trim(q, eq);
+			const bool has_value = eq != param_end;
+			const node::buffer_view value = has_value ? trim(eq + 1, param_end) : node::buffer_view();
+
+			q = param_end;
+
+			// parameters may not be repeated and have to have a valid value (RFC 7692 §7)
+			if (equals(name, "server_no_context_takeover") && !has_value && !has_server_no_context_takeover) {
+				has_server_no_context_takeover = true;
+			} else if (equals(name, "client_no_context_takeover") && !has_value && !has_client_no_context_takeover) {
+				has_client_no_context_takeover = true;
+			} else if (equals(name, "server_max_window_bits") && has_value && !server_max_window_bits) {
+				server_max_window_bits = parse_window_bits(value);
+				is_acceptable = server_max_window_bits != 0;
+			} else if (equals(name, "client_max_window_bits") && !client_max_window_bits) {
+				client_max_window_bits = has_value ? parse_window_bits(value) : 15;
+				is_acceptable = client_max_window_bits != 0;
+			} else if (name.size() != 0 || has_value || q != element_end) {
+				// only a trailing semicolon is tolerated
+				is_acceptable = false;
+			}
+		}
+
+		// zlib can't compress with a window of 8 bits
+		if (server_max_window_bits == 8) {
+			is_acceptable = false;
+		}
+
+		if (!is_acceptable) {
+			p = element_end == end ? end : element_end + 1;
+			continue;
+		}
+
+		/*
+		 * The client may ask the server to not use context takeover or a smaller window.
+		 * The client's window can only be restricted if it offered client_max_window_bits.
+		 * The client's context takeover can always be disabled and if it announced
+		 * doing so itself anyways, the decompressor can be reset after every message as well.
+		 */
+		options.server_no_context_takeover |= has_server_no_context_takeover;
+		options.client_no_context_takeover |= has_client_no_context_takeover;
+
+		if (server_max_window_bits) {
+			options.server_max_window_bits = std::min<uint8_t>(options.server_max_window_bits, uint8_t(server_max_window_bits));
+		}
+
+		options.client_max_window_bits = client_max_window_bits ? std::min<uint8_t>(options.client_max_window_bits, uint8_t(client_max_window_bits)) : 15;
+
+		node::mutable_buffer response;
+		response.append("permessage-deflate");
+
+		if (options.server_no_context_takeover) {
+			response.append("; server_no_context_takeover");
+		}
+
+		if (options.client_no_context_takeover) {
+			response.append("; client_no_context_takeover");
+		}
+
+		if (server_max_window_bits || options.server_max_window_bits != 15) {
+			response.append("; server_max_window_bits=");
+			response.append_number(options.server_max_window_bits);
+		}
+
+		if (client_max_window_bits && options.client_max_window_bits != 15) {
+			response.append("; client_max_window_bits=");
+			response.append_number(options.client_max_window_bits);
+		}
+
+		this->_options = options;
+		this->_response = response;
+		this->_is_enabled = true;
+		return true;
+	}
+
+	return false;
+}
+
+const node::buffer& permessage_deflate::response() const noexcept {
+	return this->_response;
+}
+
+bool permessage_deflate::is_enabled() const noexcept {
+	return this->_is_enabled;
+}
+
+const deflate_options& permessage_deflate::options() const noexcept {
+	return this->_options;
+}
+
+node::buffer permessage_deflate::encode(opcode op, const node::buffer_view& payload) {
+	// control frames must not be compressed (RFC 7692 §6.1)
+	if (this->_is_enabled && (op == opcode::text || op == opcode::binary) && payload.size() >= this->_options.threshold) {
+		const node::buffer compressed = this->compress(payload);
+
+		/*
+		 * Without context takeover every message is compressed independently and
+		 * incompressible ones can thus be sent as is. Otherwise the compressor's
+		 * window already contains the message and the client's has to as well.
+		 */
+		if (compressed && (compressed.size() < payload.size() || !this->_options.server_no_context_takeover)) {
+			return node::websocket::encode(op, compressed, true);
+		}
+	}
+
+	return node::websocket::encode(op, payload);
+}
+
+node::buffer permessage_deflate::compress(const node::buffer_view& payload) {
+	z_stream* z = this->_deflate ? this->_deflate : this->_acquire(false);
+
+	if (!z) {
+		return node::buffer();
+	}
+
+	// Z_SYNC_FLUSH adds the 4 byte tail and up to 2 bytes for completing the current block
+	node::mutable_buffer out;
+	out.set_size(deflateBound(z, uLong(payload.size())) + 8);
+
+	z->next_in = const_cast<Bytef*>(payload.data());
+	z->avail_in = uInt(payload.size());
+
+	std::size_t written = 0;
+	bool is_ok = out.data() != nullptr;
+
+	while (is_ok) {
+		z->next_out = out.data() + written;
+		z->avail_out = uInt(out.size() - written);
+
+		const int r = deflate(z, Z_SYNC_FLUSH);
+		written = out.size() - z->avail_out;
+
+		if (r != Z_OK && r != Z_BUF_ERROR) {
+			is_ok = false;
+		} else if (z->avail_out != 0) {
+			break;
+		} else {
+			// a full output buffer might hide further pending output
+			out.set_size(out.size() * 2);
+			is_ok = out.data() != nullptr;
+		}
+	}
+
+	is_ok = is_ok && written >= 4 && memcmp(out.data() + written - 4, sync_tail, 4) == 0;
+
+	// a stream, which failed, can't be reused
+	if (this->_options.server_no_context_takeover || !is_ok) {
+		this->_deflate = nullptr;
+		this->_release(z, is_ok);
+	} else {
+		this->_deflate = z;
+	}
+
+	if (!is_ok) {
+		return node::buffer();
+	}
+
+	out.set_size(written - 4);
+	return out;
+}
+
+bool permessage_deflate::decompress(const node::buffer_view& payload, node::mutable_buffer& out) {
+	z_stream* z = this->_inflate ? this->_inflate : this->_acquire(true);
+
+	if (!z) {
+		return false;
+	}
+
+	const std::size_t start = out.size();
+	const std::size_t limit = start + std::min(this->_options.max_message_size, SIZE_MAX / 2);
+	std::size_t written = start;
+	bool is_ok = true;
+	bool has_ended = false;
+
+	// the payload is followed by the tail, which has been removed by the sender
+	const node::buffer_view inputs[] = { payload, node::buffer_view(sync_tail, sizeof(sync_tail)) };
+
+	for (const auto& input : inputs) {
+		z->next_in = const_cast<Bytef*>(input.data());
+		z->avail_in = uInt(input.size());
+
+		while (is_ok && !has_ended) {
+			if (written == out.size()) {
+				if (written >= limit) {
+					is_ok = false;
+					break;
+				}
+
+				out.set_size(std::min(limit + 1, written + std::max<std::size_t>(4096, 2 * input.size())));
+				is_ok = out.size() > written;
+				continue;
+			}
+
+			z->next_out = out.data() + written;
+			z->avail_out = uInt(out.size() - written);
+
+			const int r = inflate(z, Z_SYNC_FLUSH);
+			written = out.size() - z->avail_out;
+
+			if (r == Z_STREAM_END) {
+				// the sender finished the stream with a final block (RFC 7692 §7.2.3.5)
+				has_ended = true;
+			} else if (r != Z_OK && r != Z_BUF_ERROR) {
+				is_ok = false;
+			} else if (z->avail_in == 0 && z->avail_out != 0) {
+				break;
+			}
+		}
+
+		if (!is_ok || has_ended) {
+			break;
+		}
+	}
+
+	is_ok = is_ok && written - start <= this->_options.max_message_size;
+
+	if (has_ended) {
+		inflateReset(z);
+	}
+
+	if (this->_options.client_no_context_takeover || !is_ok) {
+		this->_inflate = nullptr;
+		this->_release(z, is_ok);
+	} else {
+		this->_inflate = z;
+	}
+
+	out.set_size(is_ok ? written : start);
+	return is_ok;
+}
+
+z_stream_s* permessage_deflate::_acquire(bool inflate) {
+	const int window_bits = inflate ? this->_options.client_max_window_bits : this->_options.server_max_window_bits;
+
+	if (this->_pool) {
+		return this->_pool->acquire(inflate, this->_options.level, window_bits, this->_options.mem_level);
+	}
+
+	z_stream* z = create_stream(inflate, this->_options.level, window_bits, this->_options.mem_level);
+
+	if (z) {
+		z->opaque = reinterpret_cast<voidpf>(intptr_t(stream_key(inflate, this->_options.level, window_bits, this->_options.mem_level)));
+	}
+
+	return z;
+}
+
+/*
+ * Returns the stream to the pool if reuse is true and frees it otherwise.
+ */
+void permessage_deflate::_release(z_stream_s*& stream, bool reuse) {
+	if (!stream) {
+		return;
+	}
+
+	if (this->_pool && reuse) {
+		this->_pool->release(stream);
+	} else {
+		destroy_stream(stream, is_inflate_key(int(reinterpret_cast<intptr_t>(stream->opaque))));
+	}
+
+	stream = nullptr;
+}
+
+} // namespace websocket
+} // namespace node
@@ -1,4 +1,5 @@
 #include <catch.hpp>
+#include <memory>
 
 #include "libnodecc/events.h"
 
@@ -219,4 +220,29 @@ TEST_CASE("events::emitter", "[events]") {
 		REQUIRE(depth == 8);
 		REQUIRE(s2_extra == 3);
 	}
+
+	SECTION("deletion while emitting") {
+		node::events::symbol<void()> s1;
+		node::events::symbol<void()> s2;
+		node::events::emitter ee;
+		const auto guard = std::make_shared<int>(0);
+		void* it = nullptr;
+
+		// handlers removed while being emitted are deleted once the emission returned
+		it = ee.on(s1, [&ee, &it, &s1, guard]() {
+			ee.off(s1, it);
+		});
+
+		ee.on(s2, [&ee, &s2, guard]() {
+			ee.removeAllListeners(s2);
+		});
+
+		REQUIRE(guard.use_count() == 3);
+
+		ee.emit(s1);
+		REQUIRE(guard.use_count() == 2);
+
+		ee.emit(s2);
+		REQUIRE(guard.use_count() == 1);
+	}
 }
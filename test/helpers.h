@@ -0,0 +1,25 @@
+#ifndef nodecc_test_helpers_h
+#define nodecc_test_helpers_h
+
+#include <string>
+
+#include "libnodecc/buffer.h"
+
+
+/*
+ * Conversions between std::string and buffers, which make assertions on buffers readable.
+ */
+
+inline std::string str(const node::buffer_view& view) {
+	return std::string(view.data<const char>(), view.size());
+}
+
+inline node::buffer buf(const std::string& s) {
+	return node::buffer(s.data(), s.size(), node::buffer_flags::copy);
+}
+
+inline node::buffer_view view(const std::string& s) {
+	return node::buffer_view(s.data(), s.size());
+}
+
+#endif // nodecc_test_helpers_h
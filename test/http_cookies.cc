@@ -0,0 +1,64 @@
+#include <catch.hpp>
+#include <stdexcept>
+#include <string>
+
+#include "libnodecc/http/cookies.h"
+
+#include "helpers.h"
+
+
+TEST_CASE("http::cookies", "[http]") {
+	using namespace node::literals;
+	using node::http::cookies;
+	using node::http::cookie_attributes;
+
+	SECTION("parsing") {
+		const std::string header = "sid=abc123; theme=\"dark\";;  invalid ; empty=; sid=second;a = b ";
+		const node::buffer buf(header.data(), header.size(), node::buffer_flags::copy);
+
+		cookies jar;
+		jar.set_header(buf);
+
+		REQUIRE(str(jar.get("sid"_view)) == "abc123");
+		REQUIRE(str(jar.get("theme"_view)) == "dark");
+		REQUIRE(str(jar.get("a"_view)) == "b");
+		REQUIRE(jar.has("empty"_view));
+		REQUIRE(jar.get("empty"_view).size() == 0);
+		REQUIRE_FALSE(jar.has("invalid"_view));
+		REQUIRE(jar.find("missing"_view) == nullptr);
+		REQUIRE(jar.all().size() == 5);
+		REQUIRE(str(jar.all()[3].second) == "second");
+
+		// values are slices of the header
+		REQUIRE(jar.get("sid"_view).data() == buf.data() + 4);
+
+		jar.clear();
+		REQUIRE(jar.all().empty());
+	}
+
+	SECTION("serialization") {
+		REQUIRE(str(cookies::serialize("sid"_view, "abc"_view)) == "sid=abc");
+
+		cookie_attributes attributes;
+		attributes.domain = "example.com"_view;
+		attributes.path = "/"_view;
+		attributes.max_age = 3600;
+		attributes.secure = true;
+		attributes.http_only = true;
+		attributes.same_site = cookie_attributes::strict;
+
+		const node::buffer buf = cookies::serialize("sid"_view, "abc"_view, attributes);
+		REQUIRE(str(buf) == "sid=abc; Domain=example.com; Path=/; Max-Age=3600; Secure; HttpOnly; SameSite=Strict");
+	}
+
+	SECTION("serialization of invalid cookies") {
+		REQUIRE_THROWS_AS(cookies::serialize(""_view, "abc"_view), std::invalid_argument);
+		REQUIRE_THROWS_AS(cookies::serialize("s=id"_view, "abc"_view), std::invalid_argument);
+		REQUIRE_THROWS_AS(cookies::serialize("sid"_view, "abc; Domain=evil.com"_view), std::invalid_argument);
+		REQUIRE_THROWS_AS(cookies::serialize("sid"_view, "abc\r\nlocation: /"_view), std::invalid_argument);
+
+		cookie_attributes attributes;
+		attributes.path = "/\nx"_view;
+		REQUIRE_THROWS_AS(cookies::serialize("sid"_view, "abc"_view, attributes), std::invalid_argument);
+	}
+}
@@ -0,0 +1,68 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/http/header_list.h"
+
+
+static std::string serialize(const node::http::header_list& headers) {
+	node::mutable_buffer buf;
+	headers.serialize(buf);
+	return std::string(buf.data<const char>(), buf.size());
+}
+
+
+TEST_CASE("http::header_list", "[http]") {
+	using namespace node::literals;
+	using node::http::header_list;
+
+	header_list headers;
+
+	SECTION("insertion order") {
+		headers.set("x-b"_view, "1"_view);
+		headers.set("content-length"_view, "5"_view);
+		headers.set("x-a"_view, "2"_view);
+
+		REQUIRE(headers.size() == 3);
+		REQUIRE(serialize(headers) == "x-b: 1\r\ncontent-length: 5\r\nx-a: 2\r\n");
+	}
+
+	SECTION("well known slots") {
+		REQUIRE_FALSE(headers.contains(header_list::content_length));
+
+		headers.set("x-a"_view, "1"_view);
+		headers.set("content-length"_view, "5"_view);
+		headers.set("date"_view, "today"_view);
+
+		REQUIRE(headers.contains(header_list::content_length));
+		REQUIRE(headers.find(header_list::date)->equals("today"_view));
+		REQUIRE(headers.find("content-length"_view)->equals("5"_view));
+		REQUIRE_FALSE(headers.contains(header_list::transfer_encoding));
+
+		REQUIRE(headers.erase("x-a"_view));
+		REQUIRE(headers.find(header_list::content_length)->equals("5"_view));
+		REQUIRE(headers.find(header_list::date)->equals("today"_view));
+
+		headers.clear();
+		REQUIRE(headers.empty());
+		REQUIRE_FALSE(headers.contains(header_list::date));
+	}
+
+	SECTION("multiple values") {
+		headers.add("set-cookie"_view, "a=1"_view);
+		headers.set("x-a"_view, "1"_view);
+		headers.add("set-cookie"_view, "b=2"_view);
+
+		REQUIRE(headers.size() == 3);
+		REQUIRE(headers.find(header_list::set_cookie)->equals("a=1"_view));
+		REQUIRE(serialize(headers) == "set-cookie: a=1\r\nx-a: 1\r\nset-cookie: b=2\r\n");
+
+		headers.set("set-cookie"_view, "c=3"_view);
+
+		REQUIRE(headers.size() == 2);
+		REQUIRE(serialize(headers) == "set-cookie: c=3\r\nx-a: 1\r\n");
+
+		headers.set("x-a"_view, "2"_view);
+		REQUIRE(serialize(headers) == "set-cookie: c=3\r\nx-a: 2\r\n");
+		REQUIRE(headers.find("x-b"_view) == nullptr);
+	}
+}
@@ -0,0 +1,149 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/http/multipart_parser.h"
+
+#include "helpers.h"
+
+
+/*
+ * Serializes all callbacks of the parser into a string,
+ * which makes it easy to compare the results of differently split inputs.
+ */
+static void record(node::http::multipart_parser& parser, std::string& out) {
+	parser.part_callback.connect([&out](const node::http::header_list& headers) {
+		out += "[";
+
+		for (const auto& header : headers) {
+			out += str(header.first) + "=" + str(header.second) + ";";
+		}
+
+		out += "]";
+	});
+	parser.data_callback.connect([&out](const node::buffer& data) {
+		out += str(data);
+	});
+	parser.part_end_callback.connect([&out]() {
+		out += "|";
+	});
+	parser.end_callback.connect([&out]() {
+		out += "$";
+	});
+}
+
+
+TEST_CASE("http::multipart_parser", "[http]") {
+	using node::http::multipart_parser;
+
+	const std::string body =
+		"preamble\r\n"
+		"--AaB03x\r\n"
+		"Content-Disposition: form-data; name=\"field\"\r\n"
+		"\r\n"
+		"value\r\n--AaB03\r\n"
+		"--AaB03x  \r\n"
+		"Content-Disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n"
+		"Content-Type:text/plain\r\n"
+		"\r\n"
+		"\r\r\n\r\n-\r\n--AaB03\r\n"
+		"--AaB03x\r\n"
+		"\r\n"
+		"\r\n"
+		"--AaB03x--\r\n"
+		"epilogue";
+	const std::string expected =
+		"[content-disposition=form-data; name=\"field\";]value\r\n--AaB03|"
+		"[content-disposition=form-data; name=\"file\"; filename=\"a.txt\";content-type=text/plain;]\r\r\n\r\n-\r\n--AaB03|"
+		"[]|$";
+
+	SECTION("boundary") {
+		REQUIRE(str(multipart_parser::boundary(buf("multipart/form-data; boundary=AaB03x"))) == "AaB03x");
+		REQUIRE(str(multipart_parser::boundary(buf("multipart/form-data;Boundary=\"a b\"; charset=utf-8"))) == "a b");
+		REQUIRE(str(multipart_parser::boundary(buf("multipart/form-data; xboundary=a"))) == "");
+		REQUIRE(multipart_parser::boundary(buf("multipart/form-data")).size() == 0);
+	}
+
+	SECTION("complete input") {
+		multipart_parser parser(node::buffer_view("AaB03x", 6));
+		std::string out;
+		record(parser, out);
+
+		REQUIRE(parser.push(buf(body)));
+		REQUIRE(parser.is_complete());
+		REQUIRE(out == expected);
+	}
+
+	SECTION("no preamble") {
+		multipart_parser parser(node::buffer_view("AaB03x", 6));
+		std::string out;
+		record(parser, out);
+
+		parser.push(buf("--AaB03x\r\n\r\nabc\r\n--AaB03x--"));
+		REQUIRE(parser.is_complete());
+		REQUIRE(out == "[]abc|$");
+	}
+
+	SECTION("split input") {
+		for (std::size_t i = 0; i <= body.size(); i++) {
+			for (std::size_t j = i; j <= body.size(); j += 7) {
+				multipart_parser parser(node::buffer_view("AaB03x", 6));
+				std::string out;
+				record(parser, out);
+
+				parser.push(buf(body.substr(0, i)));
+				parser.push(buf(body.substr(i, j - i)));
+				parser.push(buf(body.substr(j)));
+
+				REQUIRE(parser.is_complete());
+				REQUIRE(out == expected);
+			}
+		}
+	}
+
+	SECTION("single bytes") {
+		multipart_parser parser(node::buffer_view("AaB03x", 6));
+		std::string out;
+		record(parser, out);
+
+		for (const char ch : body) {
+			parser.push(buf(std::string(1, ch)));
+		}
+
+		REQUIRE(parser.is_complete());
+		REQUIRE(out == expected);
+	}
+
+	SECTION("pause and resume") {
+		multipart_parser parser(node::buffer_view("AaB03x", 6));
+		std::string out;
+		record(parser, out);
+
+		std::size_t callbacks = 0;
+		parser.data_callback.connect([&](const node::buffer& data) {
+			out += str(data);
+			callbacks++;
+			parser.pause();
+		});
+
+		REQUIRE_FALSE(parser.push(buf(body)));
+		REQUIRE(callbacks == 1);
+
+		while (!parser.resume()) {
+		}
+
+		REQUIRE(parser.is_complete());
+		REQUIRE(out == expected);
+	}
+
+	SECTION("errors") {
+		REQUIRE(multipart_parser(node::buffer_view()).has_error());
+
+		multipart_parser parser(node::buffer_view("AaB03x", 6));
+		parser.push(buf("--AaB03x\r\nno-colon\r\n\r\n"));
+		REQUIRE(parser.has_error());
+
+		multipart_parser garbage(node::buffer_view("AaB03x", 6));
+		garbage.push(buf("--AaB03xyz\r\n"));
+		REQUIRE(garbage.has_error());
+	}
+}
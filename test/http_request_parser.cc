@@ -0,0 +1,133 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/http/request_parser.h"
+
+#include "helpers.h"
+
+
+TEST_CASE("http::request_parser", "[http]") {
+	node::http::request_parser parser;
+
+	SECTION("simple request") {
+		const std::string req = "GET /index.html?foo=bar HTTP/1.1\r\nHost: example.com\r\nAccept:  */*  \r\nX-Empty:\r\n\r\n";
+
+		REQUIRE(parser.parse(node::buffer_view(req)) == int(req.size()));
+		REQUIRE(str(parser.method()) == "GET");
+		REQUIRE(str(parser.path()) == "/index.html?foo=bar");
+		REQUIRE(parser.http_version_minor() == 1);
+		REQUIRE(parser.header_count() == 3);
+
+		const auto headers = parser.headers();
+		REQUIRE(str(headers[0].name) == "Host");
+		REQUIRE(str(headers[0].value) == "example.com");
+		REQUIRE(str(headers[1].name) == "Accept");
+		REQUIRE(str(headers[1].value) == "*/*");
+		REQUIRE(str(headers[2].name) == "X-Empty");
+		REQUIRE(headers[2].value.size() == 0);
+	}
+
+	SECTION("bare LF and leading empty lines") {
+		const std::string req = "\r\nPOST / HTTP/1.0\nContent-Length: 3\n\nabc";
+
+		REQUIRE(parser.parse(node::buffer_view(req)) == int(req.size() - 3));
+		REQUIRE(str(parser.method()) == "POST");
+		REQUIRE(parser.http_version_minor() == 0);
+		REQUIRE(parser.header_count() == 1);
+	}
+
+	SECTION("incremental") {
+		const std::string req = "GET /a/very/long/path/which/exceeds/sixteen/bytes HTTP/1.1\r\nUser-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n\r\n";
+		std::size_t last_size = 0;
+
+		for (std::size_t size = 1; size < req.size(); size++) {
+			REQUIRE(parser.parse(node::buffer_view(req.data(), size), last_size) == node::http::request_parser::incomplete);
+			last_size = size;
+		}
+
+		REQUIRE(parser.parse(node::buffer_view(req), last_size) == int(req.size()));
+		REQUIRE(str(parser.headers()[0].value) == "Mozilla/5.0 (X11; Linux x86_64)");
+	}
+
+	SECTION("errors") {
+		const char* requests[] = {
+			" / HTTP/1.1\r\n\r\n",
+			"GET  HTTP/1.1\r\n\r\n",
+			"GET / HTTP/2.0\r\n\r\n",
+			"GET / HTTP/1.1\r\nHost : example.com\r\n\r\n",
+			"GET / HTTP/1.1\r\nHost: example.com\r\n folded\r\n\r\n",
+			"GET / HTTP/1.1\r\nHost: exa\x01mple.com\r\n\r\n",
+			"GET /\x7f HTTP/1.1\r\n\r\n",
+		};
+
+		for (const auto req : requests) {
+			REQUIRE(parser.parse(node::buffer_view(req)) == node::http::request_parser::error);
+		}
+	}
+
+	SECTION("too many headers") {
+		std::string req = "GET / HTTP/1.1\r\n";
+
+		for (std::size_t i = 0; i <= node::http::request_parser::max_headers; i++) {
+			req += "a: b\r\n";
+		}
+
+		req += "\r\n";
+
+		REQUIRE(parser.parse(node::buffer_view(req)) == node::http::request_parser::error);
+	}
+}
+
+TEST_CASE("http::chunked_decoder", "[http]") {
+	const std::string body = "4\r\nWiki\r\n5;ext=1\r\npedia\r\nE\r\n in\r\n\r\nchunks.\r\n0\r\nTrailer: value\r\n\r\nNEXT";
+	const auto data = reinterpret_cast<const uint8_t*>(body.data());
+
+	SECTION("complete input") {
+		node::http::chunked_decoder decoder;
+		std::string decoded;
+		std::size_t pos = 0;
+
+		while (pos < body.size() && !decoder.is_complete()) {
+			std::size_t offset;
+			std::size_t size;
+
+			const std::size_t consumed = decoder.decode(data + pos, body.size() - pos, offset, size);
+			decoded.append(body, pos + offset, size);
+			pos += consumed;
+
+			REQUIRE_FALSE(decoder.has_error());
+		}
+
+		REQUIRE(decoder.is_complete());
+		REQUIRE(decoded == "Wikipedia in\r\n\r\nchunks.");
+		REQUIRE(body.substr(pos) == "NEXT");
+	}
+
+	SECTION("byte by byte") {
+		node::http::chunked_decoder decoder;
+		std::string decoded;
+		std::size_t pos = 0;
+
+		while (pos < body.size() && !decoder.is_complete()) {
+			std::size_t offset;
+			std::size_t size;
+
+			const std::size_t consumed = decoder.decode(data + pos, 1, offset, size);
+			decoded.append(body, pos + offset, size);
+			pos += consumed;
+		}
+
+		REQUIRE(decoder.is_complete());
+		REQUIRE(decoded == "Wikipedia in\r\n\r\nchunks.");
+		REQUIRE(body.substr(pos) == "NEXT");
+	}
+
+	SECTION("invalid chunk size") {
+		node::http::chunked_decoder decoder;
+		std::size_t offset;
+		std::size_t size;
+
+		decoder.decode(reinterpret_cast<const uint8_t*>("x\r\n"), 3, offset, size);
+		REQUIRE(decoder.has_error());
+	}
+}
@@ -0,0 +1,35 @@
+#include <catch.hpp>
+
+#include "libnodecc/http/response_cache.h"
+
+
+TEST_CASE("http::response_cache", "[http]") {
+	using namespace node::literals;
+	using node::http::response_cache;
+
+	SECTION("max_age") {
+		REQUIRE(response_cache::max_age("max-age=60"_view) == 60);
+		REQUIRE(response_cache::max_age("public, max-age=\"60\""_view) == 60);
+		REQUIRE(response_cache::max_age("max-age=60, s-maxage=10"_view) == 10);
+		REQUIRE(response_cache::max_age("max-age=60, private"_view) == 0);
+		REQUIRE(response_cache::max_age("No-Store, max-age=60"_view) == 0);
+		REQUIRE(response_cache::max_age("public"_view) == 0);
+	}
+
+	SECTION("vary") {
+		response_cache cache;
+
+		REQUIRE(cache.is_vary_covered(""_view));
+		REQUIRE_FALSE(cache.is_vary_covered("accept-encoding"_view));
+		REQUIRE_FALSE(cache.is_vary_covered("*"_view));
+
+		cache.set_vary_headers({ node::hashed_buffer(node::buffer("accept-encoding", 15)), node::hashed_buffer(node::buffer("accept", 6)) });
+
+		REQUIRE(cache.is_vary_covered("accept-encoding"_view));
+		REQUIRE(cache.is_vary_covered("Accept, Accept-Encoding"_view));
+		REQUIRE(cache.is_vary_covered(" accept ,,"_view));
+		REQUIRE_FALSE(cache.is_vary_covered("accept, user-agent"_view));
+		REQUIRE_FALSE(cache.is_vary_covered("accept-language"_view));
+		REQUIRE_FALSE(cache.is_vary_covered("*"_view));
+	}
+}
@@ -0,0 +1,51 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/http/static_response.h"
+
+#include "helpers.h"
+
+
+TEST_CASE("http::static_response", "[http]") {
+	using namespace node::literals;
+
+	node::http::header_list headers;
+	headers.set("content-type"_view, "text/plain"_view);
+	headers.set("content-length"_view, "999"_view);
+
+	const node::http::static_response response(200, headers, buf("OK"));
+
+	const node::buffer date1 = buf("date: Mon, 19 Oct 2026 05:00:00 GMT\r\n");
+	const node::buffer date2 = buf("date: Mon, 19 Oct 2026 05:00:01 GMT\r\n");
+	const std::string tail = "content-type: text/plain\r\ncontent-length: 2\r\nconnection: close\r\n\r\nOK";
+
+	REQUIRE(response.status_code() == 200);
+	REQUIRE(response.body_size() == 2);
+
+	SECTION("serialization") {
+		REQUIRE(str(response.get(date1)) == "HTTP/1.1 200 OK\r\n" + str(date1) + tail);
+	}
+
+	SECTION("date patching") {
+		const uint8_t* data = response.get(date1).data();
+
+		// unreferenced buffers are patched in place
+		REQUIRE(response.get(date2).data() == data);
+		REQUIRE(str(response.get(date2)) == "HTTP/1.1 200 OK\r\n" + str(date2) + tail);
+
+		// referenced ones are copied first
+		const node::buffer pending = response.get(date2);
+		const node::buffer patched = response.get(date1);
+
+		REQUIRE(patched.data() != pending.data());
+		REQUIRE(str(pending) == "HTTP/1.1 200 OK\r\n" + str(date2) + tail);
+		REQUIRE(str(patched) == "HTTP/1.1 200 OK\r\n" + str(date1) + tail);
+	}
+
+	SECTION("unknown status codes") {
+		const node::http::static_response invalid(999, node::http::header_list(), node::buffer());
+
+		REQUIRE(invalid.status_code() == 500);
+		REQUIRE(str(invalid.get(date1)).compare(0, 35, "HTTP/1.1 500 Internal Server Error\r") == 0);
+	}
+}
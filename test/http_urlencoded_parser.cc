@@ -0,0 +1,77 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/http/urlencoded_parser.h"
+
+#include "helpers.h"
+
+
+static std::string serialize(const node::http::urlencoded_parser& parser) {
+	std::string out;
+
+	for (const auto& pair : parser) {
+		out += "[" + str(pair.first) + "]=[" + str(pair.second) + "]";
+	}
+
+	return out;
+}
+
+
+TEST_CASE("http::urlencoded_parser", "[http]") {
+	using namespace node::literals;
+	using node::http::urlencoded_parser;
+
+	const std::string body = "a=1&b=hello+world&&a=%C3%A4%2b%zz%4&empty=&flag&%3D=x%3Dy";
+	const std::string expected = "[a]=[1][b]=[hello world][a]=[\xC3\xA4+%zz%4][empty]=[][flag]=[][=]=[x=y]";
+
+	urlencoded_parser parser;
+
+	SECTION("complete input") {
+		const node::buffer input = buf(body);
+		std::size_t callbacks = 0;
+
+		parser.pair_callback.connect([&callbacks](const node::buffer&, const node::buffer&) {
+			callbacks++;
+		});
+
+		parser.push(input);
+		REQUIRE(callbacks == 5);
+
+		parser.finish();
+		REQUIRE(callbacks == 6);
+		REQUIRE(serialize(parser) == expected);
+
+		REQUIRE(parser.size() == 6);
+		REQUIRE(parser.count("a"_view) == 2);
+		REQUIRE(str(*parser.find("a"_view)) == "1");
+		REQUIRE(str(*parser.find("="_view)) == "x=y");
+		REQUIRE(parser.find("c"_view) == nullptr);
+
+		// values without escapes aren't copied
+		REQUIRE(parser.find("a"_view)->data() == input.data() + 2);
+	}
+
+	SECTION("split input") {
+		for (std::size_t i = 0; i <= body.size(); i++) {
+			for (std::size_t j = i; j <= body.size(); j++) {
+				parser.clear();
+				parser.push(buf(body.substr(0, i)));
+				parser.push(buf(body.substr(i, j - i)));
+				parser.push(buf(body.substr(j)));
+				parser.finish();
+
+				REQUIRE(serialize(parser) == expected);
+			}
+		}
+	}
+
+	SECTION("large values") {
+		std::string value(3 * urlencoded_parser::arena_block_size, '+');
+
+		parser.push(buf("x=" + value + "&y=%41"));
+		parser.finish();
+
+		REQUIRE(parser.find("x"_view)->size() == value.size());
+		REQUIRE(str(*parser.find("y"_view)) == "A");
+	}
+}
@@ -0,0 +1,92 @@
+#include <catch.hpp>
+#include <vector>
+
+#include "libnodecc/loop.h"
+
+
+TEST_CASE("loop::set_timeout", "[loop]") {
+	node::loop loop;
+	std::vector<int> fired;
+
+	SECTION("due order") {
+		loop.set_timeout(30, [&fired]() { fired.push_back(3); });
+		loop.set_timeout(10, [&fired]() { fired.push_back(1); });
+		loop.set_timeout(20, [&fired]() { fired.push_back(2); });
+
+		// timeouts with the same due time fire in the order they have been set
+		loop.set_timeout(10, [&fired]() { fired.push_back(11); });
+
+		loop.run();
+
+		REQUIRE(fired == std::vector<int>({ 1, 11, 2, 3 }));
+	}
+
+	SECTION("clearing") {
+		const uint64_t a = loop.set_timeout(5, [&fired]() { fired.push_back(1); });
+		const uint64_t b = loop.set_timeout(10, [&fired]() { fired.push_back(2); });
+
+		REQUIRE(a != 0);
+		REQUIRE(b != a);
+
+		REQUIRE(loop.clear_timeout(a));
+		REQUIRE_FALSE(loop.clear_timeout(a));
+
+		loop.run();
+
+		REQUIRE(fired == std::vector<int>({ 2 }));
+
+		// expired timeouts can't be cleared anymore
+		REQUIRE_FALSE(loop.clear_timeout(b));
+	}
+
+	SECTION("setting and clearing from within callbacks") {
+		uint64_t cleared = 0;
+
+		loop.set_timeout(5, [&]() {
+			fired.push_back(1);
+
+			REQUIRE(loop.clear_timeout(cleared));
+
+			loop.set_timeout(0, [&]() {
+				fired.push_back(2);
+
+				loop.set_timeout(5, [&fired]() { fired.push_back(3); });
+			});
+		});
+
+		cleared = loop.set_timeout(10, [&fired]() { fired.push_back(-1); });
+
+		loop.run();
+
+		REQUIRE(fired == std::vector<int>({ 1, 2, 3 }));
+		REQUIRE(loop._timeouts.empty());
+		REQUIRE(loop._timeout_callbacks.empty());
+	}
+
+	SECTION("compaction of cleared timeouts") {
+		std::vector<uint64_t> ids;
+
+		for (int i = 1; i <= 3; i++) {
+			loop.set_timeout(uint64_t(i), [&fired, i]() { fired.push_back(i); });
+		}
+
+		for (int i = 0; i < 100; i++) {
+			ids.push_back(loop.set_timeout(10000, [&fired]() { fired.push_back(-1); }));
+		}
+
+		for (const uint64_t id : ids) {
+			REQUIRE(loop.clear_timeout(id));
+		}
+
+		// cleared timeouts are removed lazily...
+		REQUIRE(loop._timeouts.size() == 103);
+
+		// ...until the heap mostly consists of them
+		loop.set_timeout(4, [&fired]() { fired.push_back(4); });
+		REQUIRE(loop._timeouts.size() == 4);
+
+		loop.run();
+
+		REQUIRE(fired == std::vector<int>({ 1, 2, 3, 4 }));
+	}
+}
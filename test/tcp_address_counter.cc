@@ -0,0 +1,84 @@
+#include <catch.hpp>
+#include <map>
+#include <random>
+
+#include "libnodecc/tcp/address_counter.h"
+
+
+static sockaddr_in ipv4(uint32_t address, uint16_t port = 0) {
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(address);
+	return addr;
+}
+
+static sockaddr_in6 ipv6(uint8_t last) {
+	sockaddr_in6 addr = {};
+	addr.sin6_family = AF_INET6;
+	addr.sin6_addr.s6_addr[0] = 0x20;
+	addr.sin6_addr.s6_addr[1] = 0x01;
+	addr.sin6_addr.s6_addr[15] = last;
+	return addr;
+}
+
+template<typename T>
+static const sockaddr& sa(const T& addr) {
+	return reinterpret_cast<const sockaddr&>(addr);
+}
+
+
+TEST_CASE("tcp::address_counter", "[tcp]") {
+	node::tcp::address_counter counter;
+
+	SECTION("address families") {
+		const auto a = ipv4(0x7f000001, 1000);
+		const auto b = ipv4(0x7f000001, 2000);
+		const auto c = ipv6(1);
+
+		REQUIRE(counter.count(sa(a)) == 0);
+		REQUIRE(counter.decrement(sa(a)) == 0);
+
+		REQUIRE(counter.increment(sa(a)) == 1);
+		REQUIRE(counter.increment(sa(b)) == 2);
+		REQUIRE(counter.increment(sa(c)) == 1);
+		REQUIRE(counter.size() == 2);
+
+		REQUIRE(counter.decrement(sa(a)) == 1);
+		REQUIRE(counter.decrement(sa(a)) == 0);
+		REQUIRE(counter.size() == 1);
+		REQUIRE(counter.count(sa(c)) == 1);
+
+		counter.clear();
+		REQUIRE(counter.size() == 0);
+		REQUIRE(counter.count(sa(c)) == 0);
+	}
+
+	SECTION("random operations") {
+		std::mt19937 rng(42);
+		std::map<uint32_t, uint32_t> expected;
+
+		for (int i = 0; i < 100000; i++) {
+			// a small address range produces plenty of collisions and removals
+			const uint32_t address = rng() % 512;
+			const auto addr = ipv4(address);
+
+			if (rng() % 2) {
+				REQUIRE(counter.increment(sa(addr)) == ++expected[address]);
+			} else if (expected[address] > 0) {
+				REQUIRE(counter.decrement(sa(addr)) == --expected[address]);
+			}
+
+			if (expected[address] == 0) {
+				expected.erase(address);
+			}
+
+			REQUIRE(counter.size() == expected.size());
+		}
+
+		for (uint32_t address = 0; address < 512; address++) {
+			const auto it = expected.find(address);
+			REQUIRE(counter.count(sa(ipv4(address))) == (it == expected.end() ? 0 : it->second));
+		}
+	}
+}
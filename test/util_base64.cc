@@ -0,0 +1,51 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/util/base64.h"
+
+
+static std::string encode(const void* data, std::size_t size, bool base64url = false) {
+	const node::buffer buf = node::util::base64::encode(node::buffer_view(data, size), base64url);
+	return std::string(buf.data<char>(), buf.size());
+}
+
+
+TEST_CASE("util::base64", "[util]") {
+	SECTION("RFC 4648 §10 examples") {
+		REQUIRE(encode("f", 1) == "Zg==");
+		REQUIRE(encode("fo", 2) == "Zm8=");
+		REQUIRE(encode("foo", 3) == "Zm9v");
+		REQUIRE(encode("foob", 4) == "Zm9vYg==");
+		REQUIRE(encode("fooba", 5) == "Zm9vYmE=");
+		REQUIRE(encode("foobar", 6) == "Zm9vYmFy");
+	}
+
+	SECTION("base64url") {
+		const uint8_t data[] = { 0xfb, 0xff, 0xbf };
+		REQUIRE(encode(data, sizeof(data)) == "+/+/");
+		REQUIRE(encode(data, sizeof(data), true) == "-_-_");
+	}
+
+	SECTION("unaligned input") {
+		// inputs of 12 bytes and more are encoded a word at a time after an unaligned prefix
+		alignas(4) uint8_t data[64];
+		alignas(4) uint8_t copy[68];
+
+		for (std::size_t i = 0; i < sizeof(data); i++) {
+			data[i] = uint8_t(i * 37 + 11);
+		}
+
+		for (std::size_t size = 1; size <= sizeof(data); size++) {
+			const std::string expected = encode(data, size);
+			REQUIRE(expected.size() == (size + 2) / 3 * 4);
+
+			for (std::size_t offset = 1; offset < 4; offset++) {
+				memcpy(copy + offset, data, size);
+				REQUIRE(encode(copy + offset, size) == expected);
+			}
+		}
+
+		const std::string hello = "The quick brown fox jumps over the lazy dog";
+		REQUIRE(encode(hello.data(), hello.size()) == "VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZw==");
+	}
+}
@@ -0,0 +1,65 @@
+#include <catch.hpp>
+
+#include "libnodecc/util/histogram.h"
+
+
+TEST_CASE("util::histogram", "[util]") {
+	using node::util::histogram;
+
+	SECTION("bucket boundaries") {
+		for (uint64_t value = 0; value < 4096; value++) {
+			const std::size_t idx = histogram::bucket_index(value);
+
+			REQUIRE(idx < histogram::bucket_count);
+			REQUIRE(histogram::bucket_lowest_value(idx) <= value);
+			REQUIRE(histogram::bucket_highest_value(idx) >= value);
+		}
+
+		REQUIRE(histogram::bucket_index(31) == 31);
+		REQUIRE(histogram::bucket_index(32) == 32);
+		REQUIRE(histogram::bucket_index(UINT64_MAX) == histogram::bucket_count - 1);
+		REQUIRE(histogram::bucket_highest_value(histogram::bucket_count - 1) == UINT64_MAX);
+	}
+
+	SECTION("quantiles") {
+		histogram h;
+
+		REQUIRE(h.count() == 0);
+		REQUIRE(h.value_at_quantile(0.5) == 0);
+
+		for (uint64_t value = 1; value <= 1000; value++) {
+			h.record(value);
+		}
+
+		REQUIRE(h.count() == 1000);
+		REQUIRE(h.sum() == 500500);
+		REQUIRE(h.min() == 1);
+		REQUIRE(h.max() == 1000);
+
+		const uint64_t p50 = h.value_at_quantile(0.5);
+		const uint64_t p99 = h.value_at_quantile(0.99);
+
+		REQUIRE(p50 >= 500);
+		REQUIRE(p50 <= 500 * 1.07);
+		REQUIRE(p99 >= 990);
+		REQUIRE(p99 <= 1000);
+		REQUIRE(h.value_at_quantile(1.0) == 1000);
+	}
+
+	SECTION("merge") {
+		histogram a;
+		histogram b;
+
+		a.record(10);
+		b.record(20000);
+
+		histogram c(a);
+		c.merge(b);
+
+		REQUIRE(c.count() == 2);
+		REQUIRE(c.min() == 10);
+		REQUIRE(c.max() == 20000);
+		REQUIRE(c.value_at_quantile(0.5) == 10);
+		REQUIRE(a.count() == 1);
+	}
+}
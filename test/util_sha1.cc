@@ -0,0 +1,48 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/util/base64.h"
+#include "libnodecc/util/sha1.h"
+
+
+static std::string hex(const std::string& input) {
+	node::buffer_view view(input.data(), input.size());
+	uint8_t digest[SHA1_DIGEST_LENGTH];
+
+	node::util::sha1 s;
+	s.push(view);
+	s.get_digest(digest);
+
+	static const char digits[] = "0123456789abcdef";
+	std::string out;
+
+	for (const uint8_t ch : digest) {
+		out.push_back(digits[ch >> 4]);
+		out.push_back(digits[ch & 15]);
+	}
+
+	return out;
+}
+
+
+TEST_CASE("util::sha1", "[util]") {
+	SECTION("FIPS 180-2 examples") {
+		REQUIRE(hex("") == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+		REQUIRE(hex("abc") == "a9993e364706816aba3e25717850c26c9cd0d89d");
+		REQUIRE(hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") == "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+		REQUIRE(hex(std::string(1000000, 'a')) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	}
+
+	SECTION("RFC 6455 §1.3 handshake") {
+		std::string key("dGhlIHNhbXBsZSBub25jZQ==258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+		node::buffer_view view(key.data(), key.size());
+		uint8_t digest[SHA1_DIGEST_LENGTH];
+
+		node::util::sha1 s;
+		s.push(view);
+		s.get_digest(digest);
+
+		const node::buffer accept = node::util::base64::encode(node::buffer_view(digest, sizeof(digest)));
+		REQUIRE(std::string(accept.data<char>(), accept.size()) == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+	}
+}
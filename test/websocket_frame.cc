@@ -0,0 +1,121 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/websocket/frame.h"
+
+#include "helpers.h"
+
+
+TEST_CASE("websocket::frame", "[websocket]") {
+	using node::websocket::opcode;
+
+	SECTION("header sizes") {
+		REQUIRE(node::websocket::header_size(0) == 2);
+		REQUIRE(node::websocket::header_size(125) == 2);
+		REQUIRE(node::websocket::header_size(126) == 4);
+		REQUIRE(node::websocket::header_size(65535) == 4);
+		REQUIRE(node::websocket::header_size(65536) == 10);
+		REQUIRE(node::websocket::header_size(125, true) == 6);
+		REQUIRE(node::websocket::header_size(65536, true) == node::websocket::max_header_size);
+	}
+
+	SECTION("small frames") {
+		// RFC 6455 §5.7: a single-frame unmasked text message
+		const node::buffer frame = node::websocket::encode(opcode::text, node::buffer_view("Hello", 5));
+		REQUIRE(str(frame) == std::string("\x81\x05Hello", 7));
+	}
+
+	SECTION("masked frames") {
+		// RFC 6455 §5.7: a single-frame masked text message
+		const uint8_t mask[] = { 0x37, 0xfa, 0x21, 0x3d };
+		uint8_t head[node::websocket::max_header_size];
+
+		REQUIRE(node::websocket::write_header(head, opcode::text, 5, true, false, mask) == 6);
+		REQUIRE(str(node::buffer_view(head, 6)) == std::string("\x81\x85\x37\xfa\x21\x3d", 6));
+	}
+
+	SECTION("extended lengths") {
+		uint8_t head[node::websocket::max_header_size];
+
+		// RFC 6455 §5.7: 256 bytes binary message in a single unmasked frame
+		REQUIRE(node::websocket::write_header(head, opcode::binary, 256) == 4);
+		REQUIRE(str(node::buffer_view(head, 4)) == std::string("\x82\x7e\x01\x00", 4));
+
+		// RFC 6455 §5.7: 64KiB binary message in a single unmasked frame
+		REQUIRE(node::websocket::write_header(head, opcode::binary, 65536) == 10);
+		REQUIRE(str(node::buffer_view(head, 10)) == std::string("\x82\x7f\x00\x00\x00\x00\x00\x01\x00\x00", 10));
+
+		const node::buffer frame = node::websocket::encode(opcode::binary, node::buffer_view(std::string(300, 'x')));
+		REQUIRE(frame.size() == 304);
+		REQUIRE(str(frame.slice(4)) == std::string(300, 'x'));
+	}
+
+	SECTION("flags") {
+		uint8_t head[node::websocket::max_header_size];
+
+		// compressed first fragment and final continuation
+		REQUIRE(node::websocket::write_header(head, opcode::text, 0, false, true) == 2);
+		REQUIRE(head[0] == 0x41);
+
+		REQUIRE(node::websocket::write_header(head, opcode::continuation, 0) == 2);
+		REQUIRE(head[0] == 0x80);
+	}
+
+	SECTION("parsing") {
+		node::websocket::frame_header header;
+		const std::string masked("\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58", 11);
+
+		for (std::size_t i = 0; i < 6; i++) {
+			REQUIRE(header.parse(reinterpret_cast<const uint8_t*>(masked.data()), i) == node::websocket::frame_header::incomplete);
+		}
+
+		REQUIRE(header.parse(reinterpret_cast<const uint8_t*>(masked.data()), masked.size()) == 6);
+		REQUIRE(header.fin);
+		REQUIRE_FALSE(header.rsv1);
+		REQUIRE(header.op == opcode::text);
+		REQUIRE(header.masked);
+		REQUIRE(header.payload_size == 5);
+		REQUIRE_FALSE(header.is_control());
+
+		// RFC 6455 §5.7: the masked payload is "Hello"
+		std::string payload = masked.substr(6);
+		node::websocket::apply_mask(reinterpret_cast<uint8_t*>(&payload[0]), payload.size(), header.mask);
+		REQUIRE(payload == "Hello");
+
+		const std::string ping("\x89\x7f\x00\x00\x00\x00\x00\x01\x00\x00", 10);
+		REQUIRE(header.parse(reinterpret_cast<const uint8_t*>(ping.data()), 9) == node::websocket::frame_header::incomplete);
+		REQUIRE(header.parse(reinterpret_cast<const uint8_t*>(ping.data()), 10) == 10);
+		REQUIRE(header.op == opcode::ping);
+		REQUIRE(header.is_control());
+		REQUIRE(header.payload_size == 65536);
+
+		const std::string invalid("\x82\x7f\x80\x00\x00\x00\x00\x00\x00\x00", 10);
+		REQUIRE(header.parse(reinterpret_cast<const uint8_t*>(invalid.data()), 10) == node::websocket::frame_header::error);
+	}
+
+	SECTION("masking") {
+		const uint8_t mask[] = { 0x01, 0x02, 0x04, 0x08 };
+		std::string data;
+
+		for (int i = 0; i < 200; i++) {
+			data.push_back(char(i * 7));
+		}
+
+		std::string expected = data;
+
+		for (std::size_t i = 0; i < expected.size(); i++) {
+			expected[i] ^= char(mask[i & 3]);
+		}
+
+		// all combinations of unaligned starts, sizes and offsets within the payload
+		for (std::size_t beg = 0; beg < 40; beg++) {
+			for (std::size_t size : { std::size_t(0), std::size_t(3), std::size_t(17), std::size_t(33), std::size_t(100) }) {
+				std::string copy = data;
+				node::websocket::apply_mask(reinterpret_cast<uint8_t*>(&copy[beg]), size, mask, beg);
+				REQUIRE(copy.substr(beg, size) == expected.substr(beg, size));
+				REQUIRE(copy.substr(0, beg) == data.substr(0, beg));
+				REQUIRE(copy.substr(beg + size) == data.substr(beg + size));
+			}
+		}
+	}
+}
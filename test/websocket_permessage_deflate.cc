@@ -0,0 +1,182 @@
+#include <catch.hpp>
+#include <string>
+
+#include "libnodecc/websocket/permessage_deflate.h"
+
+#include "helpers.h"
+
+
+TEST_CASE("websocket::permessage_deflate negotiation", "[websocket]") {
+	node::websocket::deflate_options options;
+
+	SECTION("plain offer") {
+		node::websocket::permessage_deflate ext(options);
+		REQUIRE(ext.negotiate(view("permessage-deflate")));
+		REQUIRE(ext.is_enabled());
+		REQUIRE(str(ext.response()) == "permessage-deflate");
+	}
+
+	SECTION("no offer") {
+		node::websocket::permessage_deflate ext(options);
+		REQUIRE_FALSE(ext.negotiate(view("x-webkit-deflate-frame, foo; bar=1")));
+		REQUIRE_FALSE(ext.is_enabled());
+		REQUIRE(ext.response().size() == 0);
+	}
+
+	SECTION("client parameters") {
+		node::websocket::permessage_deflate ext(options);
+		REQUIRE(ext.negotiate(view("Permessage-Deflate; server_no_context_takeover; server_max_window_bits=\"10\"; client_max_window_bits")));
+		REQUIRE(str(ext.response()) == "permessage-deflate; server_no_context_takeover; server_max_window_bits=10");
+		REQUIRE(ext.options().server_no_context_takeover);
+		REQUIRE(ext.options().server_max_window_bits == 10);
+		REQUIRE(ext.options().client_max_window_bits == 15);
+	}
+
+	SECTION("server parameters") {
+		options.server_no_context_takeover = true;
+		options.client_no_context_takeover = true;
+		options.server_max_window_bits = 12;
+		options.client_max_window_bits = 10;
+
+		node::websocket::permessage_deflate ext(options);
+		REQUIRE(ext.negotiate(view("permessage-deflate; client_max_window_bits=11")));
+		REQUIRE(str(ext.response()) == "permessage-deflate; server_no_context_takeover; client_no_context_takeover; server_max_window_bits=12; client_max_window_bits=10");
+
+		// the client's window can't be restricted without its consent
+		node::websocket::permessage_deflate ext2(options);
+		REQUIRE(ext2.negotiate(view("permessage-deflate")));
+		REQUIRE(ext2.options().client_max_window_bits == 15);
+	}
+
+	SECTION("fallback offers") {
+		node::websocket::permessage_deflate ext(options);
+
+		// invalid, unknown and duplicate parameters and unsupported windows decline an offer
+		REQUIRE(ext.negotiate(view("permessage-deflate; server_max_window_bits=16, permessage-deflate; foo, permessage-deflate; server_no_context_takeover; server_no_context_takeover, permessage-deflate; server_max_window_bits=8, permessage-deflate; client_max_window_bits=9")));
+		REQUIRE(str(ext.response()) == "permessage-deflate; client_max_window_bits=9");
+
+		node::websocket::permessage_deflate ext2(options);
+		REQUIRE_FALSE(ext2.negotiate(view("permessage-deflate; server_max_window_bits")));
+	}
+}
+
+TEST_CASE("websocket::permessage_deflate compression", "[websocket]") {
+	node::websocket::deflate_options options;
+	options.threshold = 16;
+
+	node::websocket::permessage_deflate ext(options);
+	REQUIRE(ext.negotiate(view("permessage-deflate")));
+
+	SECTION("RFC 7692 §7.2.3.1 example") {
+		const std::string compressed("\xf2\x48\xcd\xc9\xc9\x07\x00", 7);
+		node::mutable_buffer out;
+
+		REQUIRE(ext.decompress(view(compressed), out));
+		REQUIRE(str(out) == "Hello");
+
+		// a decompressor with context takeover continues with the same window
+		const std::string repeated("\xf2\x00\x11\x00\x00", 5);
+		out.clear();
+
+		REQUIRE(ext.decompress(view(repeated), out));
+		REQUIRE(str(out) == "Hello");
+	}
+
+	SECTION("roundtrip") {
+		std::string json;
+
+		for (int i = 0; i < 1000; i++) {
+			json += "{\"id\":" + std::to_string(i) + ",\"name\":\"item\",\"tags\":[\"a\",\"b\"]},";
+		}
+
+		// the client's decompressor is emulated with a second instance
+		node::websocket::permessage_deflate client(options);
+		REQUIRE(client.negotiate(view("permessage-deflate")));
+
+		std::size_t previous = SIZE_MAX;
+
+		for (int i = 0; i < 3; i++) {
+			const node::buffer compressed = ext.compress(view(json));
+			REQUIRE(compressed.size() > 0);
+			REQUIRE(compressed.size() < json.size() / 5);
+
+			// later messages refer to the previous ones due to context takeover
+			REQUIRE(compressed.size() <= previous);
+			previous = compressed.size();
+
+			node::mutable_buffer out;
+			REQUIRE(client.decompress(compressed, out));
+			REQUIRE(str(out) == json);
+		}
+	}
+
+	SECTION("framing") {
+		const node::buffer small = ext.encode(node::websocket::opcode::text, view("tiny"));
+		REQUIRE(str(small) == std::string("\x81\x04tiny", 6));
+
+		const node::buffer large = ext.encode(node::websocket::opcode::text, view(std::string(1000, 'a')));
+		REQUIRE(uint8_t(large[0]) == 0xc1);
+		REQUIRE(large.size() < 100);
+
+		// control frames are never compressed
+		const node::buffer ping = ext.encode(node::websocket::opcode::ping, view(std::string(100, 'a')));
+		REQUIRE(uint8_t(ping[0]) == 0x89);
+	}
+
+	SECTION("limits") {
+		node::websocket::deflate_options limited;
+		limited.max_message_size = 100;
+
+		node::websocket::permessage_deflate small(limited);
+		REQUIRE(small.negotiate(view("permessage-deflate")));
+
+		const node::buffer compressed = ext.compress(view(std::string(1000, 'a')));
+		node::mutable_buffer out;
+		out.append("prefix", 6);
+
+		REQUIRE_FALSE(small.decompress(compressed, out));
+		REQUIRE(str(out) == "prefix");
+
+		node::websocket::permessage_deflate corrupt(options);
+		REQUIRE(corrupt.negotiate(view("permessage-deflate")));
+		REQUIRE_FALSE(corrupt.decompress(view(std::string("\xff\xff\xff\xff", 4)), out));
+	}
+}
+
+TEST_CASE("websocket::deflate_pool", "[websocket]") {
+	const auto pool = std::make_shared<node::websocket::deflate_pool>(2);
+
+	node::websocket::deflate_options options;
+	options.server_no_context_takeover = true;
+	options.client_no_context_takeover = true;
+
+	std::string payload;
+
+	for (int i = 0; i < 100; i++) {
+		payload += "pooled compressor ";
+	}
+
+	node::buffer first;
+
+	for (int i = 0; i < 4; i++) {
+		node::websocket::permessage_deflate ext(options, pool);
+		REQUIRE(ext.negotiate(view("permessage-deflate")));
+
+		// without context takeover every message compresses to the same data
+		const node::buffer compressed = ext.compress(view(payload));
+
+		if (i == 0) {
+			first = compressed;
+		}
+
+		REQUIRE(str(compressed) == str(first));
+
+		// the compressor is returned right away, while the decompressor hasn't been needed yet
+		REQUIRE(pool->idle() == (i == 0 ? 1 : 2));
+
+		node::mutable_buffer out;
+		REQUIRE(ext.decompress(compressed, out));
+		REQUIRE(str(out) == payload);
+		REQUIRE(pool->idle() == 2);
+	}
+}